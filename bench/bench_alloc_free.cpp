@@ -0,0 +1,112 @@
+// Fast-path cost of the block allocator
+
+#include "mem_pool.h"
+#include "mem_pool_request.h"
+#include "mem_pool_tiny.h"
+#include "bench_ticks.h"
+
+#include <assert.h>
+
+#define BENCH_ROUNDS     16
+#define BENCH_ITERATIONS 100000
+
+// Cost of one allocateBlock + freeBlock pair. Compare the output of a default build
+// with one configured with -DMEM_POOL_SAFE_LINKING=OFF (or -DMEM_POOL_POISON=ON) to get
+// the hardening overhead.
+static void bench_allocFree(size_t blockSize, size_t poolSize) {
+    enum { BURST = 4 };
+    MemoryPool_t* pool = createMemoryPool(blockSize, poolSize);
+    assert(pool != NULL && poolSize / blockSize >= BURST);
+
+    void* volatile sink;
+    void* blocks[BURST];
+    uint64_t best = UINT64_MAX;
+
+    for (int round = 0; round < BENCH_ROUNDS; ++round) {
+        uint64_t start = benchTicks();
+        for (int i = 0; i < BENCH_ITERATIONS; ++i) {
+            for (int j = 0; j < BURST; ++j) blocks[j] = allocateBlock(pool);
+            sink = blocks[0];
+            for (int j = BURST - 1; j >= 0; --j) freeBlock(pool, blocks[j]);
+        }
+        uint64_t ticks = benchTicks() - start;
+        if (ticks < best) best = ticks;
+    }
+    (void)sink;
+
+    printf("[BENCH] allocateBlock+freeBlock, safe-linking %s, poison %s: %.2f ticks/pair\n",
+           MEM_POOL_SAFE_LINKING ? "on" : "off", MEM_POOL_POISON ? "on" : "off",
+           (double)best / ((double)BENCH_ITERATIONS * BURST));
+
+    destroyMemoryPool(pool);
+}
+
+// Creation cost and footprint of many small pools, as one per connection: MemoryPool_t
+// against the tiny pool with its descriptor in the arena header
+static void bench_manyPools(size_t blockSize, size_t numBlocks) {
+    enum { NUM_POOLS = 4096 };
+    static MemoryPool_t* pools[NUM_POOLS];
+    static MemoryPoolTiny_t* tinyPools[NUM_POOLS];
+    uint64_t best = UINT64_MAX, bestTiny = UINT64_MAX;
+
+    for (int round = 0; round < BENCH_ROUNDS; ++round) {
+        uint64_t start = benchTicks();
+        for (int i = 0; i < NUM_POOLS; ++i) {
+            pools[i] = createMemoryPoolEx(blockSize, blockSize * numBlocks, MEM_POOL_LOCK_NONE);
+        }
+        for (int i = 0; i < NUM_POOLS; ++i) destroyMemoryPool(pools[i]);
+        uint64_t ticks = benchTicks() - start;
+        if (ticks < best) best = ticks;
+
+        start = benchTicks();
+        for (int i = 0; i < NUM_POOLS; ++i) tinyPools[i] = createTinyPool(blockSize, numBlocks);
+        for (int i = 0; i < NUM_POOLS; ++i) destroyTinyPool(tinyPools[i]);
+        ticks = benchTicks() - start;
+        if (ticks < bestTiny) bestTiny = ticks;
+    }
+
+    printf("[BENCH] create+destroy %u pools of %u x %u bytes: pool %.1f ticks/pool, %u bytes descriptor; "
+           "tiny %.1f ticks/pool, %u bytes descriptor\n",
+           (unsigned)NUM_POOLS, (unsigned)numBlocks, (unsigned)blockSize, (double)best / NUM_POOLS,
+           (unsigned)sizeof(MemoryPool_t), (double)bestTiny / NUM_POOLS, (unsigned)sizeof(MemoryPoolTiny_t));
+}
+
+// Teardown of a request holding numBlocks blocks: freeBlock per block against one
+// memPoolRequestRelease
+static void bench_requestRelease(size_t blockSize, size_t numBlocks) {
+    enum { MAX_BLOCKS = 256 };
+    assert(numBlocks <= MAX_BLOCKS);
+    MemoryPool_t* pool = createMemoryPoolEx(blockSize, blockSize * numBlocks, MEM_POOL_LOCK_SPIN);
+    MemoryPoolRequest_t request;
+    int status = memPoolRequestInit(&request, &pool, 1);
+    assert(pool != NULL && status == 0);
+    (void)status;
+    void* blocks[MAX_BLOCKS];
+    uint64_t best = UINT64_MAX, bestRequest = UINT64_MAX;
+
+    for (int round = 0; round < BENCH_ROUNDS; ++round) {
+        for (size_t i = 0; i < numBlocks; ++i) blocks[i] = allocateBlock(pool);
+        uint64_t start = benchTicks();
+        for (size_t i = 0; i < numBlocks; ++i) freeBlock(pool, blocks[i]);
+        uint64_t ticks = benchTicks() - start;
+        if (ticks < best) best = ticks;
+
+        for (size_t i = 0; i < numBlocks; ++i) allocateBlockRequest(&request, blockSize);
+        start = benchTicks();
+        memPoolRequestRelease(&request);
+        ticks = benchTicks() - start;
+        if (ticks < bestRequest) bestRequest = ticks;
+    }
+
+    printf("[BENCH] teardown of %u blocks: freeBlock each %.0f ticks, memPoolRequestRelease %.0f ticks\n",
+           (unsigned)numBlocks, (double)best, (double)bestRequest);
+    memPoolRequestDestroy(&request);
+    destroyMemoryPool(pool);
+}
+
+int main(void) {
+    bench_allocFree(MEM_BLOCK_SIZE, MEM_POOL_SIZE);
+    bench_manyPools(32, 16);
+    bench_requestRelease(64, 256);
+    return 0;
+}
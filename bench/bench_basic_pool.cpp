@@ -0,0 +1,176 @@
+// Benchmark matrix of the BasicPool policy combinations
+
+#include "mem_pool_basic.h"
+#include "bench_ticks.h"
+
+#include <assert.h>
+
+using namespace mem_pool;
+
+#define BENCH_ROUNDS     16
+#define BENCH_ITERATIONS 100000
+#define BENCH_THREADS    4
+#define BENCH_MAX_THREADS 8
+#define BENCH_BLOCK_SIZE 64
+#define BENCH_NUM_BLOCKS 4096
+
+enum { BURST = 4 };
+
+#define NOINLINE_ATTR __attribute__((noinline))
+
+template <class Pool>
+static void* allocFreeLoop(void* arg) {
+    Pool* pool = (Pool*)arg;
+    void* volatile sink;
+    void* blocks[BURST];
+    for (int i = 0; i < BENCH_ITERATIONS; ++i) {
+        for (int j = 0; j < BURST; ++j) blocks[j] = pool->allocate();
+        sink = blocks[0];
+        for (int j = BURST - 1; j >= 0; --j) pool->free(blocks[j]);
+    }
+    (void)sink;
+    return NULL;
+}
+
+// Best round of one thread, and of BENCH_THREADS threads on the same pool
+// (skipped for NoSync pools that are not lock-free)
+template <class Pool>
+static void benchCombination(const char* storage, const char* freeList, const char* sync, bool shared) {
+    Pool* pool = new Pool;
+    assert(pool->valid());
+
+    uint64_t best = UINT64_MAX;
+    for (int round = 0; round < BENCH_ROUNDS; ++round) {
+        uint64_t start = benchTicks();
+        allocFreeLoop<Pool>(pool);
+        uint64_t ticks = benchTicks() - start;
+        if (ticks < best) best = ticks;
+    }
+    printf("%-7s %-9s %-6s %-5s %10.2f", storage, freeList, sync, Pool::StatsPolicy::enabled ? "on" : "off",
+           (double)best / ((double)BENCH_ITERATIONS * BURST));
+
+    if (shared) {
+        uint64_t bestShared = UINT64_MAX;
+        for (int round = 0; round < BENCH_ROUNDS / 4; ++round) {
+            pthread_t threads[BENCH_THREADS];
+            uint64_t start = benchTicks();
+            for (int t = 0; t < BENCH_THREADS; ++t) pthread_create(&threads[t], NULL, allocFreeLoop<Pool>, pool);
+            for (int t = 0; t < BENCH_THREADS; ++t) pthread_join(threads[t], NULL);
+            uint64_t ticks = benchTicks() - start;
+            if (ticks < bestShared) bestShared = ticks;
+        }
+        printf(" %10.2f", (double)bestShared / ((double)BENCH_ITERATIONS * BURST * BENCH_THREADS));
+    }
+    printf("\n");
+    delete pool;
+}
+
+template <template <size_t, size_t> class Storage, template <class> class FreeList, class Sync,
+          class Counting = CountingStats>
+static void benchStats(const char* storage, const char* freeList, const char* sync, bool shared) {
+    typedef Storage<BENCH_BLOCK_SIZE, BENCH_NUM_BLOCKS> S;
+    benchCombination<BasicPool<S, FreeList, Sync, NoStats> >(storage, freeList, sync, shared);
+    benchCombination<BasicPool<S, FreeList, Sync, Counting> >(storage, freeList, sync, shared);
+}
+
+template <template <size_t, size_t> class Storage>
+static void benchStorage(const char* storage) {
+    benchStats<Storage, ListFreeList, NoSync>(storage, "list", "none", false);
+    benchStats<Storage, ListFreeList, SpinSync>(storage, "list", "spin", true);
+    benchStats<Storage, ListFreeList, MutexSync>(storage, "list", "mutex", true);
+    benchStats<Storage, BitmapFreeList, NoSync>(storage, "bitmap", "none", false);
+    benchStats<Storage, BitmapFreeList, SpinSync>(storage, "bitmap", "spin", true);
+    benchStats<Storage, BitmapFreeList, MutexSync>(storage, "bitmap", "mutex", true);
+    benchStats<Storage, LockFreeList, NoSync, AtomicCountingStats>(storage, "lockfree", "none", true);
+    benchStats<Storage, AtomicBitmapFreeList, NoSync, AtomicCountingStats>(storage, "atomicbmp", "none", true);
+}
+
+// Ticks per allocate+free per thread, best round, numThreads threads on one pool
+template <class Pool>
+static double benchThreads(Pool* pool, int numThreads) {
+    uint64_t best = UINT64_MAX;
+    for (int round = 0; round < BENCH_ROUNDS / 4; ++round) {
+        pthread_t threads[BENCH_MAX_THREADS];
+        uint64_t start = benchTicks();
+        for (int t = 0; t < numThreads; ++t) pthread_create(&threads[t], NULL, allocFreeLoop<Pool>, pool);
+        for (int t = 0; t < numThreads; ++t) pthread_join(threads[t], NULL);
+        uint64_t ticks = benchTicks() - start;
+        if (ticks < best) best = ticks;
+    }
+    return (double)best / ((double)BENCH_ITERATIONS * BURST * numThreads);
+}
+
+// Lock-free shared head against the atomic bitmap, locked list for reference
+static void benchScaling(void) {
+    typedef HeapStorage<BENCH_BLOCK_SIZE, BENCH_NUM_BLOCKS> S;
+    BasicPool<S, LockFreeList, NoSync>* lockFree = new BasicPool<S, LockFreeList, NoSync>;
+    BasicPool<S, AtomicBitmapFreeList, NoSync>* atomicBitmap = new BasicPool<S, AtomicBitmapFreeList, NoSync>;
+    BasicPool<S, ListFreeList, SpinSync>* spinList = new BasicPool<S, ListFreeList, SpinSync>;
+
+    printf("\n[BENCH] Scaling, ticks per allocate+free per thread\n");
+    printf("%-8s %10s %10s %10s\n", "threads", "lockfree", "atomicbmp", "list+spin");
+    for (int numThreads = 1; numThreads <= BENCH_MAX_THREADS; numThreads *= 2) {
+        printf("%-8d %10.2f %10.2f %10.2f\n", numThreads, benchThreads(lockFree, numThreads),
+               benchThreads(atomicBitmap, numThreads), benchThreads(spinList, numThreads));
+    }
+    delete lockFree;
+    delete atomicBitmap;
+    delete spinList;
+}
+
+// A hot function taking BURST temporary blocks: from a shared spin-locked MemoryPool_t, or
+// from an InlinePool on its stack that overflows to it one time in four
+static void* NOINLINE_ATTR tempBlocksShared(MemoryPool_t* shared) {
+    void* blocks[BURST];
+    for (int j = 0; j < BURST; ++j) blocks[j] = allocateBlock(shared);
+    void* first = blocks[0];
+    for (int j = BURST - 1; j >= 0; --j) freeBlock(shared, blocks[j]);
+    return first;
+}
+
+static void* NOINLINE_ATTR tempBlocksInline(MemoryPool_t* shared) {
+    InlinePool<BENCH_BLOCK_SIZE, BURST - 1> local(shared);
+    void* blocks[BURST];
+    for (int j = 0; j < BURST; ++j) blocks[j] = local.allocate();
+    void* first = blocks[0];
+    for (int j = BURST - 1; j >= 0; --j) local.free(blocks[j]);
+    return first;
+}
+
+static void benchInline(void) {
+    MemoryPool_t* shared = createMemoryPoolEx(BENCH_BLOCK_SIZE, BENCH_BLOCK_SIZE * BENCH_NUM_BLOCKS, MEM_POOL_LOCK_SPIN);
+    assert(shared != NULL);
+    void* volatile sink;
+    uint64_t best = UINT64_MAX, bestInline = UINT64_MAX;
+    for (int round = 0; round < BENCH_ROUNDS; ++round) {
+        uint64_t start = benchTicks();
+        for (int i = 0; i < BENCH_ITERATIONS; ++i) sink = tempBlocksShared(shared);
+        uint64_t ticks = benchTicks() - start;
+        if (ticks < best) best = ticks;
+
+        start = benchTicks();
+        for (int i = 0; i < BENCH_ITERATIONS; ++i) sink = tempBlocksInline(shared);
+        ticks = benchTicks() - start;
+        if (ticks < bestInline) bestInline = ticks;
+    }
+    (void)sink;
+
+    printf("\n[BENCH] %d temporary blocks per call, ticks per allocate+free\n", BURST);
+    printf("shared spin pool %10.2f\ninline + overflow %10.2f\n", (double)best / ((double)BENCH_ITERATIONS * BURST),
+           (double)bestInline / ((double)BENCH_ITERATIONS * BURST));
+    destroyMemoryPool(shared);
+}
+
+int main(void) {
+    printf("[BENCH] BasicPool matrix, %d-byte blocks, ticks per allocate+free\n", BENCH_BLOCK_SIZE);
+    printf("%-7s %-9s %-6s %-5s %10s %10s\n", "storage", "freelist", "sync", "stats", "1 thread",
+           "4 threads");
+    benchStorage<StaticStorage>("static");
+    benchStorage<HeapStorage>("heap");
+#if MEM_POOL_BASIC_MMAP
+    benchStorage<MmapStorage>("mmap");
+#endif
+    benchScaling();
+    benchInline();
+    return 0;
+}
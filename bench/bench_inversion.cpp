@@ -0,0 +1,161 @@
+// Priority inversion on a locked pool: worst-case blocking of a high-priority allocator.
+//
+// Three SCHED_FIFO threads share one CPU. Every period the low-priority thread starts a
+// long bulk allocation (allocateBlocks under the pool lock) just before the high and
+// medium threads wake together. The high thread preempts it, asks for one block and
+// blocks on the lock. Without priority inheritance the medium thread, a CPU hog, now
+// runs before the lock holder and the high thread waits for the whole burst; with
+// MEM_POOL_LOCK_PI_MUTEX the holder is raised, finishes the batch and the high thread
+// only waits for the rest of the critical section. Needs SCHED_FIFO (root or
+// CAP_SYS_NICE). Linux only.
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE // CPU affinity
+#endif
+
+#include "mem_pool.h"
+#include "bench_ticks.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#define INVERSION_PERIODS      100
+#define INVERSION_PERIOD_NS    20000000LL  // 20 ms
+#define INVERSION_BURST_NS     5000000LL   // Medium thread spins this long per period
+#define INVERSION_BLOCK_SIZE   64
+#define INVERSION_POOL_BLOCKS  65536
+#define INVERSION_PRIO_LOW     10
+#define INVERSION_PRIO_MEDIUM  20
+#define INVERSION_PRIO_HIGH    30
+
+typedef struct InversionRun_s {
+    MemoryPool_t* pool;
+    void** batch;                   // Low thread's bulk allocation
+    struct timespec origin;         // Period k starts at origin + k * period
+    long long leadNs;               // Low thread starts this much before the period
+    uint64_t waitNs[INVERSION_PERIODS];
+    int fifo;                       // Every thread got SCHED_FIFO
+} InversionRun_t;
+
+// *****Local functions*****
+
+static long long elapsedNs(const struct timespec* from, const struct timespec* to) {
+    return (to->tv_sec - from->tv_sec) * 1000000000LL + (to->tv_nsec - from->tv_nsec);
+}
+
+static struct timespec periodStart(const InversionRun_t* run, int period, long long offsetNs) {
+    long long ns = run->origin.tv_nsec + (long long)period * INVERSION_PERIOD_NS + offsetNs;
+    struct timespec at;
+    at.tv_sec = run->origin.tv_sec + (time_t)(ns / 1000000000LL);
+    at.tv_nsec = (long)(ns % 1000000000LL);
+    return at;
+}
+
+static void enterFifo(InversionRun_t* run, int priority) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(0, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    struct sched_param param;
+    param.sched_priority = priority;
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) {
+        __atomic_store_n(&run->fifo, 0, __ATOMIC_RELAXED);
+    }
+}
+
+static void* lowThread(void* arg) {
+    InversionRun_t* run = (InversionRun_t*)arg;
+    enterFifo(run, INVERSION_PRIO_LOW);
+    for (int period = 0; period < INVERSION_PERIODS; ++period) {
+        struct timespec at = periodStart(run, period, -run->leadNs);
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &at, NULL);
+        size_t count = allocateBlocks(run->pool, run->batch, INVERSION_POOL_BLOCKS);
+        freeBlocks(run->pool, run->batch, count);
+    }
+    return NULL;
+}
+
+static void* mediumThread(void* arg) {
+    InversionRun_t* run = (InversionRun_t*)arg;
+    enterFifo(run, INVERSION_PRIO_MEDIUM);
+    for (int period = 0; period < INVERSION_PERIODS; ++period) {
+        struct timespec at = periodStart(run, period, 0);
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &at, NULL);
+        struct timespec now;
+        do {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+        } while (elapsedNs(&at, &now) < INVERSION_BURST_NS);
+    }
+    return NULL;
+}
+
+static void* highThread(void* arg) {
+    InversionRun_t* run = (InversionRun_t*)arg;
+    enterFifo(run, INVERSION_PRIO_HIGH);
+    for (int period = 0; period < INVERSION_PERIODS; ++period) {
+        struct timespec at = periodStart(run, period, 0);
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &at, NULL);
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        void* block = allocateBlock(run->pool);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        freeBlock(run->pool, block);
+        run->waitNs[period] = (uint64_t)elapsedNs(&t0, &t1);
+    }
+    return NULL;
+}
+
+static int compareNs(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static void bench_inversion(const char* variant, MemoryPoolLock_t lockType, void** batch) {
+    InversionRun_t run;
+    run.pool = createMemoryPoolEx(INVERSION_BLOCK_SIZE, INVERSION_BLOCK_SIZE * INVERSION_POOL_BLOCKS, lockType);
+    assert(run.pool != NULL);
+    run.batch = batch;
+    run.fifo = 1;
+
+    // Start the batch half its duration before the period, so the high thread lands inside
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    size_t count = allocateBlocks(run.pool, batch, INVERSION_POOL_BLOCKS);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    freeBlocks(run.pool, batch, count);
+    run.leadNs = elapsedNs(&t0, &t1) / 2;
+
+    clock_gettime(CLOCK_MONOTONIC, &run.origin);
+    run.origin.tv_sec += 1;
+    pthread_t threads[3];
+    pthread_create(&threads[0], NULL, lowThread, &run);
+    pthread_create(&threads[1], NULL, mediumThread, &run);
+    pthread_create(&threads[2], NULL, highThread, &run);
+    for (int i = 0; i < 3; ++i) pthread_join(threads[i], NULL);
+    destroyMemoryPool(run.pool);
+
+    if (!run.fifo) printf("[INVERSION] warning: SCHED_FIFO not granted, no inversion can be shown\n");
+    qsort(run.waitNs, INVERSION_PERIODS, sizeof(uint64_t), compareNs);
+    size_t inverted = 0;
+    for (int i = 0; i < INVERSION_PERIODS; ++i) inverted += run.waitNs[i] >= INVERSION_BURST_NS / 2;
+    printf("[INVERSION] %-8s batch %6.1f us  high wait median %8.1f us  max %8.1f us  inverted %u/%d\n", variant,
+           (double)run.leadNs * 2 / 1000.0, (double)run.waitNs[INVERSION_PERIODS / 2] / 1000.0,
+           (double)run.waitNs[INVERSION_PERIODS - 1] / 1000.0, (unsigned)inverted, INVERSION_PERIODS);
+}
+
+int main(void) {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        printf("[INVERSION] warning: mlockall failed, page faults will show up as latency\n");
+    }
+    void** batch = (void**)calloc(INVERSION_POOL_BLOCKS, sizeof(void*));
+    assert(batch != NULL);
+    printf("[INVERSION] medium burst %.1f ms, period %.1f ms\n", INVERSION_BURST_NS / 1e6, INVERSION_PERIOD_NS / 1e6);
+    bench_inversion("mutex", MEM_POOL_LOCK_MUTEX, batch);
+    bench_inversion("pi-mutex", MEM_POOL_LOCK_PI_MUTEX, batch);
+    free(batch);
+    return 0;
+}
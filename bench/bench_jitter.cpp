@@ -0,0 +1,166 @@
+// Worst-case latency of allocateBlock/freeBlock for a real-time control loop.
+// The measuring thread runs SCHED_FIFO, pinned to the last CPU, with all memory locked;
+// for a certification run boot with isolcpus=<that cpu> and run as root. Interference
+// threads on the remaining CPUs thrash the caches and, for locked pools, allocate from
+// the same pool. The PI mutex run shows what priority inheritance buys over the plain
+// mutex: a preempted interference thread holding the lock runs at the measuring
+// thread's priority until it lets go. Linux only.
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE // CPU affinity
+#endif
+
+#include "mem_pool.h"
+#include "bench_ticks.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define JITTER_SAMPLES      1000000
+#define JITTER_POOL_BLOCKS  1024
+#define JITTER_HELD_BLOCKS  8        // Blocks each interference thread keeps live
+#define JITTER_THRASH_BYTES (32u << 20)
+#define JITTER_RT_PRIORITY  80
+
+typedef struct JitterRun_s {
+    MemoryPool_t* pool;
+    uint32_t* allocTicks;
+    uint32_t* freeTicks;
+    volatile int stop;
+    int contend;                     // Interference threads may use the pool
+    int fifo;                        // SCHED_FIFO was granted
+} JitterRun_t;
+
+static void pinThread(pthread_t thread, int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(thread, sizeof(set), &set);
+}
+
+static void* jitterInterference(void* arg) {
+    JitterRun_t* run = (JitterRun_t*)arg;
+    volatile char* buffer = (volatile char*)malloc(JITTER_THRASH_BYTES);
+    void* held[JITTER_HELD_BLOCKS] = { NULL };
+    size_t pos = 0;
+    unsigned slot = 0;
+
+    while (!run->stop) {
+        // Dirty a few cache lines per pool operation, evicting the measured thread's data
+        for (int i = 0; i < 64; ++i) {
+            buffer[pos]++;
+            pos = (pos + 4096 + 64) % JITTER_THRASH_BYTES;
+        }
+        if (run->contend) {
+            freeBlock(run->pool, held[slot]);
+            held[slot] = allocateBlock(run->pool);
+            slot = (slot + 1) % JITTER_HELD_BLOCKS;
+        }
+    }
+    if (run->contend) {
+        for (unsigned i = 0; i < JITTER_HELD_BLOCKS; ++i) freeBlock(run->pool, held[i]);
+    }
+    free((void*)buffer);
+    return NULL;
+}
+
+static void* jitterMeasure(void* arg) {
+    JitterRun_t* run = (JitterRun_t*)arg;
+    struct sched_param param;
+    param.sched_priority = JITTER_RT_PRIORITY;
+    run->fifo = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+
+    for (uint32_t i = 0; i < JITTER_SAMPLES; ++i) {
+        uint64_t t0 = benchTicks();
+        void* block = allocateBlock(run->pool);
+        uint64_t t1 = benchTicks();
+        freeBlock(run->pool, block);
+        uint64_t t2 = benchTicks();
+        run->allocTicks[i] = (uint32_t)(t1 - t0);
+        run->freeTicks[i] = (uint32_t)(t2 - t1);
+    }
+    return NULL;
+}
+
+static int compareTicks(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// benchTicks per nanosecond, measured against CLOCK_MONOTONIC
+static double ticksPerNs(void) {
+    struct timespec a, b;
+    clock_gettime(CLOCK_MONOTONIC, &a);
+    uint64_t t0 = benchTicks();
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &b);
+    } while ((b.tv_sec - a.tv_sec) * 1000000000LL + (b.tv_nsec - a.tv_nsec) < 50000000LL);
+    uint64_t t1 = benchTicks();
+    return (double)(t1 - t0) / (double)((b.tv_sec - a.tv_sec) * 1000000000LL + (b.tv_nsec - a.tv_nsec));
+}
+
+static void reportJitter(const char* variant, const char* op, uint32_t* ticks, double scale) {
+    qsort(ticks, JITTER_SAMPLES, sizeof(uint32_t), compareTicks);
+    size_t p99999 = (size_t)((double)JITTER_SAMPLES * 0.99999);
+    printf("[JITTER] %-6s %-5s median %8.1f ns  p99.999 %8.1f ns  max %8.1f ns\n", variant, op,
+           ticks[JITTER_SAMPLES / 2] / scale, ticks[p99999] / scale, ticks[JITTER_SAMPLES - 1] / scale);
+}
+
+static void bench_jitter(size_t blockSize) {
+    static const char* const variantNames[] = { "none", "spin", "mutex", "pi" };
+    long numCpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int rtCpu = (int)numCpus - 1;
+    int numInterference = numCpus > 1 ? (int)numCpus - 1 : 1;
+    double scale = ticksPerNs();
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        printf("[JITTER] warning: mlockall failed, page faults will show up as latency\n");
+    }
+
+    JitterRun_t run;
+    run.allocTicks = (uint32_t*)malloc(JITTER_SAMPLES * sizeof(uint32_t));
+    run.freeTicks = (uint32_t*)malloc(JITTER_SAMPLES * sizeof(uint32_t));
+    assert(run.allocTicks && run.freeTicks);
+    // Prefault the sample buffers before the measured loop
+    memset(run.allocTicks, 0, JITTER_SAMPLES * sizeof(uint32_t));
+    memset(run.freeTicks, 0, JITTER_SAMPLES * sizeof(uint32_t));
+
+    for (int lockType = MEM_POOL_LOCK_NONE; lockType <= MEM_POOL_LOCK_PI_MUTEX; ++lockType) {
+        run.pool = createMemoryPoolEx(blockSize, blockSize * JITTER_POOL_BLOCKS, (MemoryPoolLock_t)lockType);
+        assert(run.pool != NULL);
+        run.stop = 0;
+        run.contend = lockType != MEM_POOL_LOCK_NONE; // An unlocked pool has a single owner
+
+        pthread_t interference[64];
+        if (numInterference > 64) numInterference = 64;
+        for (int i = 0; i < numInterference; ++i) {
+            pthread_create(&interference[i], NULL, jitterInterference, &run);
+            if (numCpus > 1) pinThread(interference[i], i % rtCpu);
+        }
+
+        pthread_t measure;
+        pthread_create(&measure, NULL, jitterMeasure, &run);
+        pinThread(measure, rtCpu);
+        pthread_join(measure, NULL);
+
+        run.stop = 1;
+        for (int i = 0; i < numInterference; ++i) pthread_join(interference[i], NULL);
+        destroyMemoryPool(run.pool);
+
+        if (!run.fifo) printf("[JITTER] warning: SCHED_FIFO not granted, results are not certifiable\n");
+        reportJitter(variantNames[lockType], "alloc", run.allocTicks, scale);
+        reportJitter(variantNames[lockType], "free", run.freeTicks, scale);
+    }
+
+    free(run.allocTicks);
+    free(run.freeTicks);
+}
+
+int main(void) {
+    bench_jitter(MEM_BLOCK_SIZE);
+    return 0;
+}
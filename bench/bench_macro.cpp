@@ -0,0 +1,614 @@
+// Macrobenchmarks: production-like workloads against every allocator variant and malloc.
+//
+//   broker  producer -> relay -> consumer hops over bounded queues; every hop allocates
+//           the outgoing message and frees the incoming one, so frees cross threads
+//   lru     hash + LRU list cache with skewed keys; misses insert, a full cache evicts
+//   tree    unbalanced search tree of random keys, built, walked and torn down
+//   ecs     entities with separately allocated components, ticked; a share despawns and
+//           respawns every tick
+//
+// Reported per run: throughput (work units per second), latency percentiles of a work
+// unit in ticks (bench_ticks.h; every unit of lru/tree/ecs, every producer send of
+// broker), peak RSS and last-level cache misses from perf_event_open ("n/a" where perf
+// is not permitted). Every run is a child process of its own, so the peak RSS
+// (ru_maxrss) covers just that run on top of the small common baseline.
+// Variants without a lock skip the threaded broker.
+
+#include "mem_pool.h"
+#include "mem_pool_basic.h"
+#include "mem_pool_cache.h"
+#include "mem_pool_ring.h"
+#include "bench_ticks.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include <vector>
+
+using namespace mem_pool;
+
+// *****Local defines*****
+
+#define MACRO_BLOCK_SIZE    128
+#define MACRO_NUM_BLOCKS    65536
+#define MACRO_CACHE_LIMIT   32
+
+#define BROKER_MESSAGES     100000
+#define BROKER_QUEUE_SIZE   256
+#define BROKER_PRODUCERS    2
+#define LRU_CAPACITY        16384
+#define LRU_KEYS            65536
+#define LRU_OPS             1000000
+#define LRU_BUCKETS         32768
+#define TREE_NODES          50000
+#define TREE_ROUNDS         6
+#define ECS_ENTITIES        20000
+#define ECS_TICKS           300
+#define ECS_CHURN_PERCENT   2
+
+// *****Allocator variants*****
+
+// shared is the variant's allocator; each thread works through its own handle from attach
+typedef struct BenchVariant_s {
+    const char* name;
+    int threadSafe;
+    void* (*create)(void);
+    void (*destroy)(void* shared);
+    void* (*attach)(void* shared);
+    void (*detach)(void* handle);
+    void* (*allocate)(void* handle);
+    void (*release)(void* handle, void* block);
+} BenchVariant_t;
+
+static void* noAttach(void* shared) { return shared; }
+static void noDetach(void*) {}
+
+static void* mallocCreate(void) { return (void*)1; }
+static void mallocDestroy(void*) {}
+static void* mallocAllocate(void*) { return malloc(MACRO_BLOCK_SIZE); }
+static void mallocRelease(void*, void* block) { free(block); }
+
+template <MemoryPoolLock_t LockType>
+static void* poolCreate(void) {
+    return createMemoryPoolEx(MACRO_BLOCK_SIZE, MACRO_BLOCK_SIZE * MACRO_NUM_BLOCKS, LockType);
+}
+static void poolDestroy(void* shared) { destroyMemoryPool((MemoryPool_t*)shared); }
+static void* poolAllocate(void* handle) { return allocateBlock((MemoryPool_t*)handle); }
+static void poolRelease(void* handle, void* block) { freeBlock((MemoryPool_t*)handle, block); }
+
+// Per-thread caches over the locked pool or over the ring
+static void* cachedCreate(void) {
+    MemoryPool_t* pool = (MemoryPool_t*)poolCreate<MEM_POOL_LOCK_SPIN>();
+    if (pool) memPoolSetCacheLimit(pool, MACRO_CACHE_LIMIT);
+    return pool;
+}
+static void* cachedAttach(void* shared) {
+    MemoryPoolCache_t* cache = (MemoryPoolCache_t*)malloc(sizeof(MemoryPoolCache_t));
+    memPoolCacheInit(cache, (MemoryPool_t*)shared);
+    return cache;
+}
+static void cachedDetach(void* handle) {
+    memPoolCacheFlush((MemoryPoolCache_t*)handle);
+    free(handle);
+}
+static void* cachedAllocate(void* handle) { return allocateBlockCached((MemoryPoolCache_t*)handle); }
+static void cachedRelease(void* handle, void* block) { freeBlockCached((MemoryPoolCache_t*)handle, block); }
+
+static void* ringCreate(void) { return memPoolRingCreate((MemoryPool_t*)cachedCreate()); }
+static void ringDestroy(void* shared) {
+    MemoryPool_t* pool = ((MemoryPoolRing_t*)shared)->pool;
+    memPoolRingDestroy((MemoryPoolRing_t*)shared);
+    destroyMemoryPool(pool);
+}
+static void* ringAttach(void* shared) {
+    MemoryPoolCache_t* cache = (MemoryPoolCache_t*)malloc(sizeof(MemoryPoolCache_t));
+    memPoolCacheInitRing(cache, (MemoryPoolRing_t*)shared);
+    return cache;
+}
+
+template <class Pool>
+static void* basicCreate(void) {
+    Pool* pool = new Pool;
+    if (pool->valid()) return pool;
+    delete pool;
+    return NULL;
+}
+template <class Pool>
+static void basicDestroy(void* shared) { delete (Pool*)shared; }
+template <class Pool>
+static void* basicAllocate(void* handle) { return ((Pool*)handle)->allocate(); }
+template <class Pool>
+static void basicRelease(void* handle, void* block) { ((Pool*)handle)->free(block); }
+
+typedef HeapStorage<MACRO_BLOCK_SIZE, MACRO_NUM_BLOCKS> MacroStorage;
+typedef BasicPool<MacroStorage, LockFreeList, NoSync> LockFreePool;
+typedef BasicPool<MacroStorage, AtomicBitmapFreeList, NoSync> AtomicBitmapPool;
+
+static const BenchVariant_t variants[] = {
+    { "malloc", 1, mallocCreate, mallocDestroy, noAttach, noDetach, mallocAllocate, mallocRelease },
+    { "pool", 0, poolCreate<MEM_POOL_LOCK_NONE>, poolDestroy, noAttach, noDetach, poolAllocate, poolRelease },
+    { "pool+spin", 1, poolCreate<MEM_POOL_LOCK_SPIN>, poolDestroy, noAttach, noDetach, poolAllocate, poolRelease },
+    { "pool+mutex", 1, poolCreate<MEM_POOL_LOCK_MUTEX>, poolDestroy, noAttach, noDetach, poolAllocate, poolRelease },
+    { "pool+cache", 1, cachedCreate, poolDestroy, cachedAttach, cachedDetach, cachedAllocate, cachedRelease },
+    { "ring+cache", 1, ringCreate, ringDestroy, ringAttach, cachedDetach, cachedAllocate, cachedRelease },
+    { "lockfree", 1, basicCreate<LockFreePool>, basicDestroy<LockFreePool>, noAttach, noDetach,
+      basicAllocate<LockFreePool>, basicRelease<LockFreePool> },
+    { "atomicbmp", 1, basicCreate<AtomicBitmapPool>, basicDestroy<AtomicBitmapPool>, noAttach, noDetach,
+      basicAllocate<AtomicBitmapPool>, basicRelease<AtomicBitmapPool> },
+};
+
+// *****Measurement*****
+
+typedef struct BenchRun_s {
+    const BenchVariant_t* variant;
+    void* shared;
+    std::vector<uint64_t> latencies;    // Ticks per work unit
+    size_t units;
+    uint64_t checksum;                  // Keeps the work observable
+} BenchRun_t;
+
+static uint64_t wallNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Counts this thread and the threads it creates afterwards; -1 if not permitted
+static int openCacheMisses(void) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    return fd;
+}
+
+static long long closeCacheMisses(int fd) {
+    if (fd < 0) return -1;
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    long long count = -1;
+    if (read(fd, &count, sizeof(count)) != (ssize_t)sizeof(count)) count = -1;
+    close(fd);
+    return count;
+}
+
+static uint64_t percentile(std::vector<uint64_t>& values, double share) {
+    if (values.empty()) return 0;
+    size_t index = (size_t)(share * (double)(values.size() - 1));
+    std::nth_element(values.begin(), values.begin() + (long)index, values.end());
+    return values[index];
+}
+
+// Small deterministic generator, one per thread
+static uint32_t nextRandom(uint32_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+// *****Broker*****
+
+typedef struct BrokerQueue_s {
+    pthread_mutex_t mutex;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+    void* items[BROKER_QUEUE_SIZE];
+    size_t head;
+    size_t count;
+    int producers;              // Still sending; 0 and empty: done
+} BrokerQueue_t;
+
+typedef struct BrokerMessage_s {
+    uint64_t sequence;
+    uint32_t hops;
+    char payload[MACRO_BLOCK_SIZE - sizeof(uint64_t) - sizeof(uint32_t) - sizeof(uint32_t)];
+    uint32_t check;
+} BrokerMessage_t;
+
+typedef struct BrokerContext_s {
+    BenchRun_t* run;
+    BrokerQueue_t* in;
+    BrokerQueue_t* out;
+    int producer;
+    std::vector<uint64_t> latencies;
+    uint64_t checksum;
+} BrokerContext_t;
+
+static void queueInit(BrokerQueue_t* queue, int producers) {
+    pthread_mutex_init(&queue->mutex, NULL);
+    pthread_cond_init(&queue->notEmpty, NULL);
+    pthread_cond_init(&queue->notFull, NULL);
+    queue->head = queue->count = 0;
+    queue->producers = producers;
+}
+
+static void queueDestroy(BrokerQueue_t* queue) {
+    pthread_cond_destroy(&queue->notFull);
+    pthread_cond_destroy(&queue->notEmpty);
+    pthread_mutex_destroy(&queue->mutex);
+}
+
+static void queuePush(BrokerQueue_t* queue, void* item) {
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->count == BROKER_QUEUE_SIZE) pthread_cond_wait(&queue->notFull, &queue->mutex);
+    queue->items[(queue->head + queue->count++) % BROKER_QUEUE_SIZE] = item;
+    pthread_cond_signal(&queue->notEmpty);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+// NULL once every producer is done and the queue is empty
+static void* queuePop(BrokerQueue_t* queue) {
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->count == 0 && queue->producers) pthread_cond_wait(&queue->notEmpty, &queue->mutex);
+    void* item = NULL;
+    if (queue->count) {
+        item = queue->items[queue->head];
+        queue->head = (queue->head + 1) % BROKER_QUEUE_SIZE;
+        --queue->count;
+        pthread_cond_signal(&queue->notFull);
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    return item;
+}
+
+static void queueClose(BrokerQueue_t* queue) {
+    pthread_mutex_lock(&queue->mutex);
+    --queue->producers;
+    pthread_cond_broadcast(&queue->notEmpty);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+static void* brokerProducer(void* arg) {
+    BrokerContext_t* ctx = (BrokerContext_t*)arg;
+    const BenchVariant_t* variant = ctx->run->variant;
+    void* handle = variant->attach(ctx->run->shared);
+    for (uint64_t i = 0; i < BROKER_MESSAGES / BROKER_PRODUCERS; ++i) {
+        uint64_t start = benchTicks();
+        BrokerMessage_t* msg;
+        while ((msg = (BrokerMessage_t*)variant->allocate(handle)) == NULL) sched_yield();
+        msg->sequence = i;
+        msg->hops = 0;
+        memset(msg->payload, (int)(i & 0xFF), sizeof(msg->payload));
+        msg->check = (uint32_t)i;
+        queuePush(ctx->out, msg);
+        ctx->latencies.push_back(benchTicks() - start);
+    }
+    queueClose(ctx->out);
+    variant->detach(handle);
+    return NULL;
+}
+
+// Relay: copy into a fresh message, free the incoming one (allocated by another thread)
+static void* brokerRelay(void* arg) {
+    BrokerContext_t* ctx = (BrokerContext_t*)arg;
+    const BenchVariant_t* variant = ctx->run->variant;
+    void* handle = variant->attach(ctx->run->shared);
+    BrokerMessage_t* msg;
+    while ((msg = (BrokerMessage_t*)queuePop(ctx->in)) != NULL) {
+        BrokerMessage_t* copy;
+        while ((copy = (BrokerMessage_t*)variant->allocate(handle)) == NULL) sched_yield();
+        memcpy(copy, msg, sizeof(*copy));
+        ++copy->hops;
+        variant->release(handle, msg);
+        queuePush(ctx->out, copy);
+    }
+    queueClose(ctx->out);
+    variant->detach(handle);
+    return NULL;
+}
+
+static void* brokerConsumer(void* arg) {
+    BrokerContext_t* ctx = (BrokerContext_t*)arg;
+    const BenchVariant_t* variant = ctx->run->variant;
+    void* handle = variant->attach(ctx->run->shared);
+    BrokerMessage_t* msg;
+    while ((msg = (BrokerMessage_t*)queuePop(ctx->in)) != NULL) {
+        assert(msg->hops == 1 && msg->check == (uint32_t)msg->sequence);
+        ctx->checksum += msg->sequence + (unsigned char)msg->payload[0];
+        variant->release(handle, msg);
+    }
+    variant->detach(handle);
+    return NULL;
+}
+
+static void runBroker(BenchRun_t* run) {
+    BrokerQueue_t requests, deliveries;
+    queueInit(&requests, BROKER_PRODUCERS);
+    queueInit(&deliveries, 1);
+
+    BrokerContext_t producers[BROKER_PRODUCERS];
+    BrokerContext_t relay, consumer;
+    pthread_t threads[BROKER_PRODUCERS + 2];
+    for (int i = 0; i < BROKER_PRODUCERS; ++i) {
+        producers[i].run = run;
+        producers[i].in = NULL;
+        producers[i].out = &requests;
+        producers[i].latencies.reserve(BROKER_MESSAGES / BROKER_PRODUCERS);
+        pthread_create(&threads[i], NULL, brokerProducer, &producers[i]);
+    }
+    relay.run = run;
+    relay.in = &requests;
+    relay.out = &deliveries;
+    pthread_create(&threads[BROKER_PRODUCERS], NULL, brokerRelay, &relay);
+    consumer.run = run;
+    consumer.in = &deliveries;
+    consumer.out = NULL;
+    consumer.checksum = 0;
+    pthread_create(&threads[BROKER_PRODUCERS + 1], NULL, brokerConsumer, &consumer);
+    for (int i = 0; i < BROKER_PRODUCERS + 2; ++i) pthread_join(threads[i], NULL);
+
+    for (int i = 0; i < BROKER_PRODUCERS; ++i) {
+        run->latencies.insert(run->latencies.end(), producers[i].latencies.begin(), producers[i].latencies.end());
+    }
+    run->units = BROKER_MESSAGES / BROKER_PRODUCERS * BROKER_PRODUCERS;
+    run->checksum = consumer.checksum;
+    queueDestroy(&requests);
+    queueDestroy(&deliveries);
+}
+
+// *****LRU cache*****
+
+typedef struct LruEntry_s {
+    uint32_t key;
+    uint32_t value;
+    struct LruEntry_s* prev;    // LRU list, head is the most recent
+    struct LruEntry_s* next;
+    struct LruEntry_s* chain;   // Hash bucket
+} LruEntry_t;
+
+static void lruUnlink(LruEntry_t** head, LruEntry_t** tail, LruEntry_t* entry) {
+    if (entry->prev) entry->prev->next = entry->next;
+    else *head = entry->next;
+    if (entry->next) entry->next->prev = entry->prev;
+    else *tail = entry->prev;
+}
+
+static void lruPushFront(LruEntry_t** head, LruEntry_t** tail, LruEntry_t* entry) {
+    entry->prev = NULL;
+    entry->next = *head;
+    if (*head) (*head)->prev = entry;
+    else *tail = entry;
+    *head = entry;
+}
+
+static void runLru(BenchRun_t* run) {
+    const BenchVariant_t* variant = run->variant;
+    void* handle = variant->attach(run->shared);
+    LruEntry_t** buckets = (LruEntry_t**)calloc(LRU_BUCKETS, sizeof(LruEntry_t*));
+    LruEntry_t* head = NULL;
+    LruEntry_t* tail = NULL;
+    size_t count = 0;
+    uint32_t seed = 12345;
+    run->latencies.reserve(LRU_OPS);
+
+    for (size_t op = 0; op < LRU_OPS; ++op) {
+        uint64_t start = benchTicks();
+        // Product of two uniforms: small keys are hot
+        uint32_t key = (uint32_t)((uint64_t)(nextRandom(&seed) % LRU_KEYS) * (nextRandom(&seed) % LRU_KEYS) / LRU_KEYS);
+        LruEntry_t** slot = &buckets[key % LRU_BUCKETS];
+        LruEntry_t* entry = *slot;
+        while (entry && entry->key != key) entry = entry->chain;
+        if (entry) {
+            lruUnlink(&head, &tail, entry);
+            lruPushFront(&head, &tail, entry);
+            run->checksum += entry->value;
+        } else {
+            if (count == LRU_CAPACITY) {
+                LruEntry_t* victim = tail;
+                lruUnlink(&head, &tail, victim);
+                LruEntry_t** link = &buckets[victim->key % LRU_BUCKETS];
+                while (*link != victim) link = &(*link)->chain;
+                *link = victim->chain;
+                variant->release(handle, victim);
+                --count;
+            }
+            entry = (LruEntry_t*)variant->allocate(handle);
+            assert(entry != NULL);
+            entry->key = key;
+            entry->value = key * 2654435761u;
+            entry->chain = *slot;
+            *slot = entry;
+            lruPushFront(&head, &tail, entry);
+            ++count;
+        }
+        run->latencies.push_back(benchTicks() - start);
+    }
+
+    while (head) {
+        LruEntry_t* next = head->next;
+        variant->release(handle, head);
+        head = next;
+    }
+    free(buckets);
+    variant->detach(handle);
+    run->units = LRU_OPS;
+}
+
+// *****Tree builder*****
+
+typedef struct TreeNode_s {
+    uint64_t key;
+    struct TreeNode_s* left;
+    struct TreeNode_s* right;
+} TreeNode_t;
+
+static void runTree(BenchRun_t* run) {
+    const BenchVariant_t* variant = run->variant;
+    void* handle = variant->attach(run->shared);
+    TreeNode_t** stack = (TreeNode_t**)malloc(TREE_NODES * sizeof(TreeNode_t*));
+    uint32_t seed = 777;
+    run->latencies.reserve((size_t)TREE_NODES * TREE_ROUNDS);
+
+    for (int round = 0; round < TREE_ROUNDS; ++round) {
+        TreeNode_t* root = NULL;
+        for (size_t i = 0; i < TREE_NODES; ++i) {
+            uint64_t start = benchTicks();
+            TreeNode_t* node = (TreeNode_t*)variant->allocate(handle);
+            assert(node != NULL);
+            node->key = ((uint64_t)nextRandom(&seed) << 32) | nextRandom(&seed);
+            node->left = node->right = NULL;
+            TreeNode_t** link = &root;
+            while (*link) link = node->key < (*link)->key ? &(*link)->left : &(*link)->right;
+            *link = node;
+            run->latencies.push_back(benchTicks() - start);
+        }
+
+        // Walk and tear down in one pass
+        size_t depth = 0;
+        if (root) stack[depth++] = root;
+        while (depth) {
+            TreeNode_t* node = stack[--depth];
+            run->checksum += node->key >> 48;
+            if (node->left) stack[depth++] = node->left;
+            if (node->right) stack[depth++] = node->right;
+            variant->release(handle, node);
+        }
+    }
+    free(stack);
+    variant->detach(handle);
+    run->units = (size_t)TREE_NODES * TREE_ROUNDS;
+}
+
+// *****ECS tick*****
+
+typedef struct EcsVector_s {
+    float x, y, z;
+} EcsVector_t;
+
+typedef struct EcsEntity_s {
+    EcsVector_t* position;
+    EcsVector_t* velocity;
+    uint32_t id;
+} EcsEntity_t;
+
+static EcsEntity_t* ecsSpawn(const BenchVariant_t* variant, void* handle, uint32_t id) {
+    EcsEntity_t* entity = (EcsEntity_t*)variant->allocate(handle);
+    assert(entity != NULL);
+    entity->position = (EcsVector_t*)variant->allocate(handle);
+    entity->velocity = (EcsVector_t*)variant->allocate(handle);
+    assert(entity->position && entity->velocity);
+    entity->id = id;
+    entity->position->x = entity->position->y = entity->position->z = 0.0f;
+    entity->velocity->x = (float)(id % 7);
+    entity->velocity->y = (float)(id % 5);
+    entity->velocity->z = 1.0f;
+    return entity;
+}
+
+static void ecsDespawn(const BenchVariant_t* variant, void* handle, EcsEntity_t* entity) {
+    variant->release(handle, entity->velocity);
+    variant->release(handle, entity->position);
+    variant->release(handle, entity);
+}
+
+static void runEcs(BenchRun_t* run) {
+    const BenchVariant_t* variant = run->variant;
+    void* handle = variant->attach(run->shared);
+    EcsEntity_t** entities = (EcsEntity_t**)malloc(ECS_ENTITIES * sizeof(EcsEntity_t*));
+    uint32_t nextId = 0;
+    uint32_t seed = 4242;
+    for (size_t i = 0; i < ECS_ENTITIES; ++i) entities[i] = ecsSpawn(variant, handle, nextId++);
+    run->latencies.reserve(ECS_TICKS);
+
+    for (int tick = 0; tick < ECS_TICKS; ++tick) {
+        uint64_t start = benchTicks();
+        for (size_t i = 0; i < ECS_ENTITIES; ++i) {
+            EcsEntity_t* entity = entities[i];
+            entity->position->x += entity->velocity->x * 0.016f;
+            entity->position->y += entity->velocity->y * 0.016f;
+            entity->position->z += entity->velocity->z * 0.016f;
+        }
+        for (size_t n = 0; n < ECS_ENTITIES * ECS_CHURN_PERCENT / 100; ++n) {
+            size_t i = nextRandom(&seed) % ECS_ENTITIES;
+            run->checksum += (uint64_t)entities[i]->position->z;
+            ecsDespawn(variant, handle, entities[i]);
+            entities[i] = ecsSpawn(variant, handle, nextId++);
+        }
+        run->latencies.push_back(benchTicks() - start);
+    }
+
+    for (size_t i = 0; i < ECS_ENTITIES; ++i) ecsDespawn(variant, handle, entities[i]);
+    free(entities);
+    variant->detach(handle);
+    run->units = (size_t)ECS_ENTITIES * ECS_TICKS;
+}
+
+// *****Main*****
+
+typedef struct BenchWorkload_s {
+    const char* name;
+    const char* unit;
+    int threaded;
+    void (*run)(BenchRun_t* run);
+} BenchWorkload_t;
+
+static const BenchWorkload_t workloads[] = {
+    { "broker", "msg", 1, runBroker },
+    { "lru", "op", 0, runLru },
+    { "tree", "insert", 0, runTree },
+    { "ecs", "entity", 0, runEcs },
+};
+
+int main(void) {
+    printf("[BENCH] Macrobenchmarks, %d-byte blocks; latency in ticks per work unit (ecs: per tick)\n",
+           MACRO_BLOCK_SIZE);
+    printf("%-8s %-11s %12s %10s %10s %10s %10s %12s\n", "workload", "variant", "units/s", "p50", "p99", "p99.9",
+           "rss KiB", "llc misses");
+
+    for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); ++w) {
+        for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); ++v) {
+            const BenchVariant_t* variant = &variants[v];
+            if (workloads[w].threaded && !variant->threadSafe) continue;
+
+            fflush(stdout);
+            pid_t child = fork();
+            if (child < 0) return 1;
+            if (child > 0) {
+                waitpid(child, NULL, 0);
+                continue;
+            }
+
+            BenchRun_t run;
+            run.variant = variant;
+            run.units = 0;
+            run.checksum = 0;
+            run.shared = variant->create();
+            assert(run.shared != NULL);
+
+            int perfFd = openCacheMisses();
+            uint64_t start = wallNs();
+            workloads[w].run(&run);
+            uint64_t elapsed = wallNs() - start;
+            long long misses = closeCacheMisses(perfFd);
+            struct rusage usage;
+            getrusage(RUSAGE_SELF, &usage);
+            variant->destroy(run.shared);
+
+            char missText[24];
+            if (misses >= 0) snprintf(missText, sizeof(missText), "%lld", misses);
+            else snprintf(missText, sizeof(missText), "n/a");
+            printf("%-8s %-11s %12.0f %10llu %10llu %10llu %10ld %12s\n", workloads[w].name, variant->name,
+                   (double)run.units * 1e9 / (double)elapsed,
+                   (unsigned long long)percentile(run.latencies, 0.50),
+                   (unsigned long long)percentile(run.latencies, 0.99),
+                   (unsigned long long)percentile(run.latencies, 0.999), usage.ru_maxrss, missText);
+            fflush(stdout);
+            _exit(0);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+// Scaling of the shared free-block store behind per-task caches: the pool's locked free
+// list against the lock-free ring (mem_pool_ring.h), 1 to BENCH_MAX_THREADS threads
+
+#include "mem_pool_cache.h"
+#include "mem_pool_ring.h"
+#include "bench_ticks.h"
+
+#include <assert.h>
+
+#define BENCH_ROUNDS      4
+#define BENCH_ITERATIONS  200000
+#define BENCH_MAX_THREADS 8
+#define BENCH_BLOCK_SIZE  64
+#define BENCH_NUM_BLOCKS  4096
+#define BENCH_CACHE_LIMIT 16     // Small enough that refills and drains are frequent
+#define BENCH_HELD        24     // Blocks a thread keeps live, above the limit
+
+typedef struct BenchStore_s {
+    MemoryPool_t* pool;
+    MemoryPoolRing_t* ring;     // NULL: caches refill from the pool
+} BenchStore_t;
+
+static void* cachedLoop(void* arg) {
+    BenchStore_t* store = (BenchStore_t*)arg;
+    MemoryPoolCache_t cache;
+    if (store->ring) memPoolCacheInitRing(&cache, store->ring);
+    else memPoolCacheInit(&cache, store->pool);
+
+    // Allocate a burst larger than the cache, free it: every round trip refills and drains
+    void* blocks[BENCH_HELD];
+    for (int i = 0; i < BENCH_ITERATIONS / BENCH_HELD; ++i) {
+        for (int j = 0; j < BENCH_HELD; ++j) blocks[j] = allocateBlockCached(&cache);
+        for (int j = BENCH_HELD - 1; j >= 0; --j) freeBlockCached(&cache, blocks[j]);
+    }
+    memPoolCacheFlush(&cache);
+    return NULL;
+}
+
+// Best round, ticks per allocate+free pair
+static double benchStore(BenchStore_t* store, int numThreads) {
+    uint64_t best = UINT64_MAX;
+    for (int round = 0; round < BENCH_ROUNDS; ++round) {
+        pthread_t threads[BENCH_MAX_THREADS];
+        uint64_t start = benchTicks();
+        for (int t = 0; t < numThreads; ++t) pthread_create(&threads[t], NULL, cachedLoop, store);
+        for (int t = 0; t < numThreads; ++t) pthread_join(threads[t], NULL);
+        uint64_t ticks = benchTicks() - start;
+        if (ticks < best) best = ticks;
+    }
+    int pairs = BENCH_ITERATIONS / BENCH_HELD * BENCH_HELD;
+    return (double)best / ((double)pairs * numThreads);
+}
+
+int main(void) {
+    printf("[BENCH] Shared store behind per-task caches, cache limit %d, ticks per allocate+free\n",
+           BENCH_CACHE_LIMIT);
+    printf("%-8s", "threads");
+    static const char* names[] = { "spin", "mutex", "ring" };
+    for (int s = 0; s < 3; ++s) printf(" %10s", names[s]);
+    printf("\n");
+
+    for (int numThreads = 1; numThreads <= BENCH_MAX_THREADS; numThreads *= 2) {
+        printf("%-8d", numThreads);
+        for (int s = 0; s < 3; ++s) {
+            MemoryPoolLock_t lockType = s == 1 ? MEM_POOL_LOCK_MUTEX : MEM_POOL_LOCK_SPIN;
+            BenchStore_t store;
+            store.pool = createMemoryPoolEx(BENCH_BLOCK_SIZE, BENCH_BLOCK_SIZE * BENCH_NUM_BLOCKS, lockType);
+            assert(store.pool != NULL);
+            memPoolSetCacheLimit(store.pool, BENCH_CACHE_LIMIT);
+            store.ring = s == 2 ? memPoolRingCreate(store.pool) : NULL;
+            printf(" %10.2f", benchStore(&store, numThreads));
+            memPoolRingDestroy(store.ring);
+            destroyMemoryPool(store.pool);
+        }
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,24 @@
+// Tick source shared by the benchmarks
+
+#ifndef BENCH_TICKS_H
+#define BENCH_TICKS_H
+
+#include <stdint.h>
+#include <time.h>
+
+// Raw cycle counter where available, nanoseconds otherwise
+static inline uint64_t benchTicks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+    uint64_t t;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(t));
+    return t;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+#endif // BENCH_TICKS_H
@@ -0,0 +1,458 @@
+// Author: D.S. Koshelev, updated by ChatGPT
+// Created: 05/04/2023
+// Requirement: Portable for C and FreeRTOS
+//
+// Fixed-size block allocator. allocateBlock/freeBlock are static inline so they are
+// inlined into callers; pool creation, destruction and error reporting live in the
+// mem_pool library (src/mem_pool.cpp).
+//
+// Every option below changes the layout of MemoryPool_t or the fast path, so the
+// library and all of its users must be built with the same values (the CMake options
+// of the same name take care of that).
+
+#ifndef MEM_POOL_H
+#define MEM_POOL_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// *****Defines*****
+
+// Geometry from a configuration header, e.g. the output of tools/pool_advisor, named by
+// -DMEM_POOL_CONFIG_HEADER="path" (CMake cache variable of the same name)
+#ifdef MEM_POOL_CONFIG_HEADER
+    #include MEM_POOL_CONFIG_HEADER
+#endif
+
+#ifndef MEM_POOL_SIZE
+    #define MEM_POOL_SIZE 128
+#endif
+#ifndef MEM_BLOCK_SIZE
+    #define MEM_BLOCK_SIZE 16
+#endif
+
+// Free-list hardening (glibc safe-linking style): every MemoryBlock_t::next is stored
+// XOR-ed with a per-pool secret and the address of the slot holding it, and is checked
+// for alignment and arena range when decoded. Build with -DMEM_POOL_SAFE_LINKING=0 to
+// store raw pointers.
+#ifndef MEM_POOL_SAFE_LINKING
+    #define MEM_POOL_SAFE_LINKING 1
+#endif
+
+// Poison-on-free: freeBlock fills the block past the link word with MEM_POOL_POISON_BYTE,
+// allocateBlock verifies the pattern on every MEM_POOL_POISON_SAMPLE-th allocation
+// (every allocation in debug builds) and reports blocks written after free. The rate is
+// a power of two and can be changed per pool at run time (memPoolSetPoisonSample).
+// Build with -DMEM_POOL_POISON=1 to enable.
+#ifndef MEM_POOL_POISON
+    #define MEM_POOL_POISON 0
+#endif
+#ifndef MEM_POOL_POISON_BYTE
+    #define MEM_POOL_POISON_BYTE 0xA5
+#endif
+#ifndef MEM_POOL_POISON_SAMPLE
+    #ifdef NDEBUG
+        #define MEM_POOL_POISON_SAMPLE 64
+    #else
+        #define MEM_POOL_POISON_SAMPLE 1
+    #endif
+#endif
+
+// Event tracing to a file (memPoolTraceOpen), switched per pool at run time. Build with
+// -DMEM_POOL_TRACE=1 to compile the hook into allocateBlock/freeBlock.
+#ifndef MEM_POOL_TRACE
+    #define MEM_POOL_TRACE 0
+#endif
+
+// Capacity of a per-task block cache (mem_pool_cache.h)
+#ifndef MEM_POOL_CACHE_SIZE
+    #define MEM_POOL_CACHE_SIZE 32
+#endif
+
+// Contention-adaptive caching (memPoolSetAdaptive): the per-task caches of a pool are
+// switched on when contended lock acquisitions reach MEM_POOL_ADAPT_CONTENDED per
+// MEM_POOL_ADAPT_WINDOW_NS and off again after MEM_POOL_ADAPT_QUIET_WINDOWS windows with
+// at most MEM_POOL_ADAPT_QUIET.
+#ifndef MEM_POOL_ADAPT_WINDOW_NS
+    #define MEM_POOL_ADAPT_WINDOW_NS 10000000ULL
+#endif
+#ifndef MEM_POOL_ADAPT_CONTENDED
+    #define MEM_POOL_ADAPT_CONTENDED 32
+#endif
+#ifndef MEM_POOL_ADAPT_QUIET
+    #define MEM_POOL_ADAPT_QUIET 2
+#endif
+#ifndef MEM_POOL_ADAPT_QUIET_WINDOWS
+    #define MEM_POOL_ADAPT_QUIET_WINDOWS 10
+#endif
+// Lock and cache slow paths read the clock only every MEM_POOL_ADAPT_CHECK_EVERY calls
+// (power of two)
+#ifndef MEM_POOL_ADAPT_CHECK_EVERY
+    #define MEM_POOL_ADAPT_CHECK_EVERY 16
+#endif
+
+// AddressSanitizer builds mark free block bodies as poisoned, so any access to pooled
+// memory after freeBlock is reported by the sanitizer itself.
+#if defined(__SANITIZE_ADDRESS__)
+    #define MEM_POOL_ASAN 1
+#elif defined(__has_feature)
+    #if __has_feature(address_sanitizer)
+        #define MEM_POOL_ASAN 1
+    #endif
+#endif
+#ifdef MEM_POOL_ASAN
+    #include <sanitizer/asan_interface.h>
+#else
+    #define ASAN_POISON_MEMORY_REGION(addr, size)   ((void)(addr), (void)(size))
+    #define ASAN_UNPOISON_MEMORY_REGION(addr, size) ((void)(addr), (void)(size))
+#endif
+
+// Giving free arena pages back to the OS (mem_pool_trim.h), Linux host only
+#if defined(__linux__) && !defined(USE_FREERTOS)
+    #define MEM_POOL_TRIM 1
+#else
+    #define MEM_POOL_TRIM 0
+#endif
+
+// Standalone build without FreeRTOS unless -DUSE_FREERTOS is given
+#ifdef USE_FREERTOS
+    #include "FreeRTOS.h"
+    #include "task.h"
+    #include "semphr.h"
+#else
+    #include <pthread.h>
+#endif
+
+// Context-switch points of the fast path, empty unless a test harness defines them
+// (tests/rtos_sim runs the RTOS port layer on a simulated scheduler)
+#ifndef MEM_POOL_PREEMPTION_POINT
+    #define MEM_POOL_PREEMPTION_POINT() ((void)0)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *****Types*****
+
+// Synchronisation of a pool shared between tasks, chosen at creation
+typedef enum MemoryPoolLock_e {
+    MEM_POOL_LOCK_NONE = 0, // Single owner, no synchronisation
+    MEM_POOL_LOCK_SPIN,     // Busy-wait lock (critical section on FreeRTOS)
+    MEM_POOL_LOCK_MUTEX,    // Blocking OS mutex
+    MEM_POOL_LOCK_PI_MUTEX  // Blocking mutex with priority inheritance (FreeRTOS mutexes always have it)
+} MemoryPoolLock_t;
+
+typedef struct MemoryBlock_s {
+    struct MemoryBlock_s* next;
+} MemoryBlock_t;
+
+typedef struct MemoryPool_s {
+    void* memoryStart;
+    void* memoryEnd;
+    MemoryBlock_t* freeList;
+    size_t blockSize;
+    size_t poolSize;
+    MemoryPoolLock_t lockType;
+    volatile char spinLock;
+#ifdef USE_FREERTOS
+    SemaphoreHandle_t mutex;
+#else
+    pthread_mutex_t mutex;
+#endif
+    uintptr_t linkSecret;   // Per-pool key for safe-linking
+    size_t corruptions;     // Number of detected free-list corruptions and poison violations
+    size_t cacheLimit;      // Blocks a per-task cache may hold, <= MEM_POOL_CACHE_SIZE
+    size_t inUse;           // Blocks handed out, including those parked in per-task caches
+    size_t highWater;       // Peak of inUse since creation (mem_pool_profile.h)
+    struct MemoryPool_s* spillPool; // Next larger class lending blocks when this pool is empty
+    size_t spillLimit;      // Largest block size this pool may borrow along the spill chain
+    size_t spills;          // Allocations served by a larger class
+    int freeHooks;          // Spill, eviction, TTL or large blocks: freeBlock goes through memPoolFreeHook
+    size_t contentions;     // Lock acquisitions that had to wait
+    size_t adaptiveLimit;   // Cache limit under contention, 0: adaptive mode off
+    volatile char adaptBusy;
+    unsigned adaptQuiet;    // Quiet windows in a row
+    size_t adaptBase;       // contentions at the start of the window
+    uint64_t adaptStart;    // Window start, ns
+    size_t adaptCalls;      // Slow-path calls, every MEM_POOL_ADAPT_CHECK_EVERY-th evaluates
+#if MEM_POOL_POISON
+    size_t poisonTick;      // Allocation counter driving poison sampling
+    size_t poisonMask;      // Sampling rate - 1, rate is a power of two
+#endif
+#if MEM_POOL_TRACE
+    volatile int traceEnabled;
+#endif
+    unsigned char* evictMeta;   // Per-block recency for eviction (mem_pool_evict.h), NULL if off
+    int (*evict)(void* context, void* block);
+    void* evictContext;
+    size_t evictHand;       // CLOCK hand
+    size_t evictions;
+    struct MemoryPoolTtl_s* ttl; // Timer wheel of allocateBlockTTL (mem_pool_ttl.h), NULL if off
+#if MEM_POOL_TRIM
+    unsigned char* releasedPages; // Bitmap of arena pages given back to the OS
+    size_t releasedBlocks;        // Free blocks unlinked together with those pages
+    struct MemoryPoolLarge_s* large; // Large-block mode state, NULL if off
+#endif
+} MemoryPool_t;
+
+// *****Library functions*****
+
+MemoryPool_t* createMemoryPool(size_t blockSize, size_t poolSize);
+MemoryPool_t* createMemoryPoolEx(size_t blockSize, size_t poolSize, MemoryPoolLock_t lockType);
+void destroyMemoryPool(MemoryPool_t* pool);
+
+// Batch operations: up to count blocks under one lock acquisition.
+// allocateBlocks returns the number of blocks stored in blocks.
+size_t allocateBlocks(MemoryPool_t* pool, void** blocks, size_t count);
+void freeBlocks(MemoryPool_t* pool, void* const* blocks, size_t count);
+
+// Run-time tuning
+void memPoolSetCacheLimit(MemoryPool_t* pool, size_t limit);
+void memPoolSetPoisonSample(MemoryPool_t* pool, size_t rate);
+
+// Start the pool on the plain single-head path (cacheLimit 0) and let contention switch
+// per-task caches (mem_pool_cache.h) on up to maxCacheLimit and off again. Tasks keep
+// their blocks while caching is off: each cache flushes on its next free. 0 disables.
+// Only allocateBlockCached/freeBlockCached users move onto caches; plain allocateBlock
+// callers stay on the shared list however contended it is.
+void memPoolSetAdaptive(MemoryPool_t* pool, size_t maxCacheLimit);
+// Evaluate the current window now; memPoolAdaptTick is the rate-limited form
+void memPoolAdapt(MemoryPool_t* pool);
+void memPoolAdaptTick(MemoryPool_t* pool);
+
+// Free blocks on the list, walked under the pool lock
+size_t memPoolCountFree(MemoryPool_t* pool);
+
+// Overflow spill: once pool and its released pages are exhausted, allocateBlock borrows
+// from larger, then from larger's own spill pool and so on, as long as the block size
+// stays within maxWastePercent over the size of pool. A block is tagged by the arena it
+// lies in: freeBlock on the pool it was requested from hands it back to its owner.
+// The chain must outlive pool. Returns 0 on success, larger == NULL unlinks.
+int memPoolSetSpill(MemoryPool_t* pool, MemoryPool_t* larger, unsigned maxWastePercent);
+
+// allocateBlock that never spills: the block always lies in pool's own arena, for callers
+// that index per-block side metadata (TTL timers, eviction state)
+void* memPoolAllocateOwn(MemoryPool_t* pool);
+
+// Cold paths of allocateBlock, kept out of line
+void memPoolLockContended(MemoryPool_t* pool);
+void* memPoolAllocateSlow(MemoryPool_t* pool);
+void memPoolFreeSpilled(MemoryPool_t* pool, void* block);
+int memPoolFreeHook(MemoryPool_t* pool, void* block);
+void memPoolUpdateFreeHooks(MemoryPool_t* pool);
+void memPoolReportCorruption(MemoryPool_t* pool, const void* block, size_t offset);
+void memPoolVerifyPoison(MemoryPool_t* pool, const MemoryBlock_t* block);
+// Fresh safe-linking secret, also keys the links of tiny pools
+uintptr_t memPoolMakeSecret(const void* pool, const void* memory);
+#if MEM_POOL_TRACE
+// op: 'a' allocate, 'f' free; size is the requested size if known, 0 otherwise
+void memPoolTraceEvent(const MemoryPool_t* pool, char op, const void* block, size_t size);
+int memPoolTraceOpen(const char* path);
+void memPoolTraceClose(void);
+#endif
+
+// *****RTOS port layer*****
+
+static inline void memPoolCpuRelax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ volatile("yield");
+#endif
+}
+
+static inline void memPoolLock(MemoryPool_t* pool) {
+    switch (pool->lockType) {
+    case MEM_POOL_LOCK_NONE:
+        break;
+    case MEM_POOL_LOCK_SPIN:
+#ifdef USE_FREERTOS
+        taskENTER_CRITICAL();
+#else
+        if (__atomic_test_and_set(&pool->spinLock, __ATOMIC_ACQUIRE)) memPoolLockContended(pool);
+#endif
+        break;
+    case MEM_POOL_LOCK_MUTEX:
+    case MEM_POOL_LOCK_PI_MUTEX:
+#ifdef USE_FREERTOS
+        if (xSemaphoreTake(pool->mutex, 0) != pdTRUE) memPoolLockContended(pool);
+#else
+        if (pthread_mutex_trylock(&pool->mutex) != 0) memPoolLockContended(pool);
+#endif
+        break;
+    }
+}
+
+static inline void memPoolUnlock(MemoryPool_t* pool) {
+    switch (pool->lockType) {
+    case MEM_POOL_LOCK_NONE:
+        break;
+    case MEM_POOL_LOCK_SPIN:
+#ifdef USE_FREERTOS
+        taskEXIT_CRITICAL();
+#else
+        __atomic_clear(&pool->spinLock, __ATOMIC_RELEASE);
+#endif
+        break;
+    case MEM_POOL_LOCK_MUTEX:
+    case MEM_POOL_LOCK_PI_MUTEX:
+#ifdef USE_FREERTOS
+        xSemaphoreGive(pool->mutex);
+#else
+        pthread_mutex_unlock(&pool->mutex);
+#endif
+        break;
+    }
+}
+
+// *****Free-list link encoding*****
+
+// Mangled link: value ^ secret ^ slot address. A stray write of a plain pointer into a
+// freed block decodes to garbage that fails the checks below instead of being followed.
+static inline void memPoolStoreLink(const MemoryPool_t* pool, MemoryBlock_t* slot, MemoryBlock_t* next) {
+#if MEM_POOL_SAFE_LINKING
+    slot->next = (MemoryBlock_t*)((uintptr_t)next ^ pool->linkSecret ^ (uintptr_t)slot);
+#else
+    (void)pool;
+    slot->next = next;
+#endif
+}
+
+static inline MemoryBlock_t* memPoolLoadLink(const MemoryPool_t* pool, const MemoryBlock_t* slot) {
+#if MEM_POOL_SAFE_LINKING
+    return (MemoryBlock_t*)((uintptr_t)slot->next ^ pool->linkSecret ^ (uintptr_t)slot);
+#else
+    (void)pool;
+    return slot->next;
+#endif
+}
+
+// Decoded link must be NULL or the start of a block inside the arena.
+static inline int memPoolIsValidLink(const MemoryPool_t* pool, const MemoryBlock_t* link) {
+    if (!link) return 1;
+    if ((uintptr_t)link & (sizeof(void*) - 1)) return 0;
+    if ((const void*)link < pool->memoryStart || (const void*)link >= pool->memoryEnd) return 0;
+    return (size_t)((const char*)link - (const char*)pool->memoryStart) % pool->blockSize == 0;
+}
+
+// True if block lies in the arena of pool
+static inline int memPoolOwnsBlock(const MemoryPool_t* pool, const void* block) {
+    return block >= pool->memoryStart && block < pool->memoryEnd;
+}
+
+// *****Free block poisoning*****
+
+// Called on every block entering the free list. The link word stays accessible,
+// the allocator reads it.
+static inline void memPoolPoisonBlock(const MemoryPool_t* pool, MemoryBlock_t* block) {
+    char* body = (char*)block + sizeof(MemoryBlock_t);
+    size_t bodySize = pool->blockSize - sizeof(MemoryBlock_t);
+#if MEM_POOL_POISON
+    memset(body, MEM_POOL_POISON_BYTE, bodySize); // libc memset uses wide vector stores
+#endif
+    ASAN_POISON_MEMORY_REGION(body, bodySize);
+    (void)body;
+    (void)bodySize;
+}
+
+// *****Fast path*****
+
+// Pops the head of the free list, NULL if the list is empty or corrupted.
+// requestedSize only feeds the trace (pool sizing advisor), 0 if unknown.
+static inline void* memPoolTryAllocate(MemoryPool_t* pool, size_t requestedSize) {
+    memPoolLock(pool);
+    MEM_POOL_PREEMPTION_POINT();
+    MemoryBlock_t* block = pool->freeList;
+    if (!block) {
+        memPoolUnlock(pool);
+        return NULL;
+    }
+
+    MemoryBlock_t* next = memPoolLoadLink(pool, block);
+#if MEM_POOL_SAFE_LINKING
+    if (!memPoolIsValidLink(pool, next)) {
+        // Link overwritten after free: drop the list rather than follow it
+        pool->freeList = NULL;
+        memPoolUnlock(pool);
+        memPoolReportCorruption(pool, block, 0);
+        return NULL;
+    }
+#endif
+    MEM_POOL_PREEMPTION_POINT();
+    pool->freeList = next;
+    if (++pool->inUse > pool->highWater) pool->highWater = pool->inUse;
+#if MEM_POOL_POISON
+    int checkPoison = (++pool->poisonTick & pool->poisonMask) == 0;
+#endif
+    memPoolUnlock(pool);
+    MEM_POOL_PREEMPTION_POINT();
+
+    // The block is owned by the caller from here, keep the scan out of the critical section
+    ASAN_UNPOISON_MEMORY_REGION(block, pool->blockSize);
+#if MEM_POOL_POISON
+    if (checkPoison) memPoolVerifyPoison(pool, block);
+#endif
+
+#if MEM_POOL_TRACE
+    if (pool->traceEnabled) memPoolTraceEvent(pool, 'a', block, requestedSize);
+#else
+    (void)requestedSize;
+#endif
+
+#ifdef DEBUGPRINT
+    printf("\nNew Allocated Block:\n");
+    printf("Allocated = %p\n", (void*)block);
+    printf("Next Free = %p\n", (void*)next);
+#endif
+
+    return (void*)block;
+}
+
+static inline void* memPoolAllocate(MemoryPool_t* pool, size_t requestedSize) {
+    if (!pool) return NULL;
+    void* block = memPoolTryAllocate(pool, requestedSize);
+    return block ? block : memPoolAllocateSlow(pool);
+}
+
+static inline void* allocateBlock(MemoryPool_t* pool) {
+    return memPoolAllocate(pool, 0);
+}
+
+// Same as allocateBlock, records the size the caller actually needs in the trace
+static inline void* allocateBlockSized(MemoryPool_t* pool, size_t size) {
+    if (!pool || size > pool->blockSize) return NULL;
+    return memPoolAllocate(pool, size);
+}
+
+static inline void freeBlock(MemoryPool_t* pool, void* blockAddr) {
+    if (!pool || !blockAddr) return;
+
+    MemoryBlock_t* block = (MemoryBlock_t*)blockAddr;
+    if (pool->freeHooks && memPoolFreeHook(pool, blockAddr)) return;
+#if MEM_POOL_TRACE
+    if (pool->traceEnabled) memPoolTraceEvent(pool, 'f', block, 0);
+#endif
+    memPoolPoisonBlock(pool, block);
+
+    MEM_POOL_PREEMPTION_POINT();
+    memPoolLock(pool);
+    memPoolStoreLink(pool, block, pool->freeList);
+    MEM_POOL_PREEMPTION_POINT();
+    pool->freeList = block;
+    --pool->inUse;
+    memPoolUnlock(pool);
+
+#ifdef DEBUGPRINT
+    printf("\nFreed Block:\n");
+    printf("Address = %p\n", blockAddr);
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MEM_POOL_H
@@ -0,0 +1,571 @@
+// Policy-based fixed-size pool for C++ builds.
+//
+// BasicPool<Storage, FreeList, Sync, Stats> composes the pool at compile time:
+//   Storage   StaticStorage<BlockSize, NumBlocks>  arena inside the pool object
+//             HeapStorage<BlockSize, NumBlocks>    pvPortMalloc/malloc arena
+//             MmapStorage<BlockSize, NumBlocks>    anonymous mapping (POSIX host)
+//   FreeList  ListFreeList      intrusive LIFO list, O(1)
+//             BitmapFreeList    one bit per block, lowest free block first
+//             LockFreeList      Treiber stack with an ABA tag, use with NoSync
+//             AtomicBitmapFreeList  bits claimed with atomic fetch_and from a per-thread
+//                               start word, no shared head; use with NoSync
+//   Sync      NoSync, SpinSync, MutexSync, PiMutexSync (same primitives as MemoryPoolLock_t);
+//             a custom policy declares locking = false only if lock() is a no-op
+//   Stats     NoStats, CountingStats (AtomicCountingStats with the lock-free lists)
+// Empty policies are empty base classes, so unused features cost neither space nor
+// instructions. The C MemoryPool_t stays the hardened run-time configurable pool;
+// BasicPool has no safe-linking, poisoning or tracing.
+//
+// InlinePool<BlockSize, N> keeps N blocks in its own storage and overflows to a shared
+// MemoryPool_t, for hot code that needs a handful of temporary blocks.
+
+#ifndef MEM_POOL_BASIC_H
+#define MEM_POOL_BASIC_H
+
+#ifdef __cplusplus
+
+#include "mem_pool.h"
+
+#include <stdlib.h>
+#if !defined(USE_FREERTOS) && defined(__unix__)
+    #include <sys/mman.h>
+    #define MEM_POOL_BASIC_MMAP 1
+#endif
+
+namespace mem_pool {
+
+// *****Storage policies*****
+
+template <size_t BlockSize, size_t NumBlocks>
+class StaticStorage {
+public:
+    static const size_t blockSize = BlockSize;
+    static const size_t numBlocks = NumBlocks;
+
+    bool init() { return true; }
+    void deinit() {}
+    char* base() { return arena_; }
+
+private:
+    alignas(sizeof(void*) > alignof(double) ? sizeof(void*) : alignof(double)) char arena_[BlockSize * NumBlocks];
+};
+
+template <size_t BlockSize, size_t NumBlocks>
+class HeapStorage {
+public:
+    static const size_t blockSize = BlockSize;
+    static const size_t numBlocks = NumBlocks;
+
+    bool init() {
+#ifdef USE_FREERTOS
+        arena_ = (char*)pvPortMalloc(BlockSize * NumBlocks);
+#else
+        arena_ = (char*)malloc(BlockSize * NumBlocks);
+#endif
+        return arena_ != NULL;
+    }
+    void deinit() {
+#ifdef USE_FREERTOS
+        vPortFree(arena_);
+#else
+        free(arena_);
+#endif
+    }
+    char* base() { return arena_; }
+
+private:
+    char* arena_;
+};
+
+#if MEM_POOL_BASIC_MMAP
+template <size_t BlockSize, size_t NumBlocks>
+class MmapStorage {
+public:
+    static const size_t blockSize = BlockSize;
+    static const size_t numBlocks = NumBlocks;
+
+    bool init() {
+        void* arena = mmap(NULL, BlockSize * NumBlocks, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        arena_ = arena == MAP_FAILED ? NULL : (char*)arena;
+        return arena_ != NULL;
+    }
+    void deinit() { munmap(arena_, BlockSize * NumBlocks); }
+    char* base() { return arena_; }
+
+private:
+    char* arena_;
+};
+#endif
+
+// *****Free-list policies*****
+
+template <class Storage>
+class ListFreeList {
+public:
+    static const bool lockFree = false;
+
+    void init(Storage& storage) {
+        head_ = NULL;
+        for (size_t i = Storage::numBlocks; i-- > 0;) {
+            MemoryBlock_t* block = (MemoryBlock_t*)(storage.base() + i * Storage::blockSize);
+            block->next = head_;
+            head_ = block;
+        }
+    }
+    void* pop(Storage&) {
+        MemoryBlock_t* block = head_;
+        if (block) head_ = block->next;
+        return block;
+    }
+    void push(Storage&, void* ptr) {
+        MemoryBlock_t* block = (MemoryBlock_t*)ptr;
+        block->next = head_;
+        head_ = block;
+    }
+
+private:
+    MemoryBlock_t* head_;
+};
+
+// Keeps no links inside the blocks, allocation order is address order
+template <class Storage>
+class BitmapFreeList {
+public:
+    static const bool lockFree = false;
+
+    void init(Storage&) {
+        for (size_t w = 0; w < numWords; ++w) words_[w] = ~(uint64_t)0;
+        if (Storage::numBlocks % 64) words_[numWords - 1] = ((uint64_t)1 << (Storage::numBlocks % 64)) - 1;
+        hint_ = 0;
+    }
+    void* pop(Storage& storage) {
+        for (size_t n = 0; n < numWords; ++n) {
+            size_t w = hint_ + n < numWords ? hint_ + n : hint_ + n - numWords;
+            if (!words_[w]) continue;
+            unsigned bit = (unsigned)__builtin_ctzll(words_[w]);
+            words_[w] &= words_[w] - 1;
+            hint_ = w;
+            return storage.base() + (w * 64 + bit) * Storage::blockSize;
+        }
+        return NULL;
+    }
+    void push(Storage& storage, void* ptr) {
+        size_t index = (size_t)((char*)ptr - storage.base()) / Storage::blockSize;
+        words_[index / 64] |= (uint64_t)1 << (index % 64);
+        if (index / 64 < hint_) hint_ = index / 64;
+    }
+
+private:
+    static const size_t numWords = (Storage::numBlocks + 63) / 64;
+    uint64_t words_[numWords];
+    size_t hint_; // First word that may have a free block
+};
+
+// Head is {tag:32, index + 1:32} in one word; the tag changes on every pop, so a block
+// freed and reallocated between the load and the CAS of another task cannot be mistaken
+// for the old head (ABA).
+template <class Storage>
+class LockFreeList {
+public:
+    static const bool lockFree = true;
+
+    void init(Storage& storage) {
+        for (size_t i = 0; i < Storage::numBlocks; ++i) {
+            *nextSlot(storage, i) = i + 1 < Storage::numBlocks ? (uint32_t)(i + 2) : 0;
+        }
+        head_ = 1;
+    }
+    void* pop(Storage& storage) {
+        uint64_t head = __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+        for (;;) {
+            uint32_t index = (uint32_t)head;
+            if (!index) return NULL;
+            // May read a block another task just took; the CAS below then fails
+            uint32_t next = __atomic_load_n(nextSlot(storage, index - 1), __ATOMIC_RELAXED);
+            uint64_t newHead = ((head >> 32) + 1) << 32 | next;
+            if (__atomic_compare_exchange_n(&head_, &head, newHead, true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+                return storage.base() + (size_t)(index - 1) * Storage::blockSize;
+            }
+        }
+    }
+    void push(Storage& storage, void* ptr) {
+        uint32_t index = (uint32_t)((size_t)((char*)ptr - storage.base()) / Storage::blockSize) + 1;
+        uint64_t head = __atomic_load_n(&head_, __ATOMIC_RELAXED);
+        do {
+            __atomic_store_n(nextSlot(storage, index - 1), (uint32_t)head, __ATOMIC_RELAXED);
+        } while (!__atomic_compare_exchange_n(&head_, &head, (head & ~(uint64_t)0xFFFFFFFFu) | index, true,
+                                              __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    }
+
+private:
+    static uint32_t* nextSlot(Storage& storage, size_t index) {
+        return (uint32_t*)(storage.base() + index * Storage::blockSize);
+    }
+    uint64_t head_;
+};
+
+// One bit per block in 64-bit words, set while free. A block is claimed by clearing its bit
+// with fetch_and; the thread that saw the bit set in the old value owns the block. Each
+// thread starts searching at a word hashed from its stack address, so threads mostly
+// claim from different words and there is no single head every operation hits.
+// The summary has a bit per word that may have free blocks. It is maintained lazily:
+// push sets it only when a word goes from empty to non-empty, pop clears it only when a
+// search finds the word empty and then re-checks the word, so a concurrent push is never
+// hidden from later searches.
+template <class Storage>
+class AtomicBitmapFreeList {
+public:
+    static const bool lockFree = true;
+
+    void init(Storage&) {
+        for (size_t w = 0; w < numWords; ++w) words_[w] = ~(uint64_t)0;
+        if (Storage::numBlocks % 64) words_[numWords - 1] = ((uint64_t)1 << (Storage::numBlocks % 64)) - 1;
+        for (size_t s = 0; s < numSummary; ++s) summary_[s] = ~(uint64_t)0;
+        if (numWords % 64) summary_[numSummary - 1] = ((uint64_t)1 << (numWords % 64)) - 1;
+    }
+    void* pop(Storage& storage) {
+        size_t start = startWord();
+        for (size_t n = 0; n < numWords;) {
+            size_t w = start + n < numWords ? start + n : start + n - numWords;
+            uint64_t pending = __atomic_load_n(&summary_[w / 64], __ATOMIC_RELAXED) >> (w % 64);
+            if (!pending) {
+                // Rest of this summary word, without running past the last word
+                size_t skip = 64 - w % 64;
+                n += skip < numWords - w ? skip : numWords - w;
+                continue;
+            }
+            size_t skip = (size_t)__builtin_ctzll(pending);
+            if (skip) {
+                n += skip;
+                continue;
+            }
+            void* block = claim(storage, w);
+            if (block) return block;
+            ++n;
+        }
+        return NULL;
+    }
+    void push(Storage& storage, void* ptr) {
+        size_t index = (size_t)((char*)ptr - storage.base()) / Storage::blockSize;
+        size_t w = index / 64;
+        uint64_t old = __atomic_fetch_or(&words_[w], (uint64_t)1 << (index % 64), __ATOMIC_SEQ_CST);
+        if (!old) __atomic_fetch_or(&summary_[w / 64], (uint64_t)1 << (w % 64), __ATOMIC_SEQ_CST);
+    }
+
+private:
+    static const size_t numWords = (Storage::numBlocks + 63) / 64;
+    static const size_t numSummary = (numWords + 63) / 64;
+
+    // Stack addresses of different threads lie at least a page apart
+    static size_t startWord() {
+        char probe;
+        uint64_t hash = (uint64_t)((uintptr_t)&probe >> 12) * 0x9E3779B97F4A7C15ull;
+        return (size_t)((hash >> 32) % numWords);
+    }
+
+    void* claim(Storage& storage, size_t w) {
+        uint64_t bits = __atomic_load_n(&words_[w], __ATOMIC_RELAXED);
+        while (bits) {
+            uint64_t mask = bits & (~bits + 1); // Lowest set bit
+            uint64_t old = __atomic_fetch_and(&words_[w], ~mask, __ATOMIC_ACQUIRE);
+            if (old & mask) return storage.base() + (w * 64 + (size_t)__builtin_ctzll(mask)) * Storage::blockSize;
+            bits = old & ~mask;
+        }
+        // Empty: drop the summary bit, restore it if a push got in between
+        uint64_t summaryBit = (uint64_t)1 << (w % 64);
+        __atomic_fetch_and(&summary_[w / 64], ~summaryBit, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&words_[w], __ATOMIC_SEQ_CST)) {
+            __atomic_fetch_or(&summary_[w / 64], summaryBit, __ATOMIC_SEQ_CST);
+        }
+        return NULL;
+    }
+
+    uint64_t words_[numWords];
+    uint64_t summary_[numSummary];
+};
+
+// *****Sync policies*****
+
+class NoSync {
+public:
+    static const bool locking = false;
+
+    bool init() { return true; }
+    void deinit() {}
+    void lock() {}
+    void unlock() {}
+};
+
+class SpinSync {
+public:
+    static const bool locking = true;
+
+    bool init() {
+        flag_ = 0;
+        return true;
+    }
+    void deinit() {}
+    void lock() {
+#ifdef USE_FREERTOS
+        taskENTER_CRITICAL();
+#else
+        while (__atomic_test_and_set(&flag_, __ATOMIC_ACQUIRE)) {
+            while (__atomic_load_n(&flag_, __ATOMIC_RELAXED)) memPoolCpuRelax();
+        }
+#endif
+    }
+    void unlock() {
+#ifdef USE_FREERTOS
+        taskEXIT_CRITICAL();
+#else
+        __atomic_clear(&flag_, __ATOMIC_RELEASE);
+#endif
+    }
+
+private:
+    volatile char flag_;
+};
+
+class MutexSync {
+public:
+    static const bool locking = true;
+
+#ifdef USE_FREERTOS
+    bool init() { return (mutex_ = xSemaphoreCreateMutex()) != NULL; }
+    void deinit() { vSemaphoreDelete(mutex_); }
+    void lock() { (void)xSemaphoreTake(mutex_, portMAX_DELAY); }
+    void unlock() { xSemaphoreGive(mutex_); }
+
+private:
+    SemaphoreHandle_t mutex_;
+#else
+    bool init() { return pthread_mutex_init(&mutex_, NULL) == 0; }
+    void deinit() { pthread_mutex_destroy(&mutex_); }
+    void lock() { pthread_mutex_lock(&mutex_); }
+    void unlock() { pthread_mutex_unlock(&mutex_); }
+
+protected:
+    pthread_mutex_t mutex_;
+#endif
+};
+
+// Priority-inheritance mutex; on FreeRTOS every mutex inherits priority
+class PiMutexSync : public MutexSync {
+public:
+#ifndef USE_FREERTOS
+    bool init() {
+        pthread_mutexattr_t attr;
+        if (pthread_mutexattr_init(&attr) != 0) return false;
+        bool ok = pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT) == 0 &&
+                  pthread_mutex_init(&mutex_, &attr) == 0;
+        pthread_mutexattr_destroy(&attr);
+        return ok;
+    }
+#endif
+};
+
+// *****Stats policies*****
+
+class NoStats {
+public:
+    static const bool enabled = false;
+    static const bool atomic = true;
+    void onAllocate(bool) {}
+    void onFree() {}
+};
+
+// Plain counters, updated inside the pool lock
+class CountingStats {
+public:
+    static const bool enabled = true;
+    static const bool atomic = false;
+
+    CountingStats() : allocations(0), frees(0), failures(0), inUse(0), highWater(0) {}
+    void onAllocate(bool ok) {
+        if (!ok) {
+            ++failures;
+            return;
+        }
+        ++allocations;
+        if (++inUse > highWater) highWater = inUse;
+    }
+    void onFree() {
+        ++frees;
+        --inUse;
+    }
+
+    size_t allocations;
+    size_t frees;
+    size_t failures;
+    size_t inUse;
+    size_t highWater;
+};
+
+// Same counters for LockFreeList pools, relaxed atomics
+class AtomicCountingStats {
+public:
+    static const bool enabled = true;
+    static const bool atomic = true;
+
+    AtomicCountingStats() : allocations(0), frees(0), failures(0), inUse(0), highWater(0) {}
+    void onAllocate(bool ok) {
+        if (!ok) {
+            __atomic_fetch_add(&failures, 1, __ATOMIC_RELAXED);
+            return;
+        }
+        __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+        size_t now = __atomic_add_fetch(&inUse, 1, __ATOMIC_RELAXED);
+        size_t peak = __atomic_load_n(&highWater, __ATOMIC_RELAXED);
+        while (now > peak && !__atomic_compare_exchange_n(&highWater, &peak, now, true, __ATOMIC_RELAXED,
+                                                          __ATOMIC_RELAXED)) {}
+    }
+    void onFree() {
+        __atomic_fetch_add(&frees, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_sub(&inUse, 1, __ATOMIC_RELAXED);
+    }
+
+    size_t allocations;
+    size_t frees;
+    size_t failures;
+    size_t inUse;
+    size_t highWater;
+};
+
+// *****Pool*****
+
+template <class Storage, template <class> class FreeList, class Sync, class Stats = NoStats>
+class BasicPool : private Storage, private FreeList<Storage>, private Sync, private Stats {
+public:
+    static const size_t blockSize = Storage::blockSize;
+    static const size_t numBlocks = Storage::numBlocks;
+    typedef Stats StatsPolicy;
+
+    static_assert(Storage::blockSize >= sizeof(MemoryBlock_t) && Storage::blockSize % sizeof(void*) == 0,
+                  "block must hold a pointer and keep pointer alignment");
+    static_assert(Storage::numBlocks > 0 && Storage::numBlocks < 0xFFFFFFFFu, "block count out of range");
+    static_assert(!FreeList<Storage>::lockFree || !Sync::locking,
+                  "lock-free free lists need no lock, use NoSync");
+    static_assert(!FreeList<Storage>::lockFree || Stats::atomic, "lock-free free lists need AtomicCountingStats");
+
+    BasicPool() : ok_(false) {
+        if (!Storage::init()) return;
+        if (!Sync::init()) {
+            Storage::deinit();
+            return;
+        }
+        FreeList<Storage>::init(*this);
+        ok_ = true;
+    }
+    ~BasicPool() {
+        if (!ok_) return;
+        Sync::deinit();
+        Storage::deinit();
+    }
+
+    // False if the arena or the lock could not be created
+    bool valid() const { return ok_; }
+
+    void* allocate() {
+        Sync::lock();
+        void* block = FreeList<Storage>::pop(*this);
+        Stats::onAllocate(block != NULL);
+        Sync::unlock();
+        return block;
+    }
+
+    void free(void* block) {
+        if (!block) return;
+        Sync::lock();
+        Stats::onFree();
+        FreeList<Storage>::push(*this, block);
+        Sync::unlock();
+    }
+
+    bool owns(const void* block) {
+        const char* base = Storage::base();
+        return (const char*)block >= base && (const char*)block < base + blockSize * numBlocks;
+    }
+
+    const Stats& stats() const { return *this; }
+
+private:
+    BasicPool(const BasicPool&);
+    BasicPool& operator=(const BasicPool&);
+
+    bool ok_;
+};
+
+// *****Inline pool*****
+
+// N blocks inside the object itself (a local variable or a member) in front of a shared
+// MemoryPool_t. Once the inline blocks are used up allocate() overflows to the shared
+// pool; free() tells the two apart by address range in O(1), so the common case touches
+// only local memory and takes no lock. Blocks are carved on first use, construction
+// writes no block. Not thread-safe; overflow blocks must be freed before destruction.
+template <size_t BlockSize, size_t N>
+class InlinePool : private StaticStorage<BlockSize, N> {
+public:
+    typedef StaticStorage<BlockSize, N> Storage;
+    static const size_t blockSize = BlockSize;
+    static const size_t numBlocks = N;
+
+    static_assert(BlockSize >= sizeof(MemoryBlock_t) && BlockSize % sizeof(void*) == 0,
+                  "block size must hold a free-list link and keep blocks pointer aligned");
+    static_assert(N > 0, "an inline pool needs blocks");
+
+    // Without a shared pool (or with one of smaller blocks) allocate() fails when full
+    explicit InlinePool(MemoryPool_t* shared)
+        : shared_(shared && shared->blockSize >= BlockSize ? shared : NULL), head_(NULL), carved_(0), overflows_(0),
+          strayFrees_(0) {}
+
+    void* allocate() {
+        MemoryBlock_t* block = head_;
+        if (block) {
+            head_ = block->next;
+            return block;
+        }
+        if (carved_ < N) return Storage::base() + BlockSize * carved_++;
+        if (!shared_) return NULL;
+        ++overflows_;
+        return allocateBlock(shared_);
+    }
+
+    void free(void* ptr) {
+        if (!ptr) return;
+        if (!owns(ptr)) {
+            if (shared_ && memPoolOwnsBlock(shared_, ptr)) freeBlock(shared_, ptr);
+            else ++strayFrees_;
+            return;
+        }
+        MemoryBlock_t* block = (MemoryBlock_t*)ptr;
+        block->next = head_;
+        head_ = block;
+    }
+
+    bool owns(const void* block) {
+        const char* base = Storage::base();
+        return (const char*)block >= base && (const char*)block < base + BlockSize * N;
+    }
+
+    // Allocations served by the shared pool, for sizing N
+    size_t overflows() const { return overflows_; }
+    // Pointers freed that belong neither to this pool nor to the shared one; they are
+    // dropped and anything but 0 is a caller bug
+    size_t strayFrees() const { return strayFrees_; }
+
+private:
+    InlinePool(const InlinePool&);
+    InlinePool& operator=(const InlinePool&);
+
+    MemoryPool_t* shared_;
+    MemoryBlock_t* head_;
+    size_t carved_;
+    size_t overflows_;
+    size_t strayFrees_;
+};
+
+} // namespace mem_pool
+
+#endif // __cplusplus
+
+#endif // MEM_POOL_BASIC_H
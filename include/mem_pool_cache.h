@@ -0,0 +1,68 @@
+// Per-task block cache in front of a shared pool.
+//
+// Each task (thread) owns a MemoryPoolCache_t, e.g. on its stack or in its context
+// structure, so no thread-local storage is needed on the RTOS. Cached alloc/free touch
+// only the owner's array; the pool lock is taken once per refill or drain, which moves
+// half of the pool's cacheLimit in one batch. cacheLimit is shared by all caches of a
+// pool and can be changed at run time (memPoolSetCacheLimit), 0 turns caching off.
+// memPoolSetAdaptive lets the pool switch caching on and off by lock contention; it only
+// affects tasks that go through a cache, plain allocateBlock callers are never switched.
+// A cache initialised with memPoolCacheInitRing refills and drains through a lock-free
+// ring (mem_pool_ring.h) instead of the pool's free list.
+
+#ifndef MEM_POOL_CACHE_H
+#define MEM_POOL_CACHE_H
+
+#include "mem_pool.h"
+#include "mem_pool_ring.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *****Types*****
+
+typedef struct MemoryPoolCache_s {
+    MemoryPool_t* pool;
+    MemoryPoolRing_t* ring; // Shared store instead of the pool's free list, or NULL
+    size_t count;
+    void* blocks[MEM_POOL_CACHE_SIZE];
+} MemoryPoolCache_t;
+
+// *****Library functions*****
+
+void memPoolCacheInit(MemoryPoolCache_t* cache, MemoryPool_t* pool);
+void memPoolCacheInitRing(MemoryPoolCache_t* cache, MemoryPoolRing_t* ring);
+// Returns every cached block to the pool, call before the owning task exits
+void memPoolCacheFlush(MemoryPoolCache_t* cache);
+
+// Slow paths of the cached fast path
+void* memPoolCacheRefill(MemoryPoolCache_t* cache);
+void memPoolCacheDrain(MemoryPoolCache_t* cache, void* blockAddr);
+
+// *****Fast path*****
+
+static inline void* allocateBlockCached(MemoryPoolCache_t* cache) {
+    if (cache->count) {
+        void* block = cache->blocks[--cache->count];
+        ASAN_UNPOISON_MEMORY_REGION(block, cache->pool->blockSize);
+        return block;
+    }
+    return memPoolCacheRefill(cache);
+}
+
+static inline void freeBlockCached(MemoryPoolCache_t* cache, void* blockAddr) {
+    if (!blockAddr) return;
+    if (cache->count < __atomic_load_n(&cache->pool->cacheLimit, __ATOMIC_RELAXED)) {
+        ASAN_POISON_MEMORY_REGION(blockAddr, cache->pool->blockSize);
+        cache->blocks[cache->count++] = blockAddr;
+        return;
+    }
+    memPoolCacheDrain(cache, blockAddr);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MEM_POOL_CACHE_H
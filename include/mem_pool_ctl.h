@@ -0,0 +1,49 @@
+// Run-time control endpoint for pool introspection and tuning (Linux).
+//
+// A low-priority (SCHED_IDLE) thread serves a Unix-domain stream socket. Clients send one
+// command per line, e.g. with `socat - UNIX-CONNECT:/run/app/mem_pool.sock`:
+//
+//   list                    pools with their geometry and counters
+//   stats <id>              one pool, key=value per line
+//   trim <id> | restore <id>
+//   cache <id> <limit>      per-task cache limit of the pool
+//   sample <id> <rate>      poison verification rate, 0 = off (MEM_POOL_POISON builds)
+//   trace open <name> | trace close | trace <id> on|off   (MEM_POOL_TRACE builds)
+//   map <id>                occupancy map: '#' in use or cached, '.' free, '~' released
+//
+// Every reply ends with a line "ok" or "error <reason>". list, stats and cache do not take
+// the pool lock. map, trim, restore and sample do, so their work delays allocations on
+// that pool; they are refused on spin-lock pools, whose waiters would spin behind the
+// idle-priority server thread.
+// One client is served at a time and is dropped after a second without a command.
+
+#ifndef MEM_POOL_CTL_H
+#define MEM_POOL_CTL_H
+
+#include "mem_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MEM_POOL_CTL_MAX_POOLS 64
+#define MEM_POOL_CTL_NAME_SIZE 32
+
+// Pools are served from another thread, so only pools created with a lock are accepted.
+// Returns the pool id or -1. A pool must be unregistered before destroy.
+int memPoolCtlRegister(MemoryPool_t* pool, const char* name);
+void memPoolCtlUnregister(MemoryPool_t* pool);
+
+// Runs one command and writes the reply to out
+void memPoolCtlExecute(const char* command, FILE* out);
+
+// Start/stop the server thread. "trace open <name>" creates traceDir/<name>; name must be a
+// plain file name. A NULL traceDir disables the command. Returns 0 on success.
+int memPoolCtlStart(const char* socketPath, const char* traceDir);
+void memPoolCtlStop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MEM_POOL_CTL_H
@@ -0,0 +1,54 @@
+// Cache-pool mode: CLOCK eviction of the coldest block on exhaustion.
+//
+// For pools backing an in-memory cache. The application marks a block as a live cache
+// entry and as recently used with memPoolTouch (on insert and on every hit). When the
+// pool is empty, allocateBlock sweeps a CLOCK hand over the side metadata (one byte per
+// block): referenced entries get a second chance, the first unreferenced one is passed
+// to the evict callback, which unlinks it from the application's cache, and the block
+// goes straight to the caller without a free/allocate round trip.
+
+#ifndef MEM_POOL_EVICT_H
+#define MEM_POOL_EVICT_H
+
+#include "mem_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *****Defines*****
+
+#define MEM_POOL_EVICT_LIVE       0x01 // Block holds a cache entry
+#define MEM_POOL_EVICT_REFERENCED 0x02 // Used since the hand last passed
+
+// Return nonzero once every reference to block is dropped (it is then reused),
+// 0 to keep it (pinned entry). Runs without the pool lock, may free other blocks.
+typedef int (*MemoryPoolEvict_t)(void* context, void* block);
+
+// *****Library functions*****
+
+// Returns 0 on success. Must be set before the pool is shared.
+int memPoolSetEviction(MemoryPool_t* pool, MemoryPoolEvict_t evict, void* context);
+
+// Coldest live block claimed through the callback, NULL if every entry is pinned
+void* memPoolEvict(MemoryPool_t* pool);
+
+// Drop the entry state of block; freeBlock does it for blocks of a cache pool
+void memPoolForget(MemoryPool_t* pool, void* block);
+
+// *****Fast path*****
+
+// Blocks spilled from another pool have no entry state and are never evicted; touching
+// them is a no-op
+static inline void memPoolTouch(MemoryPool_t* pool, void* block) {
+    if (!memPoolOwnsBlock(pool, block)) return;
+    size_t index = (size_t)((char*)block - (char*)pool->memoryStart) / pool->blockSize;
+    __atomic_store_n(&pool->evictMeta[index], MEM_POOL_EVICT_LIVE | MEM_POOL_EVICT_REFERENCED,
+                     __ATOMIC_RELAXED);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MEM_POOL_EVICT_H
@@ -0,0 +1,60 @@
+// Per-page occupancy snapshots and a sampled occupancy timeline.
+//
+// A snapshot splits the arena into pageSize pieces (aligned to absolute addresses, so
+// with the OS page size they are the pages memPoolTrim works on) and reports the share
+// of each piece covered by live blocks. The sampler thread appends one snapshot per
+// interval to a text timeline; tools/pool_heatmap renders it as a PPM or SVG heatmap
+// with pages left to right and time top to bottom.
+//
+// Timeline format:
+//   # mem_pool occupancy v1
+//   pool <name> <block_size> <page_size> <pages>
+//   <ms since start> <one hex digit per page: 0 empty, 1-e partly used, f full>
+//
+// A snapshot holds the pool lock while it walks the free list. The sampler measures that
+// cost and stretches its interval so it spends at most budgetPercent of one CPU.
+
+#ifndef MEM_POOL_OCCUPANCY_H
+#define MEM_POOL_OCCUPANCY_H
+
+#include "mem_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MEM_POOL_OCCUPANCY_NAME_SIZE 32
+
+// Block states as shown by the control endpoint "map" command
+#define MEM_POOL_BLOCK_LIVE     '#'
+#define MEM_POOL_BLOCK_FREE     '.'
+#define MEM_POOL_BLOCK_RELEASED '~'  // Free, page given back to the OS
+
+// *****Types*****
+
+typedef struct MemoryPoolSampler_s MemoryPoolSampler_t;
+
+// *****Library functions*****
+
+// One MEM_POOL_BLOCK_* character per block; takes the pool lock. Returns 0 on success.
+int memPoolBlockStates(MemoryPool_t* pool, char* states);
+
+// Number of pageSize pieces the arena touches
+size_t memPoolOccupancyPages(const MemoryPool_t* pool, size_t pageSize);
+// Live share per piece, 0 only if empty and 255 only if full. Returns 0 on success.
+int memPoolOccupancySnapshot(MemoryPool_t* pool, size_t pageSize, uint8_t* levels);
+
+#ifndef USE_FREERTOS
+// Sample pool every intervalMs into a new timeline at path; pageSize 0 is the OS page
+// size, budgetPercent 0 is 1 %. NULL on failure. The pool must outlive the sampler.
+MemoryPoolSampler_t* memPoolOccupancyStart(MemoryPool_t* pool, const char* name, const char* path,
+                                           size_t pageSize, unsigned intervalMs, unsigned budgetPercent);
+// Stops the thread and closes the timeline; returns the number of samples written
+size_t memPoolOccupancyStop(MemoryPoolSampler_t* sampler);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MEM_POOL_OCCUPANCY_H
@@ -0,0 +1,53 @@
+// Warm-start pool sizing from a persisted high-water profile.
+//
+// At shutdown memPoolProfileSave records the peak number of blocks each named pool had
+// in use. On the next start memPoolCreateProfiled sizes the arena from that mark within
+// the configured bounds instead of the compile-time worst case:
+//   arena       = high water + growth reserve, clamped to [minBlocks, maxBlocks]
+//   resident    = prefault share of the high water; the rest of the arena is released
+//                 (Linux) and faulted in by allocateBlock once the resident part runs out
+//   cache limit = cache share of the high water, at most MEM_POOL_CACHE_SIZE
+//
+// The profile is a text file, one "name block_size high_water" line per pool, rewritten
+// atomically (temporary file + rename). Entries are keyed by name and block size, so one
+// name can be profiled at several block sizes. Names must not contain whitespace.
+
+#ifndef MEM_POOL_PROFILE_H
+#define MEM_POOL_PROFILE_H
+
+#include "mem_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MEM_POOL_PROFILE_NAME_SIZE 32
+
+// Zero fields fall back to the defaults in brackets
+typedef struct MemoryPoolSizing_s {
+    size_t minBlocks;           // Lower bound of the arena [2]
+    size_t maxBlocks;           // Upper bound of the arena, required
+    size_t defaultBlocks;       // Arena when the profile has no entry [maxBlocks]
+    unsigned reservePercent;    // Growth reserve on top of the high water [25]
+    unsigned prefaultPercent;   // Share of the high water kept resident [100], needs MEM_POOL_TRIM
+                                // (ignored without it, the whole arena stays resident)
+    unsigned cachePercent;      // Per-task cache limit as share of the high water [10]
+} MemoryPoolSizing_t;
+
+// Recorded high water of pool name with the given block size, 0 if unknown
+size_t memPoolProfileLoad(const char* path, const char* name, size_t blockSize);
+
+// Merge the high water of pool into the profile. A smaller mark than the stored one
+// only lowers it by a quarter per run, so one quiet run does not undo a busy one.
+// Returns 0 on success.
+int memPoolProfileSave(const char* path, const char* name, MemoryPool_t* pool);
+
+// createMemoryPoolEx with the arena, resident extent and cache limit taken from the profile
+MemoryPool_t* memPoolCreateProfiled(const char* path, const char* name, size_t blockSize,
+                                    MemoryPoolLock_t lockType, const MemoryPoolSizing_t* sizing);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MEM_POOL_PROFILE_H
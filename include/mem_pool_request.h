@@ -0,0 +1,84 @@
+// Request-scoped allocation: one release for every block a request took.
+//
+// A MemoryPoolRequest_t spans a set of size-class pools, smallest block size first.
+// allocateBlockRequest takes a block from the smallest class that fits, or the next larger
+// one while that is empty, and logs it in the chunk list of the class it came from; memPoolRequestRelease then returns everything with one
+// freeBlocks batch (one lock round trip) per chunk, instead of a freeBlock per block.
+// Released chunks are kept for the next request, so a context reused per worker or
+// connection stops allocating log memory after its first busy request.
+// Blocks taken through the context must not be freed individually.
+
+#ifndef MEM_POOL_REQUEST_H
+#define MEM_POOL_REQUEST_H
+
+#include "mem_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *****Defines*****
+
+#ifndef MEM_POOL_REQUEST_MAX_POOLS
+    #define MEM_POOL_REQUEST_MAX_POOLS 8
+#endif
+#define MEM_POOL_REQUEST_CHUNK_SIZE 62 // Blocks per log chunk, the chunk is 64 words
+
+// *****Types*****
+
+typedef struct MemoryPoolRequestChunk_s {
+    struct MemoryPoolRequestChunk_s* next;
+    size_t count;
+    void* blocks[MEM_POOL_REQUEST_CHUNK_SIZE];
+} MemoryPoolRequestChunk_t;
+
+typedef struct MemoryPoolRequestClass_s {
+    MemoryPool_t* pool;
+    MemoryPoolRequestChunk_t* chunk; // Newest first, NULL while nothing is logged
+} MemoryPoolRequestClass_t;
+
+typedef struct MemoryPoolRequest_s {
+    size_t numPools;
+    MemoryPoolRequestClass_t classes[MEM_POOL_REQUEST_MAX_POOLS];
+    MemoryPoolRequestChunk_t* spare; // Chunks of earlier requests
+} MemoryPoolRequest_t;
+
+// *****Library functions*****
+
+// pools sorted by block size. Returns 0 on success.
+int memPoolRequestInit(MemoryPoolRequest_t* request, MemoryPool_t* const* pools, size_t numPools);
+// Releases the outstanding blocks and frees the log chunks
+void memPoolRequestDestroy(MemoryPoolRequest_t* request);
+
+// Returns every block taken since the last release and their number. The context stays
+// ready for the next request.
+size_t memPoolRequestRelease(MemoryPoolRequest_t* request);
+
+// Slow path of the fast path: log block in a new chunk, or free it and return NULL
+void* memPoolRequestGrow(MemoryPoolRequest_t* request, MemoryPoolRequestClass_t* sizeClass, void* block);
+
+// *****Fast path*****
+
+// Block of at least size bytes, NULL if every class large enough is empty
+static inline void* allocateBlockRequest(MemoryPoolRequest_t* request, size_t size) {
+    for (size_t i = 0; i < request->numPools; ++i) {
+        MemoryPoolRequestClass_t* sizeClass = &request->classes[i];
+        if (sizeClass->pool->blockSize < size) continue;
+
+        void* block = allocateBlockSized(sizeClass->pool, size);
+        if (!block) continue;
+        MemoryPoolRequestChunk_t* chunk = sizeClass->chunk;
+        if (chunk && chunk->count < MEM_POOL_REQUEST_CHUNK_SIZE) {
+            chunk->blocks[chunk->count++] = block;
+            return block;
+        }
+        return memPoolRequestGrow(request, sizeClass, block);
+    }
+    return NULL;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MEM_POOL_REQUEST_H
@@ -0,0 +1,61 @@
+// Lock-free bounded MPMC ring as the shared free-block store of a pool.
+//
+// The linked free list makes every pop read the next pointer out of the block it takes,
+// so concurrent users serialize on that chain. The ring instead keeps the free block
+// pointers in an array with separate producer and consumer head/tail pairs (DPDK
+// rte_ring style): a bulk enqueue or dequeue reserves its whole range with one
+// compare-and-swap on the head, copies the pointers, then publishes by moving the tail.
+//
+// memPoolRingCreate moves every free block of the pool into the ring and sizes it for all
+// blocks of the pool, so blocks still in use may be freed into it later. From then on the
+// blocks circulate through the ring, normally fronted by per-task caches
+// (memPoolCacheInitRing), and the pool only provides the arena. Blocks held by the ring
+// count as in use in the pool statistics, and the pool's poison checks do not apply.
+
+#ifndef MEM_POOL_RING_H
+#define MEM_POOL_RING_H
+
+#include "mem_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *****Types*****
+
+// Head and tail of one side on a cache line of their own
+typedef struct MemoryPoolRingIndex_s {
+    uint32_t head;  // Next position to reserve
+    uint32_t tail;  // Positions below are complete
+    char pad[64 - 2 * sizeof(uint32_t)];
+} MemoryPoolRingIndex_t;
+
+typedef struct MemoryPoolRing_s {
+    MemoryPool_t* pool;
+    uint32_t mask;          // Slots - 1, slots is a power of two
+    uint32_t capacity;      // Blocks of the pool, so the ring can hold all of them
+    char pad[64 - sizeof(MemoryPool_t*) - 2 * sizeof(uint32_t)];
+    MemoryPoolRingIndex_t prod;
+    MemoryPoolRingIndex_t cons;
+    void* slots[1];
+} MemoryPoolRing_t;
+
+// *****Library functions*****
+
+// Takes every free block of pool. NULL if the pool has no free block or out of memory.
+MemoryPoolRing_t* memPoolRingCreate(MemoryPool_t* pool);
+// Gives the blocks in the ring back to the pool; the pool itself stays
+void memPoolRingDestroy(MemoryPoolRing_t* ring);
+
+// Up to count blocks, as many as available; returns the number moved
+size_t memPoolRingDequeue(MemoryPoolRing_t* ring, void** blocks, size_t count);
+size_t memPoolRingEnqueue(MemoryPoolRing_t* ring, void* const* blocks, size_t count);
+
+// Free blocks in the ring, a snapshot under concurrent use
+size_t memPoolRingCount(const MemoryPoolRing_t* ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MEM_POOL_RING_H
@@ -0,0 +1,46 @@
+// Copy-on-write pool templates: pre-initialized tiny pools instantiated by mapping (Linux).
+//
+// A template is a tiny pool (mem_pool_tiny.h) in a memfd. It is built once through
+// memPoolTemplatePool like any tiny pool: allocate blocks, fill them in, free what the
+// instances should start with free. memPoolTemplateSeal unmaps the build view and seals the
+// file against writes. Every memPoolTemplateInstantiate is then a MAP_PRIVATE mapping of the
+// image, free-list state included: one mmap whatever the pool size, pages are shared with
+// the template until an instance writes them and untouched pages are never copied.
+//
+// Instances live at different addresses, so blocks must refer to each other by offset or
+// index (tinyPoolArena), never by pointer. Links of the free list are position-independent.
+
+#ifndef MEM_POOL_TEMPLATE_H
+#define MEM_POOL_TEMPLATE_H
+
+#include "mem_pool_tiny.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *****Types*****
+
+typedef struct MemoryPoolTemplate_s MemoryPoolTemplate_t;
+
+// *****Library functions*****
+
+// Template of numBlocks blocks of blockSize (see tinyPoolFootprint). NULL on failure.
+MemoryPoolTemplate_t* memPoolTemplateCreate(const char* name, size_t blockSize, size_t numBlocks);
+// Instances stay valid, they hold their own reference to the image
+void memPoolTemplateDestroy(MemoryPoolTemplate_t* tmpl);
+
+// Writable view to build the template in, NULL once sealed
+MemoryPoolTiny_t* memPoolTemplatePool(MemoryPoolTemplate_t* tmpl);
+// End of building. Returns 0 on success.
+int memPoolTemplateSeal(MemoryPoolTemplate_t* tmpl);
+
+// Private copy-on-write pool initialized as the sealed template, NULL on failure
+MemoryPoolTiny_t* memPoolTemplateInstantiate(MemoryPoolTemplate_t* tmpl);
+void memPoolInstanceDestroy(MemoryPoolTiny_t* instance);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MEM_POOL_TEMPLATE_H
@@ -0,0 +1,59 @@
+// Tiered storage: cold blocks demoted to a file-backed overflow arena (Linux).
+//
+// A tier sits on top of a pool and hands out handles instead of pointers, because a
+// demoted block has no address in RAM. memPoolTierPin returns the address of a block and
+// promotes it back from the file first if needed; a pinned block is never demoted, so the
+// address stays valid until memPoolTierUnpin. Blocks are demoted explicitly
+// (memPoolTierDemote) or by access sampling: memPoolTierSweep demotes every resident block
+// not pinned since the previous sweep. When the pool runs dry, memPoolTierAllocate and
+// promotion make room by demoting one such block.
+//
+// The overflow arena is a MAP_SHARED mapping of an anonymous file in the given directory
+// (O_TMPFILE, or a unique name unlinked right after creation); its pages are page cache
+// the kernel can write back and reclaim.
+
+#ifndef MEM_POOL_TIER_H
+#define MEM_POOL_TIER_H
+
+#include "mem_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *****Types*****
+
+typedef uint32_t MemoryPoolHandle_t; // 0 is never a valid handle
+
+typedef struct MemoryPoolTier_s MemoryPoolTier_t;
+
+// *****Library functions*****
+
+// fileBlocks slots of pool->blockSize in a new anonymous file in directory dir.
+// NULL on failure.
+MemoryPoolTier_t* memPoolTierCreate(MemoryPool_t* pool, const char* dir, size_t fileBlocks);
+// Frees the blocks still held by handles; the pool itself stays
+void memPoolTierDestroy(MemoryPoolTier_t* tier);
+
+MemoryPoolHandle_t memPoolTierAllocate(MemoryPoolTier_t* tier);
+void memPoolTierFree(MemoryPoolTier_t* tier, MemoryPoolHandle_t handle);
+
+// Address of the block in RAM, promoting it if demoted (swapping places with a cold block
+// when the file is full); NULL if no unpinned block can make room
+void* memPoolTierPin(MemoryPoolTier_t* tier, MemoryPoolHandle_t handle);
+void memPoolTierUnpin(MemoryPoolTier_t* tier, MemoryPoolHandle_t handle);
+
+// Move an unpinned block to the file. Returns 0 on success.
+int memPoolTierDemote(MemoryPoolTier_t* tier, MemoryPoolHandle_t handle);
+// Demote every resident block not pinned since the last sweep. Returns their number.
+size_t memPoolTierSweep(MemoryPoolTier_t* tier);
+
+// Blocks held in RAM / in the file
+size_t memPoolTierResident(MemoryPoolTier_t* tier);
+size_t memPoolTierDemoted(MemoryPoolTier_t* tier);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MEM_POOL_TIER_H
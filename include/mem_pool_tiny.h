@@ -0,0 +1,146 @@
+// Tiny pools: a two-word descriptor at the head of a single backing allocation.
+//
+// For thousands of small single-owner pools (one per connection, say). The descriptor is
+// a 64-bit geometry word right before the arena, plus the link key and a corruption count:
+//   bits  0-15  block size in units of sizeof(void*)
+//   bits 16-31  number of blocks (at most MEM_POOL_TINY_MAX_BLOCKS)
+//   bits 32-47  free list head, block index + 1 (0: empty)
+//   bits 48-63  blocks carved so far; blocks past the mark were never handed out
+// Free blocks link by 16-bit index, mangled with MEM_POOL_SAFE_LINKING and range checked;
+// a bad link is counted and drops the free list, allocation goes on with uncarved blocks.
+// A freed pointer that is not the start of a carved block is counted and ignored.
+// Creation is one pvPortMalloc (or none with initTinyPool on caller memory) and touches
+// no block, blocks are carved on first use. There is no lock, statistics, poisoning or
+// tracing; use MemoryPool_t for shared pools.
+
+#ifndef MEM_POOL_TINY_H
+#define MEM_POOL_TINY_H
+
+#include "mem_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MEM_POOL_TINY_MAX_BLOCKS     0xFFFFu
+#define MEM_POOL_TINY_MAX_BLOCK_SIZE (0xFFFFu * sizeof(void*))
+
+// *****Types*****
+
+typedef struct MemoryPoolTiny_s {
+    uint64_t geometry;
+    uint16_t linkKey;       // Random per pool, part of the image so copies keep their links
+    uint16_t corruptions;   // Bad links and bad frees seen, saturates
+} MemoryPoolTiny_t; // The arena follows
+
+// *****Library functions*****
+
+// Bytes of one backing allocation for numBlocks blocks of blockSize, 0 if out of range
+size_t tinyPoolFootprint(size_t blockSize, size_t numBlocks);
+MemoryPoolTiny_t* createTinyPool(size_t blockSize, size_t numBlocks);
+void destroyTinyPool(MemoryPoolTiny_t* pool);
+// Pool in caller memory (pointer aligned), as many blocks as fit; NULL if none fits
+MemoryPoolTiny_t* initTinyPool(void* memory, size_t size, size_t blockSize);
+
+size_t tinyPoolCountFree(const MemoryPoolTiny_t* pool);
+
+// *****Geometry*****
+
+static inline size_t tinyPoolBlockSize(const MemoryPoolTiny_t* pool) {
+    return (size_t)(pool->geometry & 0xFFFF) * sizeof(void*);
+}
+
+static inline size_t tinyPoolNumBlocks(const MemoryPoolTiny_t* pool) {
+    return (size_t)(pool->geometry >> 16) & 0xFFFF;
+}
+
+static inline char* tinyPoolArena(const MemoryPoolTiny_t* pool) {
+    return (char*)(pool + 1);
+}
+
+static inline int tinyPoolOwnsBlock(const MemoryPoolTiny_t* pool, const void* block) {
+    const char* arena = tinyPoolArena(pool);
+    return (const char*)block >= arena && (const char*)block < arena + tinyPoolNumBlocks(pool) * tinyPoolBlockSize(pool);
+}
+
+// *****Free-list link encoding*****
+
+// Index + 1 of the next free block in the first bytes of block. The key mixes the pool's
+// random key with the offset in the pool rather than the address, so a pool image stays
+// valid wherever it is mapped.
+static inline uint16_t tinyPoolLinkKey(const MemoryPoolTiny_t* pool, const void* block) {
+#if MEM_POOL_SAFE_LINKING
+    uintptr_t offset = (uintptr_t)((const char*)block - (const char*)pool);
+    return (uint16_t)((offset >> 3) ^ (offset >> 19) ^ pool->linkKey);
+#else
+    (void)pool;
+    (void)block;
+    return 0;
+#endif
+}
+
+static inline void tinyPoolStoreLink(const MemoryPoolTiny_t* pool, void* block, unsigned next) {
+    uint16_t link = (uint16_t)(next ^ tinyPoolLinkKey(pool, block));
+    memcpy(block, &link, sizeof(link));
+}
+
+static inline unsigned tinyPoolLoadLink(const MemoryPoolTiny_t* pool, const void* block) {
+    uint16_t link;
+    memcpy(&link, block, sizeof(link));
+    return (unsigned)(uint16_t)(link ^ tinyPoolLinkKey(pool, block));
+}
+
+// *****Fast path*****
+
+static inline void* allocateTinyBlock(MemoryPoolTiny_t* pool) {
+    uint64_t geometry = pool->geometry;
+    size_t blockSize = (size_t)(geometry & 0xFFFF) * sizeof(void*);
+    unsigned numBlocks = (unsigned)(geometry >> 16) & 0xFFFF;
+    unsigned head = (unsigned)(geometry >> 32) & 0xFFFF;
+    const uint64_t headMask = (uint64_t)0xFFFF << 32;
+
+    if (head) {
+        char* block = tinyPoolArena(pool) + (size_t)(head - 1) * blockSize;
+        unsigned next = tinyPoolLoadLink(pool, block);
+        if (next <= numBlocks) {
+            pool->geometry = (geometry & ~headMask) | (uint64_t)next << 32;
+            ASAN_UNPOISON_MEMORY_REGION(block, blockSize);
+            return block;
+        }
+        // Link overwritten after free: count it and drop the list rather than follow it
+        if (pool->corruptions != 0xFFFF) ++pool->corruptions;
+        geometry &= ~headMask;
+        pool->geometry = geometry;
+    }
+
+    unsigned carved = (unsigned)(geometry >> 48);
+    if (carved == numBlocks) return NULL;
+    pool->geometry = geometry + ((uint64_t)1 << 48);
+    char* block = tinyPoolArena(pool) + (size_t)carved * blockSize;
+    ASAN_UNPOISON_MEMORY_REGION(block, blockSize);
+    return block;
+}
+
+static inline void freeTinyBlock(MemoryPoolTiny_t* pool, void* block) {
+    if (!block) return;
+    uint64_t geometry = pool->geometry;
+    size_t blockSize = (size_t)(geometry & 0xFFFF) * sizeof(void*);
+    // Wraps for pointers below the arena, so one compare rejects both sides
+    size_t offset = (size_t)((uintptr_t)block - (uintptr_t)tinyPoolArena(pool));
+    if (offset % blockSize != 0 || offset / blockSize >= (size_t)(geometry >> 48)) {
+        // Foreign, misaligned or never handed out: linking it would corrupt the descriptor
+        if (pool->corruptions != 0xFFFF) ++pool->corruptions;
+        return;
+    }
+    unsigned index = (unsigned)(offset / blockSize) + 1;
+
+    tinyPoolStoreLink(pool, block, (unsigned)(geometry >> 32) & 0xFFFF);
+    ASAN_POISON_MEMORY_REGION((char*)block + sizeof(MemoryBlock_t), blockSize - sizeof(MemoryBlock_t));
+    pool->geometry = (geometry & ~((uint64_t)0xFFFF << 32)) | (uint64_t)index << 32;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MEM_POOL_TINY_H
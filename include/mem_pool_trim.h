@@ -0,0 +1,79 @@
+// Returning free arena pages to the OS under memory pressure (Linux).
+//
+// memPoolTrim gives back every whole arena page whose blocks are all free: the blocks
+// are unlinked from the free list and the pages are dropped with madvise(MADV_DONTNEED).
+// memPoolRestore prefaults them and links the blocks back. allocateBlock restores
+// released pages by itself before reporting an exhausted pool.
+//
+// The pressure watcher is a background thread that polls PSI (/proc/pressure/memory)
+// and the cgroup v2 memory.events counters, trims the watched pools under pressure and
+// restores them after a quiet period.
+
+#ifndef MEM_POOL_TRIM_H
+#define MEM_POOL_TRIM_H
+
+#include "mem_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Both take the pool lock for the duration of the scan and the madvise calls.
+// Return the number of bytes released/restored.
+size_t memPoolTrim(MemoryPool_t* pool);
+size_t memPoolRestore(MemoryPool_t* pool);
+
+// memPoolTrim that leaves the pages of the first keepBlocks free blocks resident
+size_t memPoolTrimKeep(MemoryPool_t* pool, size_t keepBlocks);
+
+// True if block index lies on a released page; call with the pool lock held
+int memPoolBlockReleased(const MemoryPool_t* pool, size_t index);
+
+// Large-block mode for pools of big buffers (at least two pages per block): free blocks
+// past the hotBlocks most recently freed ones have their body dropped with
+// madvise(MADV_DONTNEED), only the page holding the link stays. Allocation prefers the
+// hot blocks, newest first, so RSS follows the buffers in flight plus the hot window.
+// Free blocks no longer sit on pool->freeList, and poison is not verified on allocation
+// because a released body reads back as zeros; freeBlock only poisons the block header.
+// Returns 0 on success.
+typedef struct MemoryPoolLarge_s {
+    MemoryBlock_t* cold;    // Blocks with released bodies, linked through their first page
+    size_t coldCount;
+    size_t hotLimit;
+    size_t hotStart;        // Oldest entry of the ring
+    size_t hotCount;
+    void* hot[1];           // Ring of hotLimit recently freed, resident blocks
+} MemoryPoolLarge_t;
+
+int memPoolSetLargeBlocks(MemoryPool_t* pool, size_t hotBlocks);
+
+// Hooks of allocateBlock/freeBlock for large-block pools
+void* memPoolLargeAllocate(MemoryPool_t* pool);
+int memPoolLargeFree(MemoryPool_t* pool, void* block);
+
+// Zero fields fall back to the defaults in brackets
+typedef struct MemoryPressureConfig_s {
+    const char* psiPath;            // PSI file [/proc/pressure/memory]
+    const char* eventsPath;         // cgroup v2 memory.events [/sys/fs/cgroup/memory.events]
+    double trimAvg10;               // "some avg10" (%) that starts trimming [10.0]
+    double restoreAvg10;            // "some avg10" (%) below which the system is quiet [1.0]
+    unsigned intervalMs;            // Polling period [1000]
+    unsigned quietIntervals;        // Quiet periods in a row before restoring [10]
+} MemoryPressureConfig_t;
+
+#define MEM_POOL_PRESSURE_MAX_POOLS 64
+
+// Start/stop the watcher thread; config may be NULL. Return 0 on success.
+int memPoolPressureStart(const MemoryPressureConfig_t* config);
+void memPoolPressureStop(void);
+
+// Add/remove a pool to/from the watcher. The watcher trims from its own thread, so only
+// pools created with a lock are accepted. A pool must be unwatched before destroy.
+int memPoolPressureWatch(MemoryPool_t* pool);
+void memPoolPressureUnwatch(MemoryPool_t* pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MEM_POOL_TRIM_H
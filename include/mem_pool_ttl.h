@@ -0,0 +1,70 @@
+// Auto-expiring blocks: allocateBlockTTL on a hierarchical timer wheel.
+//
+// Time is counted in ticks of the caller's choice (milliseconds, RTOS ticks...) and
+// moved forward with memPoolTtlAdvance. Expiry times live in per-block side metadata,
+// linked into a wheel of MEM_POOL_TTL_LEVELS levels of 64 slots: level n holds timers
+// 64^n..64^(n+1) ticks ahead and is cascaded one level down every 64^n ticks, so a tick
+// costs O(1) amortized and arming/cancelling O(1). memPoolTtlAdvance skips ticks that
+// neither expire nor cascade a timer, so a long advance costs the number of events, not
+// the number of ticks. Freeing a TTL block cancels its timer.
+
+#ifndef MEM_POOL_TTL_H
+#define MEM_POOL_TTL_H
+
+#include "mem_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *****Defines*****
+
+#define MEM_POOL_TTL_LEVELS    4
+#define MEM_POOL_TTL_SLOT_BITS 6
+#define MEM_POOL_TTL_SLOTS     (1u << MEM_POOL_TTL_SLOT_BITS)
+
+// *****Types*****
+
+// Called outside the pool lock for an expired block. Return nonzero to let the pool
+// free it, 0 if the callback keeps it (it may also re-arm it with memPoolTtlRefresh).
+typedef int (*MemoryPoolExpire_t)(void* context, void* block);
+
+typedef struct MemoryPoolTimer_s {
+    uint64_t expiry;            // Absolute tick
+    MemoryPoolExpire_t expire;  // NULL: freed on expiry
+    uint32_t next;              // Block index + 1 in the slot list, 0 ends it
+    uint32_t prev;
+    uint16_t slot;              // Wheel slot, expired list or MEM_POOL_TTL_IDLE
+} MemoryPoolTimer_t;
+
+typedef struct MemoryPoolTtl_s {
+    uint64_t now;
+    void* context;
+    uint32_t heads[MEM_POOL_TTL_LEVELS * MEM_POOL_TTL_SLOTS + 1]; // Last one: expired list
+    size_t armed;
+    MemoryPoolTimer_t timers[1]; // One per block
+} MemoryPoolTtl_t;
+
+// *****Library functions*****
+
+// Attach a timer wheel starting at tick now. Returns 0 on success.
+int memPoolTtlEnable(MemoryPool_t* pool, uint64_t now, void* context);
+
+// allocateBlock that expires ttl ticks after the current tick (at least one). Never
+// spills to a larger class: NULL once the pool's own arena is exhausted.
+void* allocateBlockTTL(MemoryPool_t* pool, uint64_t ttl, MemoryPoolExpire_t expire);
+
+// Re-arm a TTL block, e.g. on session activity. Returns 0 on success.
+int memPoolTtlRefresh(MemoryPool_t* pool, void* block, uint64_t ttl);
+
+// Move the clock to now, hand out every timer that expired. Returns their number.
+size_t memPoolTtlAdvance(MemoryPool_t* pool, uint64_t now);
+
+// Disarm the timer of block; freeBlock calls it for blocks of a TTL pool
+void memPoolTtlCancel(MemoryPool_t* pool, void* block);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MEM_POOL_TTL_H
@@ -0,0 +1,553 @@
+// Author: D.S. Koshelev, updated by ChatGPT
+// Created: 05/04/2023
+// Requirement: Portable for C and FreeRTOS
+//
+// Slow paths of the block allocator: pool creation and destruction, error reporting.
+// Pools do not grow: the arena is sized once at creation, as required for embedded use.
+
+#include "mem_pool.h"
+#include "mem_pool_evict.h"
+#include "mem_pool_ttl.h"
+#if MEM_POOL_TRIM
+    #include "mem_pool_trim.h"
+#endif
+
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+
+// *****Local defines*****
+
+// Entropy source for the per-pool secret. On target, point it to a hardware RNG.
+#ifndef MEM_POOL_ENTROPY
+    #define MEM_POOL_ENTROPY() ((uint64_t)time(NULL) ^ ((uint64_t)clock() << 32))
+#endif
+
+// Enable standalone build without FreeRTOS
+#ifndef USE_FREERTOS
+    #define pvPortMalloc malloc
+    #define pvPortFree   free
+#else
+    #define pvPortFree   vPortFree
+#endif
+
+// *****Local variables*****
+
+#if MEM_POOL_TRACE
+static FILE* traceFile = NULL;
+static volatile char traceLock = 0;
+#endif
+
+// *****Local functions*****
+
+#if MEM_POOL_POISON
+static size_t roundUpPow2(size_t value) {
+    size_t result = 1;
+    while (result < value && result << 1) result <<= 1;
+    return result;
+}
+#endif
+
+static uint64_t nowNs(void) {
+#ifdef USE_FREERTOS
+    return (uint64_t)xTaskGetTickCount() * (1000000000ULL / configTICK_RATE_HZ);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static int isMutexLock(MemoryPoolLock_t lockType) {
+    return lockType == MEM_POOL_LOCK_MUTEX || lockType == MEM_POOL_LOCK_PI_MUTEX;
+}
+
+static int initPoolLock(MemoryPool_t* pool) {
+    pool->spinLock = 0;
+    if (!isMutexLock(pool->lockType)) return 1;
+#ifdef USE_FREERTOS
+    // FreeRTOS mutexes inherit priority, both mutex types map to them
+    pool->mutex = xSemaphoreCreateMutex();
+    return pool->mutex != NULL;
+#else
+    if (pool->lockType == MEM_POOL_LOCK_MUTEX) return pthread_mutex_init(&pool->mutex, NULL) == 0;
+
+    // A low-priority holder is raised to the priority of the highest waiter, so medium
+    // priority work cannot keep a high-priority allocator blocked
+    pthread_mutexattr_t attr;
+    if (pthread_mutexattr_init(&attr) != 0) return 0;
+    int ok = pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT) == 0 &&
+             pthread_mutex_init(&pool->mutex, &attr) == 0;
+    pthread_mutexattr_destroy(&attr);
+    return ok;
+#endif
+}
+
+static void deinitPoolLock(MemoryPool_t* pool) {
+    if (!isMutexLock(pool->lockType)) return;
+#ifdef USE_FREERTOS
+    vSemaphoreDelete(pool->mutex);
+#else
+    pthread_mutex_destroy(&pool->mutex);
+#endif
+}
+
+#if MEM_POOL_POISON
+// Word-wise OR of differences without early exit, so the loop vectorizes.
+// Returns the offset of the first corrupted byte or 0 if the pattern is intact.
+static size_t findPoisonViolation(const MemoryPool_t* pool, const MemoryBlock_t* block) {
+    const uintptr_t pattern = (uintptr_t)-1 / 0xFF * MEM_POOL_POISON_BYTE;
+    const uintptr_t* words = (const uintptr_t*)(block + 1);
+    size_t numWords = (pool->blockSize - sizeof(MemoryBlock_t)) / sizeof(uintptr_t);
+
+    uintptr_t diff = 0;
+    for (size_t i = 0; i < numWords; ++i) diff |= words[i] ^ pattern;
+    if (!diff) return 0;
+
+    const unsigned char* bytes = (const unsigned char*)block;
+    size_t offset = sizeof(MemoryBlock_t);
+    while (bytes[offset] == (unsigned char)MEM_POOL_POISON_BYTE) ++offset;
+    return offset;
+}
+#endif
+
+// *****Library functions*****
+
+MemoryPool_t* createMemoryPool(size_t blockSize, size_t poolSize) {
+    return createMemoryPoolEx(blockSize, poolSize, MEM_POOL_LOCK_NONE);
+}
+
+MemoryPool_t* createMemoryPoolEx(size_t blockSize, size_t poolSize, MemoryPoolLock_t lockType) {
+    assert(blockSize >= sizeof(MemoryBlock_t));
+    assert(poolSize > blockSize);
+    assert(blockSize % sizeof(void*) == 0); // Ensure alignment
+
+    void* poolMemory = pvPortMalloc(poolSize);
+    if (!poolMemory) return NULL;
+
+    MemoryPool_t* pool = (MemoryPool_t*)pvPortMalloc(sizeof(MemoryPool_t));
+    if (!pool) {
+        pvPortFree(poolMemory);
+        return NULL;
+    }
+
+    pool->memoryStart = poolMemory;
+    pool->memoryEnd = (char*)poolMemory + poolSize;
+    pool->freeList = NULL;
+    pool->blockSize = blockSize;
+    pool->poolSize = poolSize;
+    pool->lockType = lockType;
+    if (!initPoolLock(pool)) {
+        pvPortFree(poolMemory);
+        pvPortFree(pool);
+        return NULL;
+    }
+    pool->linkSecret = memPoolMakeSecret(pool, poolMemory);
+    pool->corruptions = 0;
+    pool->cacheLimit = MEM_POOL_CACHE_SIZE;
+    pool->inUse = 0;
+    pool->highWater = 0;
+    pool->spillPool = NULL;
+    pool->spillLimit = 0;
+    pool->spills = 0;
+    pool->freeHooks = 0;
+    pool->evictMeta = NULL;
+    pool->evict = NULL;
+    pool->evictContext = NULL;
+    pool->evictHand = 0;
+    pool->evictions = 0;
+    pool->ttl = NULL;
+#if MEM_POOL_TRIM
+    pool->large = NULL;
+#endif
+    pool->contentions = 0;
+    pool->adaptiveLimit = 0;
+    pool->adaptBusy = 0;
+    pool->adaptQuiet = 0;
+    pool->adaptBase = 0;
+    pool->adaptStart = 0;
+    pool->adaptCalls = 0;
+#if MEM_POOL_POISON
+    pool->poisonTick = 0;
+    pool->poisonMask = roundUpPow2(MEM_POOL_POISON_SAMPLE) - 1;
+#endif
+#if MEM_POOL_TRACE
+    pool->traceEnabled = 0;
+#endif
+#if MEM_POOL_TRIM
+    pool->releasedPages = NULL;
+    pool->releasedBlocks = 0;
+#endif
+
+    size_t numBlocks = poolSize / blockSize;
+    for (size_t i = 0; i < numBlocks; ++i) {
+        MemoryBlock_t* block = (MemoryBlock_t*)((char*)poolMemory + i * blockSize);
+        memPoolStoreLink(pool, block, pool->freeList);
+        memPoolPoisonBlock(pool, block);
+        pool->freeList = block;
+    }
+
+#ifdef DEBUGPRINT
+    printf("Pool memory Start = %p\n", poolMemory);
+    printf("Pool memory End   = %p\n", pool->memoryEnd);
+#endif
+
+    return pool;
+}
+
+void destroyMemoryPool(MemoryPool_t* pool) {
+    if (!pool) return;
+
+    deinitPoolLock(pool);
+    free(pool->evictMeta);
+    free(pool->ttl);
+#if MEM_POOL_TRIM
+    free(pool->releasedPages);
+    free(pool->large);
+#endif
+    ASAN_UNPOISON_MEMORY_REGION(pool->memoryStart, pool->poolSize);
+    pvPortFree(pool->memoryStart);
+    pvPortFree(pool);
+
+#ifdef DEBUGPRINT
+    printf("\n### Memory Pool Destroyed ###\n");
+#endif
+}
+
+size_t allocateBlocks(MemoryPool_t* pool, void** blocks, size_t count) {
+    if (!pool || !blocks) return 0;
+
+    size_t numBlocks = 0;
+    MemoryBlock_t* corrupted = NULL;
+#if MEM_POOL_POISON
+    size_t firstTick;
+#endif
+
+    memPoolLock(pool);
+#if MEM_POOL_POISON
+    firstTick = pool->poisonTick;
+#endif
+    while (numBlocks < count && pool->freeList) {
+        MemoryBlock_t* block = pool->freeList;
+        MemoryBlock_t* next = memPoolLoadLink(pool, block);
+        if (!memPoolIsValidLink(pool, next)) {
+            pool->freeList = NULL;
+            corrupted = block;
+            break;
+        }
+        pool->freeList = next;
+        blocks[numBlocks++] = block;
+    }
+    pool->inUse += numBlocks;
+    if (pool->inUse > pool->highWater) pool->highWater = pool->inUse;
+#if MEM_POOL_POISON
+    pool->poisonTick += numBlocks;
+#endif
+    memPoolUnlock(pool);
+
+    if (corrupted) memPoolReportCorruption(pool, corrupted, 0);
+    for (size_t i = 0; i < numBlocks; ++i) {
+        ASAN_UNPOISON_MEMORY_REGION(blocks[i], pool->blockSize);
+#if MEM_POOL_POISON
+        if (((firstTick + i + 1) & pool->poisonMask) == 0) memPoolVerifyPoison(pool, (MemoryBlock_t*)blocks[i]);
+#endif
+#if MEM_POOL_TRACE
+        if (pool->traceEnabled) memPoolTraceEvent(pool, 'a', blocks[i], 0);
+#endif
+    }
+
+    if (numBlocks == 0 && count > 0 && !corrupted) {
+        blocks[0] = memPoolAllocateSlow(pool);
+        numBlocks = blocks[0] != NULL;
+    }
+    return numBlocks;
+}
+
+void freeBlocks(MemoryPool_t* pool, void* const* blocks, size_t count) {
+    if (!pool || !blocks) return;
+
+    // Spill, eviction, TTL and large-block pools take the per-block route
+    if (pool->freeHooks) {
+        for (size_t i = 0; i < count; ++i) freeBlock(pool, blocks[i]);
+        return;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+#if MEM_POOL_TRACE
+        if (pool->traceEnabled) memPoolTraceEvent(pool, 'f', blocks[i], 0);
+#endif
+        memPoolPoisonBlock(pool, (MemoryBlock_t*)blocks[i]);
+    }
+
+    memPoolLock(pool);
+    for (size_t i = 0; i < count; ++i) {
+        MemoryBlock_t* block = (MemoryBlock_t*)blocks[i];
+        memPoolStoreLink(pool, block, pool->freeList);
+        pool->freeList = block;
+    }
+    pool->inUse -= count;
+    memPoolUnlock(pool);
+}
+
+void memPoolSetCacheLimit(MemoryPool_t* pool, size_t limit) {
+    if (limit > MEM_POOL_CACHE_SIZE) limit = MEM_POOL_CACHE_SIZE;
+    __atomic_store_n(&pool->cacheLimit, limit, __ATOMIC_RELAXED);
+}
+
+// rate 0 switches verification off
+void memPoolSetPoisonSample(MemoryPool_t* pool, size_t rate) {
+#if MEM_POOL_POISON
+    memPoolLock(pool);
+    pool->poisonMask = rate ? roundUpPow2(rate) - 1 : (size_t)-1;
+    memPoolUnlock(pool);
+#else
+    (void)pool;
+    (void)rate;
+#endif
+}
+
+size_t memPoolCountFree(MemoryPool_t* pool) {
+    size_t count = 0;
+    memPoolLock(pool);
+    for (MemoryBlock_t* block = pool->freeList; block; block = memPoolLoadLink(pool, block)) {
+        if (!memPoolIsValidLink(pool, block)) break;
+        ++count;
+    }
+#if MEM_POOL_TRIM
+    if (pool->large) count += pool->large->hotCount + pool->large->coldCount;
+#endif
+    memPoolUnlock(pool);
+    return count;
+}
+
+void memPoolSetAdaptive(MemoryPool_t* pool, size_t maxCacheLimit) {
+    if (maxCacheLimit > MEM_POOL_CACHE_SIZE) maxCacheLimit = MEM_POOL_CACHE_SIZE;
+    while (__atomic_test_and_set(&pool->adaptBusy, __ATOMIC_ACQUIRE)) memPoolCpuRelax();
+    pool->adaptQuiet = 0;
+    pool->adaptBase = __atomic_load_n(&pool->contentions, __ATOMIC_RELAXED);
+    pool->adaptStart = nowNs();
+    pool->adaptCalls = 0;
+    __atomic_store_n(&pool->adaptiveLimit, maxCacheLimit, __ATOMIC_RELAXED);
+    if (maxCacheLimit) __atomic_store_n(&pool->cacheLimit, 0, __ATOMIC_RELAXED);
+    __atomic_clear(&pool->adaptBusy, __ATOMIC_RELEASE);
+}
+
+// One caller evaluates at a time, the others skip
+void memPoolAdapt(MemoryPool_t* pool) {
+    size_t maxLimit = __atomic_load_n(&pool->adaptiveLimit, __ATOMIC_RELAXED);
+    if (!maxLimit || __atomic_test_and_set(&pool->adaptBusy, __ATOMIC_ACQUIRE)) return;
+
+    uint64_t now = nowNs();
+    uint64_t elapsed = now - pool->adaptStart;
+    if (elapsed >= MEM_POOL_ADAPT_WINDOW_NS) {
+        size_t contentions = __atomic_load_n(&pool->contentions, __ATOMIC_RELAXED);
+        // Rate per window; a window may span a long time without any caller
+        uint64_t scaled = (uint64_t)(contentions - pool->adaptBase) * MEM_POOL_ADAPT_WINDOW_NS;
+        if (scaled >= (uint64_t)MEM_POOL_ADAPT_CONTENDED * elapsed) {
+            __atomic_store_n(&pool->cacheLimit, maxLimit, __ATOMIC_RELAXED);
+            pool->adaptQuiet = 0;
+        } else if (scaled <= (uint64_t)MEM_POOL_ADAPT_QUIET * elapsed) {
+            if (++pool->adaptQuiet >= MEM_POOL_ADAPT_QUIET_WINDOWS) {
+                __atomic_store_n(&pool->cacheLimit, 0, __ATOMIC_RELAXED);
+                pool->adaptQuiet = 0;
+            }
+        } else {
+            pool->adaptQuiet = 0;
+        }
+        pool->adaptBase = contentions;
+        pool->adaptStart = now;
+    }
+    __atomic_clear(&pool->adaptBusy, __ATOMIC_RELEASE);
+}
+
+// Called on contended acquisitions and by the cache slow paths. The count is a plain
+// load and store: a lost increment only delays the next evaluation.
+void memPoolAdaptTick(MemoryPool_t* pool) {
+    if (!__atomic_load_n(&pool->adaptiveLimit, __ATOMIC_RELAXED)) return;
+    size_t calls = __atomic_load_n(&pool->adaptCalls, __ATOMIC_RELAXED) + 1;
+    __atomic_store_n(&pool->adaptCalls, calls, __ATOMIC_RELAXED);
+    if ((calls & (MEM_POOL_ADAPT_CHECK_EVERY - 1)) == 0) memPoolAdapt(pool);
+}
+
+// First attempt of memPoolLock failed
+void memPoolLockContended(MemoryPool_t* pool) {
+    __atomic_fetch_add(&pool->contentions, 1, __ATOMIC_RELAXED);
+    memPoolAdaptTick(pool);
+    if (pool->lockType == MEM_POOL_LOCK_SPIN) {
+#ifndef USE_FREERTOS
+        do {
+            while (__atomic_load_n(&pool->spinLock, __ATOMIC_RELAXED)) memPoolCpuRelax();
+        } while (__atomic_test_and_set(&pool->spinLock, __ATOMIC_ACQUIRE));
+#endif
+    } else {
+#ifdef USE_FREERTOS
+        (void)xSemaphoreTake(pool->mutex, portMAX_DELAY);
+#else
+        pthread_mutex_lock(&pool->mutex);
+#endif
+    }
+}
+
+int memPoolSetSpill(MemoryPool_t* pool, MemoryPool_t* larger, unsigned maxWastePercent) {
+    if (!pool || pool == larger) return -1;
+    if (larger && larger->blockSize <= pool->blockSize) return -1;
+    pool->spillPool = larger;
+    pool->spillLimit = pool->blockSize + pool->blockSize * maxWastePercent / 100;
+    memPoolUpdateFreeHooks(pool);
+    return 0;
+}
+
+// Free list is empty; pool's own arena only: large blocks, released pages, eviction
+static void* allocateOwnSlow(MemoryPool_t* pool) {
+#if MEM_POOL_TRIM
+    // Large-block pools keep their free blocks off the free list
+    if (pool->large) {
+        void* block = memPoolLargeAllocate(pool);
+        if (block) return block;
+    }
+    // Pages released under memory pressure come back before the pool reports exhaustion
+    if (__atomic_load_n(&pool->releasedBlocks, __ATOMIC_RELAXED) && memPoolRestore(pool)) {
+        void* block = memPoolTryAllocate(pool, 0);
+        if (block) return block;
+    }
+#endif
+    // A cache pool reuses its coldest block before borrowing memory elsewhere
+    if (pool->evictMeta) {
+        void* block = memPoolEvict(pool);
+        if (block) return block;
+    }
+    return NULL;
+}
+
+void* memPoolAllocateOwn(MemoryPool_t* pool) {
+    if (!pool) return NULL;
+    void* block = memPoolTryAllocate(pool, 0);
+    return block ? block : allocateOwnSlow(pool);
+}
+
+// Free list is empty
+void* memPoolAllocateSlow(MemoryPool_t* pool) {
+    void* block = allocateOwnSlow(pool);
+    if (block) return block;
+    // Borrow from the larger classes; each of them restores its own pages first
+    for (MemoryPool_t* larger = pool->spillPool; larger && larger->blockSize <= pool->spillLimit;
+         larger = larger->spillPool) {
+        void* block = memPoolTryAllocate(larger, 0);
+#if MEM_POOL_TRIM
+        if (!block && __atomic_load_n(&larger->releasedBlocks, __ATOMIC_RELAXED) && memPoolRestore(larger)) {
+            block = memPoolTryAllocate(larger, 0);
+        }
+#endif
+        if (block) {
+            __atomic_fetch_add(&pool->spills, 1, __ATOMIC_RELAXED);
+            return block;
+        }
+    }
+    return NULL;
+}
+
+// Pool has a spill chain, eviction, TTL or large blocks: returns 1 if block went to another pool,
+// 0 if the caller links it into pool
+int memPoolFreeHook(MemoryPool_t* pool, void* block) {
+    if (pool->spillPool && !memPoolOwnsBlock(pool, block)) {
+        memPoolFreeSpilled(pool, block);
+        return 1;
+    }
+    if (pool->evictMeta) memPoolForget(pool, block);
+    if (pool->ttl) memPoolTtlCancel(pool, block);
+#if MEM_POOL_TRIM
+    if (pool->large) return memPoolLargeFree(pool, block);
+#endif
+    return 0;
+}
+
+void memPoolUpdateFreeHooks(MemoryPool_t* pool) {
+    int hooks = pool->spillPool || pool->evictMeta || pool->ttl;
+#if MEM_POOL_TRIM
+    hooks = hooks || pool->large;
+#endif
+    pool->freeHooks = hooks;
+}
+
+// Block lies outside the arena of pool: return it to the class along the chain that owns it
+void memPoolFreeSpilled(MemoryPool_t* pool, void* block) {
+    for (MemoryPool_t* owner = pool->spillPool; owner; owner = owner->spillPool) {
+        if (memPoolOwnsBlock(owner, block)) {
+            freeBlock(owner, block);
+            return;
+        }
+    }
+    // Not from this chain, the caller freed into the wrong pool
+    memPoolReportCorruption(pool, block, 0);
+}
+
+// splitmix64 finalizer, spreads weak entropy over all bits of the secret
+uintptr_t memPoolMakeSecret(const void* pool, const void* memory) {
+    static uint64_t counter = 0;
+    uint64_t x = MEM_POOL_ENTROPY() ^ (uint64_t)(uintptr_t)pool ^ ((uint64_t)(uintptr_t)memory << 16);
+    x += 0x9E3779B97F4A7C15ULL * __atomic_add_fetch(&counter, 1, __ATOMIC_RELAXED);
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return (uintptr_t)x;
+}
+
+// offset == 0: free-list link of the block failed decoding,
+// otherwise: first byte of the block written after free.
+void memPoolReportCorruption(MemoryPool_t* pool, const void* block, size_t offset) {
+    __atomic_fetch_add(&pool->corruptions, 1, __ATOMIC_RELAXED);
+#ifdef DEBUGPRINT
+    if (offset == 0) {
+        printf("\nFree-list corruption detected in block %p\n", block);
+    } else {
+        printf("\nUse-after-free write detected in block %p at offset %u\n", block, (unsigned)offset);
+    }
+#else
+    (void)block;
+    (void)offset;
+#endif
+}
+
+void memPoolVerifyPoison(MemoryPool_t* pool, const MemoryBlock_t* block) {
+#if MEM_POOL_POISON
+    size_t offset = findPoisonViolation(pool, block);
+    // Written after free; the block is still handed out, its old content is dead anyway
+    if (offset) memPoolReportCorruption(pool, block, offset);
+#else
+    (void)pool;
+    (void)block;
+#endif
+}
+
+#if MEM_POOL_TRACE
+// One text line per event: time_ns pool block_size op block requested_size
+void memPoolTraceEvent(const MemoryPool_t* pool, char op, const void* block, size_t size) {
+    unsigned long long now = (unsigned long long)nowNs();
+    while (__atomic_test_and_set(&traceLock, __ATOMIC_ACQUIRE)) memPoolCpuRelax();
+    if (traceFile) {
+        fprintf(traceFile, "%llu %p %u %c %p %u\n", now, (const void*)pool, (unsigned)pool->blockSize,
+                op, block, (unsigned)size);
+    }
+    __atomic_clear(&traceLock, __ATOMIC_RELEASE);
+}
+
+int memPoolTraceOpen(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (!file) return -1;
+    fprintf(file, "# mem_pool trace v1: time_ns pool block_size op block requested_size\n");
+    while (__atomic_test_and_set(&traceLock, __ATOMIC_ACQUIRE)) memPoolCpuRelax();
+    FILE* previous = traceFile;
+    traceFile = file;
+    __atomic_clear(&traceLock, __ATOMIC_RELEASE);
+    if (previous) fclose(previous);
+    return 0;
+}
+
+void memPoolTraceClose(void) {
+    while (__atomic_test_and_set(&traceLock, __ATOMIC_ACQUIRE)) memPoolCpuRelax();
+    FILE* file = traceFile;
+    traceFile = NULL;
+    __atomic_clear(&traceLock, __ATOMIC_RELEASE);
+    if (file) fclose(file);
+}
+#endif
@@ -0,0 +1,79 @@
+// Per-task block cache: batch refill and drain
+
+#include "mem_pool_cache.h"
+
+// *****Local functions*****
+
+// The ring has room for every block of the pool, so a short enqueue means blocks that
+// never came from it (freed twice or foreign). The ones that did not fit are counted as
+// corruptions and dropped: linking them anywhere would hand a block out twice
+static void release(MemoryPoolCache_t* cache, void* const* blocks, size_t count) {
+    if (!cache->ring) {
+        freeBlocks(cache->pool, blocks, count);
+        return;
+    }
+    size_t numQueued = memPoolRingEnqueue(cache->ring, blocks, count);
+    for (size_t i = numQueued; i < count; ++i) memPoolReportCorruption(cache->pool, blocks[i], 0);
+}
+
+// *****Library functions*****
+
+void memPoolCacheInit(MemoryPoolCache_t* cache, MemoryPool_t* pool) {
+    cache->pool = pool;
+    cache->ring = NULL;
+    cache->count = 0;
+}
+
+void memPoolCacheInitRing(MemoryPoolCache_t* cache, MemoryPoolRing_t* ring) {
+    cache->pool = ring->pool;
+    cache->ring = ring;
+    cache->count = 0;
+}
+
+void memPoolCacheFlush(MemoryPoolCache_t* cache) {
+    for (size_t i = 0; i < cache->count; ++i) {
+        ASAN_UNPOISON_MEMORY_REGION(cache->blocks[i], cache->pool->blockSize);
+    }
+    release(cache, cache->blocks, cache->count);
+    cache->count = 0;
+}
+
+// Cache is empty: take half of the limit in one batch, hand out the last one
+void* memPoolCacheRefill(MemoryPoolCache_t* cache) {
+    if (!cache->ring) memPoolAdaptTick(cache->pool);
+    size_t limit = __atomic_load_n(&cache->pool->cacheLimit, __ATOMIC_RELAXED);
+    size_t batch = limit / 2 ? limit / 2 : 1;
+    if (limit == 0 && !cache->ring) return allocateBlock(cache->pool);
+
+    // One reservation on the ring, or one lock round trip on the pool
+    size_t numBlocks = cache->ring ? memPoolRingDequeue(cache->ring, cache->blocks, batch)
+                                   : allocateBlocks(cache->pool, cache->blocks, batch);
+    if (numBlocks == 0) return NULL;
+
+    for (size_t i = 0; i + 1 < numBlocks; ++i) {
+        ASAN_POISON_MEMORY_REGION(cache->blocks[i], cache->pool->blockSize);
+    }
+    cache->count = numBlocks - 1;
+    return cache->blocks[numBlocks - 1];
+}
+
+// Cache is at its limit (or above it after the limit was lowered): keep half of the limit
+void memPoolCacheDrain(MemoryPoolCache_t* cache, void* blockAddr) {
+    if (!cache->ring) memPoolAdaptTick(cache->pool);
+    size_t limit = __atomic_load_n(&cache->pool->cacheLimit, __ATOMIC_RELAXED);
+    size_t keep = limit / 2;
+    if (keep > cache->count) keep = cache->count;
+
+    for (size_t i = keep; i < cache->count; ++i) {
+        ASAN_UNPOISON_MEMORY_REGION(cache->blocks[i], cache->pool->blockSize);
+    }
+    release(cache, cache->blocks + keep, cache->count - keep);
+    cache->count = keep;
+
+    if (cache->count < limit) {
+        ASAN_POISON_MEMORY_REGION(blockAddr, cache->pool->blockSize);
+        cache->blocks[cache->count++] = blockAddr;
+    } else {
+        release(cache, &blockAddr, 1);
+    }
+}
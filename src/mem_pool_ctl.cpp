@@ -0,0 +1,352 @@
+// Run-time control endpoint for pool introspection and tuning (Linux)
+
+#include "mem_pool_ctl.h"
+#include "mem_pool_occupancy.h"
+#include "mem_pool_trim.h"
+
+#include <stdlib.h>
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// *****Local defines*****
+
+#define CTL_LINE_SIZE   256
+#define CTL_POLL_MS     200
+#define CTL_IDLE_MS     1000 // A client silent this long is dropped so others get served
+#define CTL_MAP_COLUMNS 64
+#define CTL_PATH_SIZE   4096
+
+// *****Local types*****
+
+typedef struct CtlEntry_s {
+    MemoryPool_t* pool;
+    char name[MEM_POOL_CTL_NAME_SIZE];
+} CtlEntry_t;
+
+typedef struct CtlServer_s {
+    CtlEntry_t entries[MEM_POOL_CTL_MAX_POOLS]; // pool == NULL: free slot, index is the id
+    pthread_mutex_t mutex;                      // Held while a command runs
+    pthread_t thread;
+    int listenFd;
+    int running;
+    int stop;                                   // Accessed atomically
+    char path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+    char traceDir[CTL_PATH_SIZE];               // "trace open" writes only here, empty: disabled
+} CtlServer_t;
+
+// *****Local variables*****
+
+static CtlServer_t server = { {}, PTHREAD_MUTEX_INITIALIZER, 0, -1, 0, 0, {}, {} };
+
+static const char* const lockNames[] = { "none", "spin", "mutex", "pi-mutex" };
+
+// *****Local functions*****
+
+static MemoryPool_t* poolById(int id) {
+    if (id < 0 || id >= MEM_POOL_CTL_MAX_POOLS) return NULL;
+    return server.entries[id].pool;
+}
+
+// From the counters, without the pool lock: this thread runs at idle priority and would
+// keep spin-lock waiters spinning behind it
+static void printStats(FILE* out, int id, int verbose) {
+    MemoryPool_t* pool = server.entries[id].pool;
+    size_t numBlocks = pool->poolSize / pool->blockSize;
+    size_t released = __atomic_load_n(&pool->releasedBlocks, __ATOMIC_RELAXED);
+    size_t inUse = __atomic_load_n(&pool->inUse, __ATOMIC_RELAXED);
+    size_t numFree = inUse + released < numBlocks ? numBlocks - inUse - released : 0;
+    size_t corruptions = __atomic_load_n(&pool->corruptions, __ATOMIC_RELAXED);
+    size_t cacheLimit = __atomic_load_n(&pool->cacheLimit, __ATOMIC_RELAXED);
+    size_t highWater = __atomic_load_n(&pool->highWater, __ATOMIC_RELAXED);
+
+    if (!verbose) {
+        fprintf(out, "%d %s %u %u %u %u %u %u %s %u %u\n", id, server.entries[id].name,
+                (unsigned)pool->blockSize, (unsigned)numBlocks, (unsigned)numFree, (unsigned)inUse,
+                (unsigned)released, (unsigned)corruptions, lockNames[pool->lockType], (unsigned)cacheLimit,
+                (unsigned)highWater);
+        return;
+    }
+    fprintf(out, "name=%s\n", server.entries[id].name);
+    fprintf(out, "block_size=%u\n", (unsigned)pool->blockSize);
+    fprintf(out, "pool_size=%u\n", (unsigned)pool->poolSize);
+    fprintf(out, "blocks=%u\n", (unsigned)numBlocks);
+    fprintf(out, "free=%u\n", (unsigned)numFree);
+    fprintf(out, "in_use=%u\n", (unsigned)inUse);
+    fprintf(out, "released=%u\n", (unsigned)released);
+    fprintf(out, "corruptions=%u\n", (unsigned)corruptions);
+    fprintf(out, "lock=%s\n", lockNames[pool->lockType]);
+    fprintf(out, "cache_limit=%u\n", (unsigned)cacheLimit);
+    fprintf(out, "high_water=%u\n", (unsigned)highWater);
+    fprintf(out, "spills=%u\n", (unsigned)__atomic_load_n(&pool->spills, __ATOMIC_RELAXED));
+    fprintf(out, "evictions=%u\n", (unsigned)__atomic_load_n(&pool->evictions, __ATOMIC_RELAXED));
+    fprintf(out, "contentions=%u\n", (unsigned)__atomic_load_n(&pool->contentions, __ATOMIC_RELAXED));
+    fprintf(out, "adaptive_limit=%u\n", (unsigned)__atomic_load_n(&pool->adaptiveLimit, __ATOMIC_RELAXED));
+#if MEM_POOL_POISON
+    fprintf(out, "poison_sample=%llu\n", (unsigned long long)pool->poisonMask + 1);
+#endif
+#if MEM_POOL_TRACE
+    fprintf(out, "trace=%s\n", pool->traceEnabled ? "on" : "off");
+#endif
+}
+
+// Commands that take the pool lock: on a spin pool the application's waiters would spin
+// behind this idle-priority thread, so they need a mutex pool
+static int mayLock(FILE* out, const MemoryPool_t* pool, const char* verb) {
+    if (pool->lockType != MEM_POOL_LOCK_SPIN) return 1;
+    fprintf(out, "error %s needs a mutex pool, spin-lock waiters would spin behind this thread\n", verb);
+    return 0;
+}
+
+static int printMap(FILE* out, MemoryPool_t* pool) {
+    size_t numBlocks = pool->poolSize / pool->blockSize;
+    char* map = (char*)malloc(numBlocks);
+    if (!map || memPoolBlockStates(pool, map) != 0) {
+        free(map);
+        fprintf(out, "error out of memory\n");
+        return 0;
+    }
+
+    for (size_t i = 0; i < numBlocks; i += CTL_MAP_COLUMNS) {
+        size_t columns = numBlocks - i < CTL_MAP_COLUMNS ? numBlocks - i : CTL_MAP_COLUMNS;
+        fprintf(out, "%08x %.*s\n", (unsigned)(i * pool->blockSize), (int)columns, map + i);
+    }
+    free(map);
+    return 1;
+}
+
+#if MEM_POOL_TRACE
+// Plain file name inside the trace directory
+static int isTraceName(const char* name) {
+    return name[0] && name[0] != '.' && !strchr(name, '/') && !strstr(name, "..");
+}
+#endif
+
+static int executeTrace(const char* args, FILE* out) {
+#if MEM_POOL_TRACE
+    char word[CTL_LINE_SIZE];
+    int id;
+    if (sscanf(args, "open %255s", word) == 1) {
+        char path[CTL_PATH_SIZE + CTL_LINE_SIZE];
+        if (!server.traceDir[0]) {
+            fprintf(out, "error no trace directory, see memPoolCtlStart\n");
+            return 0;
+        }
+        if (!isTraceName(word)) {
+            fprintf(out, "error trace name must be a plain file name\n");
+            return 0;
+        }
+        snprintf(path, sizeof(path), "%s/%s", server.traceDir, word);
+        if (memPoolTraceOpen(path) != 0) {
+            fprintf(out, "error cannot open %s\n", word);
+            return 0;
+        }
+        return 1;
+    }
+    if (!strncmp(args, "close", 5)) {
+        memPoolTraceClose();
+        return 1;
+    }
+    if (sscanf(args, "%d %255s", &id, word) == 2 && poolById(id)) {
+        poolById(id)->traceEnabled = !strcmp(word, "on");
+        return 1;
+    }
+    fprintf(out, "error usage: trace open <name> | trace close | trace <id> on|off\n");
+#else
+    (void)args;
+    fprintf(out, "error tracing not compiled in (MEM_POOL_TRACE)\n");
+#endif
+    return 0;
+}
+
+// One client at a time; an idle one is dropped after CTL_IDLE_MS so it cannot lock out
+// the others
+static void serveClient(int fd) {
+    char line[CTL_LINE_SIZE];
+    size_t length = 0;
+    int idleMs = 0;
+
+    while (!__atomic_load_n(&server.stop, __ATOMIC_RELAXED)) {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, CTL_POLL_MS) <= 0) {
+            idleMs += CTL_POLL_MS;
+            if (idleMs >= CTL_IDLE_MS) return;
+            continue;
+        }
+        idleMs = 0;
+        ssize_t received = read(fd, line + length, sizeof(line) - 1 - length);
+        if (received <= 0) return;
+        length += (size_t)received;
+        line[length] = '\0';
+
+        char* newline;
+        while ((newline = strchr(line, '\n')) != NULL) {
+            *newline = '\0';
+            char* reply = NULL;
+            size_t replySize = 0;
+            FILE* out = open_memstream(&reply, &replySize);
+            if (!out) return;
+            memPoolCtlExecute(line, out);
+            fclose(out);
+            ssize_t written = write(fd, reply, replySize);
+            free(reply);
+            if (written < 0) return;
+
+            length -= (size_t)(newline + 1 - line);
+            memmove(line, newline + 1, length + 1);
+        }
+        if (length == sizeof(line) - 1) length = 0; // Overlong line, drop it
+    }
+}
+
+static void* ctlThread(void* arg) {
+    (void)arg;
+    // Never compete with the application for CPU
+    struct sched_param param;
+    param.sched_priority = 0;
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+
+    while (!__atomic_load_n(&server.stop, __ATOMIC_RELAXED)) {
+        struct pollfd pfd = { server.listenFd, POLLIN, 0 };
+        if (poll(&pfd, 1, CTL_POLL_MS) <= 0) continue;
+        int fd = accept(server.listenFd, NULL, NULL);
+        if (fd < 0) continue;
+        serveClient(fd);
+        close(fd);
+    }
+    return NULL;
+}
+
+// *****Library functions*****
+
+int memPoolCtlRegister(MemoryPool_t* pool, const char* name) {
+    if (!pool || pool->lockType == MEM_POOL_LOCK_NONE) return -1;
+
+    pthread_mutex_lock(&server.mutex);
+    int id = -1;
+    for (int i = 0; i < MEM_POOL_CTL_MAX_POOLS; ++i) {
+        if (!server.entries[i].pool) {
+            server.entries[i].pool = pool;
+            snprintf(server.entries[i].name, MEM_POOL_CTL_NAME_SIZE, "%s", name ? name : "pool");
+            id = i;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&server.mutex);
+    return id;
+}
+
+void memPoolCtlUnregister(MemoryPool_t* pool) {
+    pthread_mutex_lock(&server.mutex);
+    for (int i = 0; i < MEM_POOL_CTL_MAX_POOLS; ++i) {
+        if (server.entries[i].pool == pool) server.entries[i].pool = NULL;
+    }
+    pthread_mutex_unlock(&server.mutex);
+}
+
+void memPoolCtlExecute(const char* command, FILE* out) {
+    char verb[16] = "";
+    int id = -1;
+    unsigned long value = 0;
+    int consumed = 0;
+    int ok = 0;
+
+    if (sscanf(command, "%15s %n", verb, &consumed) < 1) {
+        fprintf(out, "error empty command\n");
+        return;
+    }
+    const char* args = command + consumed;
+    int numArgs = sscanf(args, "%d %lu", &id, &value);
+
+    pthread_mutex_lock(&server.mutex);
+    MemoryPool_t* pool = numArgs >= 1 ? poolById(id) : NULL;
+
+    if (!strcmp(verb, "list")) {
+        fprintf(out, "# id name block_size blocks free in_use released corruptions lock cache_limit high_water\n");
+        for (int i = 0; i < MEM_POOL_CTL_MAX_POOLS; ++i) {
+            if (server.entries[i].pool) printStats(out, i, 0);
+        }
+        ok = 1;
+    } else if (!strcmp(verb, "trace")) {
+        ok = executeTrace(args, out);
+    } else if (!pool) {
+        fprintf(out, "error unknown command or pool id\n");
+    } else if (!strcmp(verb, "stats")) {
+        printStats(out, id, 1);
+        ok = 1;
+    } else if (!strcmp(verb, "cache") && numArgs == 2) {
+        memPoolSetCacheLimit(pool, value);
+        ok = 1;
+    } else if ((!strcmp(verb, "trim") || !strcmp(verb, "restore") || !strcmp(verb, "map") ||
+                (!strcmp(verb, "sample") && numArgs == 2)) && !mayLock(out, pool, verb)) {
+        // Refused
+    } else if (!strcmp(verb, "trim")) {
+        fprintf(out, "released=%u\n", (unsigned)memPoolTrim(pool));
+        ok = 1;
+    } else if (!strcmp(verb, "restore")) {
+        fprintf(out, "restored=%u\n", (unsigned)memPoolRestore(pool));
+        ok = 1;
+    } else if (!strcmp(verb, "sample") && numArgs == 2) {
+#if MEM_POOL_POISON
+        memPoolSetPoisonSample(pool, value);
+        ok = 1;
+#else
+        fprintf(out, "error poisoning not compiled in (MEM_POOL_POISON)\n");
+#endif
+    } else if (!strcmp(verb, "map")) {
+        ok = printMap(out, pool);
+    } else {
+        fprintf(out, "error unknown command\n");
+    }
+    pthread_mutex_unlock(&server.mutex);
+
+    if (ok) fprintf(out, "ok\n");
+}
+
+int memPoolCtlStart(const char* socketPath, const char* traceDir) {
+    if (server.running || !socketPath || strlen(socketPath) >= sizeof(server.path)) return -1;
+    if (traceDir && strlen(traceDir) >= sizeof(server.traceDir)) return -1;
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socketPath);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    unlink(socketPath);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 4) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    strcpy(server.path, socketPath);
+    pthread_mutex_lock(&server.mutex);
+    strcpy(server.traceDir, traceDir ? traceDir : "");
+    pthread_mutex_unlock(&server.mutex);
+    server.listenFd = fd;
+    server.stop = 0;
+    if (pthread_create(&server.thread, NULL, ctlThread, NULL) != 0) {
+        close(fd);
+        unlink(socketPath);
+        return -1;
+    }
+    server.running = 1;
+    return 0;
+}
+
+void memPoolCtlStop(void) {
+    if (!server.running) return;
+    __atomic_store_n(&server.stop, 1, __ATOMIC_RELAXED);
+    pthread_join(server.thread, NULL);
+    close(server.listenFd);
+    unlink(server.path);
+    server.listenFd = -1;
+    server.running = 0;
+    pthread_mutex_lock(&server.mutex);
+    server.traceDir[0] = '\0';
+    pthread_mutex_unlock(&server.mutex);
+}
@@ -0,0 +1,59 @@
+// Cache-pool mode: CLOCK eviction of the coldest block on exhaustion
+
+#include "mem_pool_evict.h"
+
+#include <stdlib.h>
+
+// *****Library functions*****
+
+int memPoolSetEviction(MemoryPool_t* pool, MemoryPoolEvict_t evict, void* context) {
+    if (!pool || !evict) return -1;
+    if (!pool->evictMeta) {
+        pool->evictMeta = (unsigned char*)calloc(pool->poolSize / pool->blockSize, 1);
+        if (!pool->evictMeta) return -1;
+    }
+    pool->evict = evict;
+    pool->evictContext = context;
+    memPoolUpdateFreeHooks(pool);
+    return 0;
+}
+
+// Two full turns find a victim unless every entry is pinned or touched again meanwhile.
+// The hand and the claim are atomic, concurrent allocations sweep without a lock.
+void* memPoolEvict(MemoryPool_t* pool) {
+    size_t numBlocks = pool->poolSize / pool->blockSize;
+
+    for (size_t step = 0; step < 2 * numBlocks; ++step) {
+        size_t index = __atomic_fetch_add(&pool->evictHand, 1, __ATOMIC_RELAXED) % numBlocks;
+        unsigned char* meta = &pool->evictMeta[index];
+        unsigned char state = __atomic_load_n(meta, __ATOMIC_RELAXED);
+        if (!(state & MEM_POOL_EVICT_LIVE)) continue;
+        if (state & MEM_POOL_EVICT_REFERENCED) {
+            __atomic_fetch_and(meta, (unsigned char)~MEM_POOL_EVICT_REFERENCED, __ATOMIC_RELAXED);
+            continue;
+        }
+        // Claim it; fails if the entry was touched or claimed since the load
+        if (!__atomic_compare_exchange_n(meta, &state, 0, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) continue;
+
+        void* block = (char*)pool->memoryStart + index * pool->blockSize;
+        if (pool->evict(pool->evictContext, block)) {
+            __atomic_fetch_add(&pool->evictions, 1, __ATOMIC_RELAXED);
+#ifdef DEBUGPRINT
+            printf("\nEvicted Block:\n");
+            printf("Address = %p\n", block);
+#endif
+            return block;
+        }
+        // Pinned: give it a fresh second chance
+        unsigned char none = 0;
+        __atomic_compare_exchange_n(meta, &none, MEM_POOL_EVICT_LIVE | MEM_POOL_EVICT_REFERENCED, false,
+                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+void memPoolForget(MemoryPool_t* pool, void* block) {
+    if (!memPoolOwnsBlock(pool, block)) return;
+    size_t index = (size_t)((char*)block - (char*)pool->memoryStart) / pool->blockSize;
+    __atomic_store_n(&pool->evictMeta[index], 0, __ATOMIC_RELAXED);
+}
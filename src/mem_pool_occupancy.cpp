@@ -0,0 +1,238 @@
+// Per-page occupancy snapshots and the timeline sampler
+
+#include "mem_pool_occupancy.h"
+#if MEM_POOL_TRIM
+    #include "mem_pool_trim.h"
+#endif
+
+#include <stdlib.h>
+#include <time.h>
+#ifndef USE_FREERTOS
+    #include <unistd.h>
+#endif
+
+// *****Local defines*****
+
+#define OCCUPANCY_DEFAULT_PAGE   4096
+#define OCCUPANCY_DEFAULT_BUDGET 1
+
+// *****Local types*****
+
+#ifndef USE_FREERTOS
+struct MemoryPoolSampler_s {
+    MemoryPool_t* pool;
+    FILE* file;
+    size_t pageSize;
+    size_t numPages;
+    uint64_t intervalNs;
+    unsigned budgetPercent;
+    size_t samples;
+    int stop;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    uint8_t* levels;
+    char* line;
+};
+#endif
+
+// *****Local functions*****
+
+static size_t blockIndex(const MemoryPool_t* pool, const void* block) {
+    return ((uintptr_t)block - (uintptr_t)pool->memoryStart) / pool->blockSize;
+}
+
+static uintptr_t firstPage(const MemoryPool_t* pool, size_t pageSize) {
+    return (uintptr_t)pool->memoryStart / pageSize;
+}
+
+// *****Library functions*****
+
+int memPoolBlockStates(MemoryPool_t* pool, char* states) {
+    if (!pool || !states) return -1;
+    size_t numBlocks = pool->poolSize / pool->blockSize;
+    memset(states, MEM_POOL_BLOCK_LIVE, numBlocks);
+
+    memPoolLock(pool);
+    for (MemoryBlock_t* block = pool->freeList; block; block = memPoolLoadLink(pool, block)) {
+        if (!memPoolIsValidLink(pool, block)) break;
+        states[blockIndex(pool, block)] = MEM_POOL_BLOCK_FREE;
+    }
+#if MEM_POOL_TRIM
+    for (size_t i = 0; pool->releasedBlocks && i < numBlocks; ++i) {
+        if (memPoolBlockReleased(pool, i)) states[i] = MEM_POOL_BLOCK_RELEASED;
+    }
+    if (pool->large) {
+        MemoryPoolLarge_t* large = pool->large;
+        for (size_t i = 0; i < large->hotCount; ++i) {
+            states[blockIndex(pool, large->hot[(large->hotStart + i) % large->hotLimit])] = MEM_POOL_BLOCK_FREE;
+        }
+        for (MemoryBlock_t* block = large->cold; block; block = memPoolLoadLink(pool, block)) {
+            if (!memPoolIsValidLink(pool, block)) break;
+            states[blockIndex(pool, block)] = MEM_POOL_BLOCK_RELEASED;
+        }
+    }
+#endif
+    memPoolUnlock(pool);
+    return 0;
+}
+
+size_t memPoolOccupancyPages(const MemoryPool_t* pool, size_t pageSize) {
+    if (!pool || !pageSize) return 0;
+    return ((uintptr_t)pool->memoryEnd - 1) / pageSize - firstPage(pool, pageSize) + 1;
+}
+
+int memPoolOccupancySnapshot(MemoryPool_t* pool, size_t pageSize, uint8_t* levels) {
+    size_t numPages = memPoolOccupancyPages(pool, pageSize);
+    if (!numPages || !levels) return -1;
+    size_t numBlocks = pool->poolSize / pool->blockSize;
+    char* states = (char*)malloc(numBlocks);
+    size_t* liveBytes = (size_t*)calloc(numPages, sizeof(size_t));
+    if (!states || !liveBytes || memPoolBlockStates(pool, states) != 0) {
+        free(states);
+        free(liveBytes);
+        return -1;
+    }
+
+    // Spread each live block over the pieces it covers
+    uintptr_t start = (uintptr_t)pool->memoryStart;
+    uintptr_t base = firstPage(pool, pageSize) * pageSize;
+    for (size_t i = 0; i < numBlocks; ++i) {
+        if (states[i] != MEM_POOL_BLOCK_LIVE) continue;
+        uintptr_t from = start + i * pool->blockSize;
+        uintptr_t to = from + pool->blockSize;
+        while (from < to) {
+            size_t page = (from - base) / pageSize;
+            uintptr_t pageEnd = base + (page + 1) * pageSize;
+            uintptr_t end = to < pageEnd ? to : pageEnd;
+            liveBytes[page] += end - from;
+            from = end;
+        }
+    }
+
+    // Share of the arena bytes in the piece; the first and last pieces may be partial
+    uintptr_t end = (uintptr_t)pool->memoryEnd;
+    for (size_t page = 0; page < numPages; ++page) {
+        uintptr_t pageStart = base + page * pageSize;
+        uintptr_t from = pageStart > start ? pageStart : start;
+        uintptr_t to = pageStart + pageSize < end ? pageStart + pageSize : end;
+        size_t bytes = to - from;
+        if (!liveBytes[page]) levels[page] = 0;
+        else if (liveBytes[page] >= bytes) levels[page] = 255;
+        else levels[page] = (uint8_t)(1 + liveBytes[page] * 253 / bytes);
+    }
+
+    free(states);
+    free(liveBytes);
+    return 0;
+}
+
+#ifndef USE_FREERTOS
+
+static uint64_t monotonicNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// 0 only for empty and f only for full pieces, like the snapshot levels
+static char hexLevel(uint8_t level) {
+    static const char digits[] = "0123456789abcdef";
+    if (level == 0) return '0';
+    if (level == 255) return 'f';
+    return digits[1 + (level - 1) * 14 / 254];
+}
+
+static void freeSampler(MemoryPoolSampler_t* sampler) {
+    if (sampler->file) fclose(sampler->file);
+    free(sampler->levels);
+    free(sampler->line);
+    free(sampler);
+}
+
+static void* samplerThread(void* arg) {
+    MemoryPoolSampler_t* sampler = (MemoryPoolSampler_t*)arg;
+    uint64_t origin = monotonicNs();
+
+    pthread_mutex_lock(&sampler->mutex);
+    while (!sampler->stop) {
+        pthread_mutex_unlock(&sampler->mutex);
+
+        uint64_t start = monotonicNs();
+        if (memPoolOccupancySnapshot(sampler->pool, sampler->pageSize, sampler->levels) == 0) {
+            for (size_t i = 0; i < sampler->numPages; ++i) sampler->line[i] = hexLevel(sampler->levels[i]);
+            fprintf(sampler->file, "%llu %.*s\n", (unsigned long long)((start - origin) / 1000000),
+                    (int)sampler->numPages, sampler->line);
+            fflush(sampler->file);
+            ++sampler->samples;
+        }
+        uint64_t cost = monotonicNs() - start;
+
+        // Keep cost / (cost + wait) within the budget
+        uint64_t wait = cost * 100 / sampler->budgetPercent;
+        wait = wait > cost ? wait - cost : 0;
+        if (wait < sampler->intervalNs) wait = sampler->intervalNs;
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        uint64_t ns = (uint64_t)deadline.tv_nsec + wait;
+        deadline.tv_sec += (time_t)(ns / 1000000000ULL);
+        deadline.tv_nsec = (long)(ns % 1000000000ULL);
+
+        pthread_mutex_lock(&sampler->mutex);
+        while (!sampler->stop && pthread_cond_timedwait(&sampler->wake, &sampler->mutex, &deadline) == 0) {}
+    }
+    pthread_mutex_unlock(&sampler->mutex);
+    return NULL;
+}
+
+MemoryPoolSampler_t* memPoolOccupancyStart(MemoryPool_t* pool, const char* name, const char* path,
+                                           size_t pageSize, unsigned intervalMs, unsigned budgetPercent) {
+    if (!pool || !name || !path || !intervalMs) return NULL;
+    if (!pageSize) {
+        long osPage = sysconf(_SC_PAGESIZE);
+        pageSize = osPage > 0 ? (size_t)osPage : OCCUPANCY_DEFAULT_PAGE;
+    }
+    MemoryPoolSampler_t* sampler = (MemoryPoolSampler_t*)calloc(1, sizeof(MemoryPoolSampler_t));
+    if (!sampler) return NULL;
+    sampler->pool = pool;
+    sampler->pageSize = pageSize;
+    sampler->numPages = memPoolOccupancyPages(pool, pageSize);
+    sampler->intervalNs = (uint64_t)intervalMs * 1000000ULL;
+    sampler->budgetPercent = budgetPercent ? (budgetPercent < 100 ? budgetPercent : 100) : OCCUPANCY_DEFAULT_BUDGET;
+    sampler->levels = (uint8_t*)malloc(sampler->numPages);
+    sampler->line = (char*)malloc(sampler->numPages);
+    sampler->file = fopen(path, "w");
+    if (!sampler->levels || !sampler->line || !sampler->file) {
+        freeSampler(sampler);
+        return NULL;
+    }
+
+    fprintf(sampler->file, "# mem_pool occupancy v1\npool %.*s %lu %lu %lu\n", MEM_POOL_OCCUPANCY_NAME_SIZE - 1,
+            name, (unsigned long)pool->blockSize, (unsigned long)pageSize, (unsigned long)sampler->numPages);
+    pthread_mutex_init(&sampler->mutex, NULL);
+    pthread_cond_init(&sampler->wake, NULL);
+    if (pthread_create(&sampler->thread, NULL, samplerThread, sampler) != 0) {
+        pthread_cond_destroy(&sampler->wake);
+        pthread_mutex_destroy(&sampler->mutex);
+        freeSampler(sampler);
+        return NULL;
+    }
+    return sampler;
+}
+
+size_t memPoolOccupancyStop(MemoryPoolSampler_t* sampler) {
+    if (!sampler) return 0;
+    pthread_mutex_lock(&sampler->mutex);
+    sampler->stop = 1;
+    pthread_cond_signal(&sampler->wake);
+    pthread_mutex_unlock(&sampler->mutex);
+    pthread_join(sampler->thread, NULL);
+
+    size_t samples = sampler->samples;
+    pthread_cond_destroy(&sampler->wake);
+    pthread_mutex_destroy(&sampler->mutex);
+    freeSampler(sampler);
+    return samples;
+}
+
+#endif // USE_FREERTOS
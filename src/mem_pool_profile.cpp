@@ -0,0 +1,131 @@
+// Warm-start pool sizing from a persisted high-water profile
+
+#include "mem_pool_profile.h"
+#if MEM_POOL_TRIM
+    #include "mem_pool_trim.h"
+#endif
+
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// *****Local defines*****
+
+#define PROFILE_LINE_SIZE 256
+#define PROFILE_PATH_SIZE 4096
+
+// *****Local functions*****
+
+static size_t percentOf(size_t value, unsigned percent) {
+    return (value * percent + 99) / 100;
+}
+
+// "name block_size high_water"; comments and malformed lines are skipped
+static int parseEntry(const char* line, char* name, size_t* blockSize, size_t* highWater) {
+    unsigned long size, mark;
+    if (line[0] == '#') return 0;
+    if (sscanf(line, "%31s %lu %lu", name, &size, &mark) != 3) return 0;
+    *blockSize = size;
+    *highWater = mark;
+    return 1;
+}
+
+// *****Library functions*****
+
+size_t memPoolProfileLoad(const char* path, const char* name, size_t blockSize) {
+    FILE* file = fopen(path, "r");
+    if (!file) return 0;
+
+    char line[PROFILE_LINE_SIZE];
+    char entryName[MEM_POOL_PROFILE_NAME_SIZE];
+    size_t entrySize, entryMark;
+    size_t highWater = 0;
+    while (fgets(line, sizeof(line), file)) {
+        if (parseEntry(line, entryName, &entrySize, &entryMark) && entrySize == blockSize &&
+            !strncmp(entryName, name, MEM_POOL_PROFILE_NAME_SIZE - 1)) {
+            highWater = entryMark;
+        }
+    }
+    fclose(file);
+    return highWater;
+}
+
+int memPoolProfileSave(const char* path, const char* name, MemoryPool_t* pool) {
+    if (!path || !name || !pool) return -1;
+
+    // Unique temporary next to the profile, so concurrent savers never share one
+    char tmpPath[PROFILE_PATH_SIZE];
+    if (snprintf(tmpPath, sizeof(tmpPath), "%s.XXXXXX", path) >= (int)sizeof(tmpPath)) return -1;
+    int fd = mkstemp(tmpPath);
+    if (fd < 0) return -1;
+    fchmod(fd, 0644);
+    FILE* out = fdopen(fd, "w");
+    if (!out) {
+        close(fd);
+        remove(tmpPath);
+        return -1;
+    }
+
+    memPoolLock(pool);
+    size_t highWater = pool->highWater;
+    memPoolUnlock(pool);
+
+    // Copy every other entry, replace ours; the same name with another block size is another pool
+    fprintf(out, "# mem_pool profile v1: name block_size high_water\n");
+    FILE* in = fopen(path, "r");
+    char line[PROFILE_LINE_SIZE];
+    char entryName[MEM_POOL_PROFILE_NAME_SIZE];
+    size_t entrySize, entryMark;
+    while (in && fgets(line, sizeof(line), in)) {
+        if (!parseEntry(line, entryName, &entrySize, &entryMark)) continue;
+        if (entrySize == pool->blockSize && !strncmp(entryName, name, MEM_POOL_PROFILE_NAME_SIZE - 1)) {
+            if (entryMark - entryMark / 4 > highWater) highWater = entryMark - entryMark / 4;
+            continue;
+        }
+        fputs(line, out);
+    }
+    if (in) fclose(in);
+    fprintf(out, "%.31s %lu %lu\n", name, (unsigned long)pool->blockSize, (unsigned long)highWater);
+
+    if (fclose(out) != 0 || rename(tmpPath, path) != 0) {
+        remove(tmpPath);
+        return -1;
+    }
+    return 0;
+}
+
+MemoryPool_t* memPoolCreateProfiled(const char* path, const char* name, size_t blockSize,
+                                    MemoryPoolLock_t lockType, const MemoryPoolSizing_t* sizing) {
+    if (!sizing || !sizing->maxBlocks) return NULL;
+
+    size_t minBlocks = sizing->minBlocks > 2 ? sizing->minBlocks : 2; // createMemoryPool needs two
+    size_t maxBlocks = sizing->maxBlocks > minBlocks ? sizing->maxBlocks : minBlocks;
+    unsigned reservePercent = sizing->reservePercent ? sizing->reservePercent : 25;
+    unsigned prefaultPercent = sizing->prefaultPercent ? sizing->prefaultPercent : 100;
+    unsigned cachePercent = sizing->cachePercent ? sizing->cachePercent : 10;
+
+    size_t highWater = path && name ? memPoolProfileLoad(path, name, blockSize) : 0;
+    size_t numBlocks = highWater ? highWater + percentOf(highWater, reservePercent)
+                                 : (sizing->defaultBlocks ? sizing->defaultBlocks : maxBlocks);
+    if (numBlocks < minBlocks) numBlocks = minBlocks;
+    if (numBlocks > maxBlocks) numBlocks = maxBlocks;
+
+    MemoryPool_t* pool = createMemoryPoolEx(blockSize, numBlocks * blockSize, lockType);
+    if (!pool || !highWater) return pool;
+
+    size_t cacheLimit = percentOf(highWater, cachePercent);
+    memPoolSetCacheLimit(pool, cacheLimit ? cacheLimit : 1);
+#if MEM_POOL_TRIM
+    // The reserve stays allocated but not resident until the pool actually grows into it
+    memPoolTrimKeep(pool, percentOf(highWater, prefaultPercent));
+#else
+    (void)prefaultPercent;
+#endif
+
+#ifdef DEBUGPRINT
+    printf("\nPool %s sized from profile: high water %u, %u blocks\n", name, (unsigned)highWater,
+           (unsigned)numBlocks);
+#endif
+
+    return pool;
+}
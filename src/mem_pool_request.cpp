@@ -0,0 +1,78 @@
+// Request-scoped allocation: log chunks and batched release
+
+#include "mem_pool_request.h"
+
+// Enable standalone build without FreeRTOS
+#ifndef USE_FREERTOS
+    #include <stdlib.h>
+    #define pvPortMalloc malloc
+    #define pvPortFree   free
+#else
+    #define pvPortFree   vPortFree
+#endif
+
+// *****Library functions*****
+
+int memPoolRequestInit(MemoryPoolRequest_t* request, MemoryPool_t* const* pools, size_t numPools) {
+    if (!request || !pools || numPools == 0 || numPools > MEM_POOL_REQUEST_MAX_POOLS) return -1;
+    for (size_t i = 0; i < numPools; ++i) {
+        if (!pools[i] || (i && pools[i]->blockSize < pools[i - 1]->blockSize)) return -1;
+    }
+
+    request->numPools = numPools;
+    for (size_t i = 0; i < numPools; ++i) {
+        request->classes[i].pool = pools[i];
+        request->classes[i].chunk = NULL;
+    }
+    request->spare = NULL;
+    return 0;
+}
+
+void memPoolRequestDestroy(MemoryPoolRequest_t* request) {
+    memPoolRequestRelease(request);
+    while (request->spare) {
+        MemoryPoolRequestChunk_t* chunk = request->spare;
+        request->spare = chunk->next;
+        pvPortFree(chunk);
+    }
+}
+
+size_t memPoolRequestRelease(MemoryPoolRequest_t* request) {
+    size_t released = 0;
+    for (size_t i = 0; i < request->numPools; ++i) {
+        MemoryPoolRequestClass_t* sizeClass = &request->classes[i];
+        while (sizeClass->chunk) {
+            MemoryPoolRequestChunk_t* chunk = sizeClass->chunk;
+            freeBlocks(sizeClass->pool, chunk->blocks, chunk->count);
+            released += chunk->count;
+            sizeClass->chunk = chunk->next;
+            chunk->next = request->spare;
+            request->spare = chunk;
+        }
+    }
+
+#ifdef DEBUGPRINT
+    printf("\nRequest released %u blocks\n", (unsigned)released);
+#endif
+
+    return released;
+}
+
+void* memPoolRequestGrow(MemoryPoolRequest_t* request, MemoryPoolRequestClass_t* sizeClass, void* block) {
+    MemoryPoolRequestChunk_t* chunk = request->spare;
+    if (chunk) {
+        request->spare = chunk->next;
+    } else {
+        chunk = (MemoryPoolRequestChunk_t*)pvPortMalloc(sizeof(MemoryPoolRequestChunk_t));
+        if (!chunk) {
+            // An unlogged block would leak at release
+            freeBlock(sizeClass->pool, block);
+            return NULL;
+        }
+    }
+    chunk->next = sizeClass->chunk;
+    chunk->count = 1;
+    chunk->blocks[0] = block;
+    sizeClass->chunk = chunk;
+    return block;
+}
@@ -0,0 +1,125 @@
+// Lock-free bounded MPMC ring of free blocks
+
+#include "mem_pool_ring.h"
+
+#include <stdlib.h>
+#ifndef USE_FREERTOS
+    #include <sched.h>
+#endif
+
+// *****Local defines*****
+
+#define RING_SPINS_BEFORE_YIELD 64
+
+// *****Local functions*****
+
+// Claim up to count positions of one side. The other side's tail bounds the range:
+// producers may run capacity ahead of the consumers, consumers up to the producers.
+static uint32_t reserve(MemoryPoolRingIndex_t* self, const MemoryPoolRingIndex_t* other, uint32_t limit,
+                        uint32_t count, uint32_t* start) {
+    uint32_t head = __atomic_load_n(&self->head, __ATOMIC_RELAXED);
+    uint32_t n;
+    do {
+        uint32_t available = limit + __atomic_load_n(&other->tail, __ATOMIC_ACQUIRE) - head;
+        n = count < available ? count : available;
+        if (n == 0) return 0;
+    } while (!__atomic_compare_exchange_n(&self->head, &head, head + n, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    *start = head;
+    return n;
+}
+
+// Publish in reservation order: wait for the earlier reservations of this side to finish.
+// Acquire, so the release below also covers their slot copies. An earlier reservation
+// whose owner was preempted can only finish once it runs again, so yield after a while.
+static void publish(MemoryPoolRingIndex_t* self, uint32_t start, uint32_t n) {
+    for (unsigned spins = 0; __atomic_load_n(&self->tail, __ATOMIC_ACQUIRE) != start; ++spins) {
+        if (spins < RING_SPINS_BEFORE_YIELD) {
+            memPoolCpuRelax();
+        } else {
+#ifdef USE_FREERTOS
+            taskYIELD();
+#else
+            sched_yield();
+#endif
+        }
+    }
+    __atomic_store_n(&self->tail, start + n, __ATOMIC_RELEASE);
+}
+
+// *****Library functions*****
+
+MemoryPoolRing_t* memPoolRingCreate(MemoryPool_t* pool) {
+    if (!pool) return NULL;
+    size_t numBlocks = pool->poolSize / pool->blockSize;
+    if (numBlocks >= 0x80000000u) return NULL;
+    uint32_t slots = 1;
+    while (slots < numBlocks) slots <<= 1;
+
+    MemoryPoolRing_t* ring = (MemoryPoolRing_t*)calloc(1, sizeof(MemoryPoolRing_t) + (slots - 1) * sizeof(void*));
+    if (!ring) return NULL;
+    ring->pool = pool;
+    ring->mask = slots - 1;
+
+    // Not concurrent yet: fill the slots directly
+    uint32_t count = (uint32_t)allocateBlocks(pool, ring->slots, numBlocks);
+    if (count == 0) {
+        free(ring);
+        return NULL;
+    }
+    for (uint32_t i = 0; i < count; ++i) ASAN_POISON_MEMORY_REGION(ring->slots[i], pool->blockSize);
+    ring->capacity = (uint32_t)numBlocks; // Blocks in use now come back through the ring too
+    ring->prod.head = ring->prod.tail = count;
+
+#ifdef DEBUGPRINT
+    printf("\nRing of %u slots holding %u blocks\n", (unsigned)slots, (unsigned)count);
+#endif
+
+    return ring;
+}
+
+void memPoolRingDestroy(MemoryPoolRing_t* ring) {
+    if (!ring) return;
+    void* blocks[64];
+    size_t count;
+    while ((count = memPoolRingDequeue(ring, blocks, 64)) != 0) freeBlocks(ring->pool, blocks, count);
+    free(ring);
+}
+
+size_t memPoolRingDequeue(MemoryPoolRing_t* ring, void** blocks, size_t count) {
+    uint32_t start;
+    uint32_t n = reserve(&ring->cons, &ring->prod, 0, count < ring->capacity ? (uint32_t)count : ring->capacity,
+                         &start);
+    if (n == 0) return 0;
+
+    // At most two copies: up to the end of the slots and from the start
+    uint32_t first = start & ring->mask;
+    uint32_t part = ring->mask + 1 - first < n ? ring->mask + 1 - first : n;
+    memcpy(blocks, &ring->slots[first], part * sizeof(void*));
+    memcpy(blocks + part, &ring->slots[0], (n - part) * sizeof(void*));
+    publish(&ring->cons, start, n);
+
+    for (uint32_t i = 0; i < n; ++i) ASAN_UNPOISON_MEMORY_REGION(blocks[i], ring->pool->blockSize);
+    return n;
+}
+
+size_t memPoolRingEnqueue(MemoryPoolRing_t* ring, void* const* blocks, size_t count) {
+    uint32_t start;
+    uint32_t n = reserve(&ring->prod, &ring->cons, ring->capacity,
+                         count < ring->capacity ? (uint32_t)count : ring->capacity, &start);
+    if (n == 0) return 0;
+
+    for (uint32_t i = 0; i < n; ++i) ASAN_POISON_MEMORY_REGION(blocks[i], ring->pool->blockSize);
+    uint32_t first = start & ring->mask;
+    uint32_t part = ring->mask + 1 - first < n ? ring->mask + 1 - first : n;
+    memcpy(&ring->slots[first], blocks, part * sizeof(void*));
+    memcpy(&ring->slots[0], blocks + part, (n - part) * sizeof(void*));
+    publish(&ring->prod, start, n);
+    return n;
+}
+
+size_t memPoolRingCount(const MemoryPoolRing_t* ring) {
+    // Consumer head first: it never passes the producer tail, so the difference cannot wrap
+    uint32_t head = __atomic_load_n(&ring->cons.head, __ATOMIC_ACQUIRE);
+    uint32_t count = __atomic_load_n(&ring->prod.tail, __ATOMIC_ACQUIRE) - head;
+    return count < ring->capacity ? count : ring->capacity;
+}
@@ -0,0 +1,97 @@
+// Copy-on-write pool templates (Linux)
+
+#include "mem_pool_template.h"
+
+#include <stdlib.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// *****Local types*****
+
+struct MemoryPoolTemplate_s {
+    int fd;                 // memfd holding the image
+    size_t size;            // Image size, whole pages
+    MemoryPoolTiny_t* view; // Shared writable view while building, NULL once sealed
+};
+
+// *****Local functions*****
+
+static size_t imageSize(size_t footprint) {
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    return (footprint + pageSize - 1) / pageSize * pageSize;
+}
+
+static void unmapImage(void* image, size_t size) {
+    // Shadow of the range may be reused by the next mapping at this address
+    ASAN_UNPOISON_MEMORY_REGION(image, size);
+    munmap(image, size);
+}
+
+// *****Library functions*****
+
+MemoryPoolTemplate_t* memPoolTemplateCreate(const char* name, size_t blockSize, size_t numBlocks) {
+    size_t footprint = tinyPoolFootprint(blockSize, numBlocks);
+    if (!footprint) return NULL;
+
+    MemoryPoolTemplate_t* tmpl = (MemoryPoolTemplate_t*)calloc(1, sizeof(MemoryPoolTemplate_t));
+    if (!tmpl) return NULL;
+    tmpl->size = imageSize(footprint);
+    tmpl->fd = memfd_create(name ? name : "mem_pool_template", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (tmpl->fd < 0) {
+        free(tmpl);
+        return NULL;
+    }
+
+    void* view = MAP_FAILED;
+    if (ftruncate(tmpl->fd, (off_t)tmpl->size) == 0) {
+        view = mmap(NULL, tmpl->size, PROT_READ | PROT_WRITE, MAP_SHARED, tmpl->fd, 0);
+    }
+    if (view == MAP_FAILED) {
+        close(tmpl->fd);
+        free(tmpl);
+        return NULL;
+    }
+    // Footprint, not the whole pages: numBlocks exactly
+    tmpl->view = initTinyPool(view, footprint, blockSize);
+
+#ifdef DEBUGPRINT
+    printf("\nPool template %s: %u blocks of %u bytes, %u byte image\n", name ? name : "", (unsigned)numBlocks,
+           (unsigned)blockSize, (unsigned)tmpl->size);
+#endif
+
+    return tmpl;
+}
+
+void memPoolTemplateDestroy(MemoryPoolTemplate_t* tmpl) {
+    if (!tmpl) return;
+    if (tmpl->view) unmapImage(tmpl->view, tmpl->size);
+    close(tmpl->fd);
+    free(tmpl);
+}
+
+MemoryPoolTiny_t* memPoolTemplatePool(MemoryPoolTemplate_t* tmpl) {
+    return tmpl->view;
+}
+
+int memPoolTemplateSeal(MemoryPoolTemplate_t* tmpl) {
+    if (!tmpl->view) return -1;
+    // F_SEAL_WRITE needs the shared writable view gone
+    unmapImage(tmpl->view, tmpl->size);
+    tmpl->view = NULL;
+    return fcntl(tmpl->fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) == 0 ? 0 : -1;
+}
+
+MemoryPoolTiny_t* memPoolTemplateInstantiate(MemoryPoolTemplate_t* tmpl) {
+    if (tmpl->view) return NULL;
+    void* image = mmap(NULL, tmpl->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, tmpl->fd, 0);
+    if (image == MAP_FAILED) return NULL;
+    ASAN_UNPOISON_MEMORY_REGION(image, tmpl->size);
+    return (MemoryPoolTiny_t*)image;
+}
+
+void memPoolInstanceDestroy(MemoryPoolTiny_t* instance) {
+    if (!instance) return;
+    size_t footprint = sizeof(MemoryPoolTiny_t) + tinyPoolNumBlocks(instance) * tinyPoolBlockSize(instance);
+    unmapImage(instance, imageSize(footprint));
+}
@@ -0,0 +1,295 @@
+// Tiered storage: cold blocks demoted to a file-backed overflow arena (Linux)
+
+#include "mem_pool_tier.h"
+
+#include <stdlib.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// *****Local defines*****
+
+#define TIER_NONE 0xFFFFFFFFu
+#define TIER_PATH_SIZE 4096
+
+// *****Local types*****
+
+typedef struct TierEntry_s {
+    void* block;        // Address in RAM, NULL while demoted or unused
+    uint32_t slot;      // File slot while demoted, TIER_NONE otherwise
+    uint32_t nextFree;  // Free handle list
+    uint16_t pins;
+    uint8_t used;
+    uint8_t accessed;   // Pinned since the last sweep
+} TierEntry_t;
+
+struct MemoryPoolTier_s {
+    MemoryPool_t* pool;
+    pthread_mutex_t mutex;
+    char* file;             // Overflow arena
+    size_t fileSize;
+    uint32_t* slotNext;     // Free file slots, linked by index
+    uint32_t freeSlot;
+    uint32_t freeHandle;
+    size_t numEntries;
+    size_t resident;
+    size_t demoted;
+    size_t hand;            // Victim search position
+    TierEntry_t entries[1];
+};
+
+// *****Local functions*****
+
+static TierEntry_t* entryOf(MemoryPoolTier_t* tier, MemoryPoolHandle_t handle) {
+    if (handle == 0 || handle > tier->numEntries) return NULL;
+    TierEntry_t* entry = &tier->entries[handle - 1];
+    return entry->used ? entry : NULL;
+}
+
+static char* slotAddress(MemoryPoolTier_t* tier, uint32_t slot) {
+    return tier->file + (size_t)slot * tier->pool->blockSize;
+}
+
+// Back on the free list; whole pages of the slot also drop their file backing
+static void releaseSlot(MemoryPoolTier_t* tier, uint32_t slot) {
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    if (tier->pool->blockSize % pageSize == 0) {
+        madvise(slotAddress(tier, slot), tier->pool->blockSize, MADV_REMOVE);
+    }
+    tier->slotNext[slot] = tier->freeSlot;
+    tier->freeSlot = slot;
+}
+
+// Copy out, give the block back to the pool and the file page to the page cache
+static int demote(MemoryPoolTier_t* tier, TierEntry_t* entry) {
+    if (!entry->block || entry->pins || tier->freeSlot == TIER_NONE) return -1;
+    uint32_t slot = tier->freeSlot;
+    tier->freeSlot = tier->slotNext[slot];
+
+    memcpy(slotAddress(tier, slot), entry->block, tier->pool->blockSize);
+    freeBlock(tier->pool, entry->block);
+    entry->block = NULL;
+    entry->slot = slot;
+    entry->accessed = 0;
+    --tier->resident;
+    ++tier->demoted;
+    return 0;
+}
+
+// Next unpinned resident block, preferring those not accessed since the last sweep
+static TierEntry_t* findVictim(MemoryPoolTier_t* tier) {
+    for (int pass = 0; pass < 2; ++pass) {
+        for (size_t n = 0; n < tier->numEntries; ++n) {
+            TierEntry_t* entry = &tier->entries[tier->hand++ % tier->numEntries];
+            if (!entry->used || !entry->block || entry->pins) continue;
+            if (pass == 0 && entry->accessed) continue;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void* allocateResident(MemoryPoolTier_t* tier) {
+    void* block = allocateBlock(tier->pool);
+    if (block) return block;
+    TierEntry_t* victim = findVictim(tier);
+    if (victim && demote(tier, victim) == 0) block = allocateBlock(tier->pool);
+    return block;
+}
+
+static int promote(MemoryPoolTier_t* tier, TierEntry_t* entry) {
+    uint32_t slot = entry->slot;
+    char* file = slotAddress(tier, slot);
+    void* block = allocateResident(tier);
+    if (block) {
+        memcpy(block, file, tier->pool->blockSize);
+        releaseSlot(tier, slot);
+    } else {
+        // RAM and file both full: trade places with a victim through its block
+        TierEntry_t* victim = findVictim(tier);
+        if (!victim) return -1;
+        block = victim->block;
+        char buffer[256];
+        for (size_t offset = 0; offset < tier->pool->blockSize; offset += sizeof(buffer)) {
+            size_t size = tier->pool->blockSize - offset;
+            if (size > sizeof(buffer)) size = sizeof(buffer);
+            memcpy(buffer, file + offset, size);
+            memcpy(file + offset, (char*)block + offset, size);
+            memcpy((char*)block + offset, buffer, size);
+        }
+        victim->block = NULL;
+        victim->slot = slot;
+        victim->accessed = 0;
+        ++tier->demoted;
+        --tier->resident;
+    }
+    entry->block = block;
+    entry->slot = TIER_NONE;
+    --tier->demoted;
+    ++tier->resident;
+    return 0;
+}
+
+// Anonymous file in dir: O_TMPFILE where the file system supports it, otherwise a unique
+// name unlinked at once. An existing file is never opened.
+static int openTierFile(const char* dir) {
+    int fd = -1;
+#ifdef O_TMPFILE
+    fd = open(dir, O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+    if (fd >= 0) return fd;
+#endif
+    char path[TIER_PATH_SIZE];
+    if (snprintf(path, sizeof(path), "%s/mem_pool_tier_XXXXXX", dir) >= (int)sizeof(path)) return -1;
+    fd = mkostemp(path, O_CLOEXEC);
+    if (fd >= 0) unlink(path);
+    return fd;
+}
+
+// *****Library functions*****
+
+MemoryPoolTier_t* memPoolTierCreate(MemoryPool_t* pool, const char* dir, size_t fileBlocks) {
+    if (!pool || !dir || !fileBlocks || fileBlocks >= TIER_NONE) return NULL;
+    size_t numBlocks = pool->poolSize / pool->blockSize;
+    size_t numEntries = numBlocks + fileBlocks;
+    if (numEntries >= TIER_NONE) return NULL;
+
+    MemoryPoolTier_t* tier = (MemoryPoolTier_t*)calloc(1, sizeof(MemoryPoolTier_t) +
+                                                          (numEntries - 1) * sizeof(TierEntry_t));
+    uint32_t* slotNext = (uint32_t*)malloc(fileBlocks * sizeof(uint32_t));
+    int fd = openTierFile(dir);
+    size_t fileSize = fileBlocks * pool->blockSize;
+    void* file = MAP_FAILED;
+    if (fd >= 0) {
+        if (ftruncate(fd, (off_t)fileSize) == 0) {
+            file = mmap(NULL, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        close(fd); // The mapping keeps the file
+    }
+    if (!tier || !slotNext || file == MAP_FAILED || pthread_mutex_init(&tier->mutex, NULL) != 0) {
+        if (file != MAP_FAILED) munmap(file, fileSize);
+        free(slotNext);
+        free(tier);
+        return NULL;
+    }
+
+    tier->pool = pool;
+    tier->file = (char*)file;
+    tier->fileSize = fileSize;
+    tier->slotNext = slotNext;
+    for (size_t i = 0; i < fileBlocks; ++i) slotNext[i] = i + 1 < fileBlocks ? (uint32_t)(i + 1) : TIER_NONE;
+    tier->freeSlot = 0;
+    tier->numEntries = numEntries;
+    for (size_t i = 0; i < numEntries; ++i) {
+        tier->entries[i].slot = TIER_NONE;
+        tier->entries[i].nextFree = i + 1 < numEntries ? (uint32_t)(i + 2) : 0;
+    }
+    tier->freeHandle = 1;
+    return tier;
+}
+
+void memPoolTierDestroy(MemoryPoolTier_t* tier) {
+    if (!tier) return;
+    for (size_t i = 0; i < tier->numEntries; ++i) {
+        if (tier->entries[i].used && tier->entries[i].block) freeBlock(tier->pool, tier->entries[i].block);
+    }
+    munmap(tier->file, tier->fileSize);
+    pthread_mutex_destroy(&tier->mutex);
+    free(tier->slotNext);
+    free(tier);
+}
+
+MemoryPoolHandle_t memPoolTierAllocate(MemoryPoolTier_t* tier) {
+    pthread_mutex_lock(&tier->mutex);
+    MemoryPoolHandle_t handle = tier->freeHandle;
+    void* block = handle ? allocateResident(tier) : NULL;
+    if (block) {
+        TierEntry_t* entry = &tier->entries[handle - 1];
+        tier->freeHandle = entry->nextFree;
+        entry->block = block;
+        entry->slot = TIER_NONE;
+        entry->pins = 0;
+        entry->used = 1;
+        entry->accessed = 1;
+        ++tier->resident;
+    } else {
+        handle = 0;
+    }
+    pthread_mutex_unlock(&tier->mutex);
+    return handle;
+}
+
+void memPoolTierFree(MemoryPoolTier_t* tier, MemoryPoolHandle_t handle) {
+    pthread_mutex_lock(&tier->mutex);
+    TierEntry_t* entry = entryOf(tier, handle);
+    if (entry) {
+        if (entry->block) {
+            freeBlock(tier->pool, entry->block);
+            --tier->resident;
+        } else {
+            releaseSlot(tier, entry->slot);
+            --tier->demoted;
+        }
+        entry->block = NULL;
+        entry->slot = TIER_NONE;
+        entry->used = 0;
+        entry->nextFree = tier->freeHandle;
+        tier->freeHandle = handle;
+    }
+    pthread_mutex_unlock(&tier->mutex);
+}
+
+void* memPoolTierPin(MemoryPoolTier_t* tier, MemoryPoolHandle_t handle) {
+    pthread_mutex_lock(&tier->mutex);
+    TierEntry_t* entry = entryOf(tier, handle);
+    void* block = NULL;
+    if (entry && !entry->block) promote(tier, entry);
+    if (entry && entry->block) {
+        ++entry->pins;
+        entry->accessed = 1;
+        block = entry->block;
+    }
+    pthread_mutex_unlock(&tier->mutex);
+    return block;
+}
+
+void memPoolTierUnpin(MemoryPoolTier_t* tier, MemoryPoolHandle_t handle) {
+    pthread_mutex_lock(&tier->mutex);
+    TierEntry_t* entry = entryOf(tier, handle);
+    if (entry && entry->pins) --entry->pins;
+    pthread_mutex_unlock(&tier->mutex);
+}
+
+int memPoolTierDemote(MemoryPoolTier_t* tier, MemoryPoolHandle_t handle) {
+    pthread_mutex_lock(&tier->mutex);
+    TierEntry_t* entry = entryOf(tier, handle);
+    int result = entry ? demote(tier, entry) : -1;
+    pthread_mutex_unlock(&tier->mutex);
+    return result;
+}
+
+size_t memPoolTierSweep(MemoryPoolTier_t* tier) {
+    size_t numDemoted = 0;
+    pthread_mutex_lock(&tier->mutex);
+    for (size_t i = 0; i < tier->numEntries; ++i) {
+        TierEntry_t* entry = &tier->entries[i];
+        if (!entry->used || !entry->block || entry->pins) continue;
+        if (entry->accessed) entry->accessed = 0;
+        else if (demote(tier, entry) == 0) ++numDemoted;
+    }
+    pthread_mutex_unlock(&tier->mutex);
+    return numDemoted;
+}
+
+size_t memPoolTierResident(MemoryPoolTier_t* tier) {
+    pthread_mutex_lock(&tier->mutex);
+    size_t resident = tier->resident;
+    pthread_mutex_unlock(&tier->mutex);
+    return resident;
+}
+
+size_t memPoolTierDemoted(MemoryPoolTier_t* tier) {
+    pthread_mutex_lock(&tier->mutex);
+    size_t demoted = tier->demoted;
+    pthread_mutex_unlock(&tier->mutex);
+    return demoted;
+}
@@ -0,0 +1,67 @@
+// Tiny pools: creation and accounting
+
+#include "mem_pool_tiny.h"
+
+#ifdef USE_FREERTOS
+    #include "FreeRTOS.h"
+    #define pvPortFree vPortFree
+#else
+    #include <stdlib.h>
+    #define pvPortMalloc malloc
+    #define pvPortFree   free
+#endif
+
+// *****Library functions*****
+
+size_t tinyPoolFootprint(size_t blockSize, size_t numBlocks) {
+    if (blockSize < sizeof(MemoryBlock_t) || blockSize % sizeof(void*) || blockSize > MEM_POOL_TINY_MAX_BLOCK_SIZE) {
+        return 0;
+    }
+    if (numBlocks == 0 || numBlocks > MEM_POOL_TINY_MAX_BLOCKS) return 0;
+    return sizeof(MemoryPoolTiny_t) + blockSize * numBlocks;
+}
+
+MemoryPoolTiny_t* initTinyPool(void* memory, size_t size, size_t blockSize) {
+    if (!memory || (uintptr_t)memory % sizeof(void*) || size < sizeof(MemoryPoolTiny_t)) return NULL;
+    size_t numBlocks = blockSize ? (size - sizeof(MemoryPoolTiny_t)) / blockSize : 0;
+    if (numBlocks > MEM_POOL_TINY_MAX_BLOCKS) numBlocks = MEM_POOL_TINY_MAX_BLOCKS;
+    if (!tinyPoolFootprint(blockSize, numBlocks)) return NULL;
+
+    MemoryPoolTiny_t* pool = (MemoryPoolTiny_t*)memory;
+    pool->geometry = (uint64_t)(blockSize / sizeof(void*)) | (uint64_t)numBlocks << 16;
+    pool->linkKey = (uint16_t)memPoolMakeSecret(pool, memory);
+    pool->corruptions = 0;
+    ASAN_POISON_MEMORY_REGION(tinyPoolArena(pool), blockSize * numBlocks);
+
+#ifdef DEBUGPRINT
+    printf("\nTiny pool: %u blocks of %u bytes, descriptor %u bytes\n", (unsigned)numBlocks, (unsigned)blockSize,
+           (unsigned)sizeof(MemoryPoolTiny_t));
+#endif
+
+    return pool;
+}
+
+MemoryPoolTiny_t* createTinyPool(size_t blockSize, size_t numBlocks) {
+    size_t size = tinyPoolFootprint(blockSize, numBlocks);
+    if (!size) return NULL;
+    void* memory = pvPortMalloc(size);
+    if (!memory) return NULL;
+    return initTinyPool(memory, size, blockSize);
+}
+
+void destroyTinyPool(MemoryPoolTiny_t* pool) {
+    if (!pool) return;
+    ASAN_UNPOISON_MEMORY_REGION(tinyPoolArena(pool), tinyPoolNumBlocks(pool) * tinyPoolBlockSize(pool));
+    pvPortFree(pool);
+}
+
+size_t tinyPoolCountFree(const MemoryPoolTiny_t* pool) {
+    size_t numBlocks = tinyPoolNumBlocks(pool);
+    size_t count = numBlocks - (size_t)(pool->geometry >> 48);
+    unsigned head = (unsigned)(pool->geometry >> 32) & 0xFFFF;
+    while (head && head <= numBlocks && count < numBlocks) {
+        ++count;
+        head = tinyPoolLoadLink(pool, tinyPoolArena(pool) + (size_t)(head - 1) * tinyPoolBlockSize(pool));
+    }
+    return count;
+}
@@ -0,0 +1,518 @@
+// Returning free arena pages to the OS under memory pressure (Linux).
+//
+// Only whole pages inside the arena are released, and only when every block touching
+// the page is free. Such blocks are unlinked first: MADV_DONTNEED zero-fills the page
+// and would wipe their free-list links.
+
+#include "mem_pool_trim.h"
+
+#include <stdlib.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifndef MADV_POPULATE_WRITE
+    #define MADV_POPULATE_WRITE 23 // Linux 5.14
+#endif
+
+// *****Local types*****
+
+typedef struct ArenaPages_s {
+    uintptr_t first;    // First page boundary inside the arena
+    size_t pageSize;
+    size_t numPages;    // Whole pages inside the arena
+    size_t numBlocks;
+} ArenaPages_t;
+
+typedef struct PressureWatcher_s {
+    MemoryPressureConfig_t config;
+    MemoryPool_t* pools[MEM_POOL_PRESSURE_MAX_POOLS];
+    size_t numPools;
+    pthread_mutex_t mutex;
+    pthread_cond_t wakeup;
+    pthread_t thread;
+    int running;
+    int stop;
+} PressureWatcher_t;
+
+// *****Local variables*****
+
+static PressureWatcher_t watcher = { {}, {}, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0, 0 };
+
+// *****Local functions*****
+
+static inline int testBit(const unsigned char* bits, size_t i) { return (bits[i / 8] >> (i % 8)) & 1; }
+static inline void setBit(unsigned char* bits, size_t i) { bits[i / 8] |= (unsigned char)(1u << (i % 8)); }
+
+static ArenaPages_t arenaPages(const MemoryPool_t* pool) {
+    ArenaPages_t pages;
+    uintptr_t start = (uintptr_t)pool->memoryStart;
+    uintptr_t end = (uintptr_t)pool->memoryEnd;
+    pages.pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    pages.first = (start + pages.pageSize - 1) & ~(uintptr_t)(pages.pageSize - 1);
+    uintptr_t last = end & ~(uintptr_t)(pages.pageSize - 1);
+    pages.numPages = last > pages.first ? (last - pages.first) / pages.pageSize : 0;
+    pages.numBlocks = pool->poolSize / pool->blockSize;
+    return pages;
+}
+
+// Blocks [*firstBlock, *lastBlock] touch page p; false if none does
+static int blocksOfPage(const MemoryPool_t* pool, const ArenaPages_t* pages, size_t p,
+                        size_t* firstBlock, size_t* lastBlock) {
+    uintptr_t offset = pages->first + p * pages->pageSize - (uintptr_t)pool->memoryStart;
+    *firstBlock = offset / pool->blockSize;
+    if (*firstBlock >= pages->numBlocks) return 0;
+    *lastBlock = (offset + pages->pageSize - 1) / pool->blockSize;
+    if (*lastBlock >= pages->numBlocks) *lastBlock = pages->numBlocks - 1;
+    return 1;
+}
+
+// True if block i touches a page marked in the bitmap
+static int blockOnReleasedPage(const MemoryPool_t* pool, const ArenaPages_t* pages,
+                               const unsigned char* released, size_t i) {
+    uintptr_t blockStart = (uintptr_t)pool->memoryStart + i * pool->blockSize;
+    uintptr_t blockEnd = blockStart + pool->blockSize;
+    if (blockEnd <= pages->first) return 0;
+    size_t lo = blockStart > pages->first ? (blockStart - pages->first) / pages->pageSize : 0;
+    size_t hi = (blockEnd - 1 - pages->first) / pages->pageSize;
+    for (size_t p = lo; p <= hi && p < pages->numPages; ++p) {
+        if (testBit(released, p)) return 1;
+    }
+    return 0;
+}
+
+// *****Library functions*****
+
+size_t memPoolTrim(MemoryPool_t* pool) {
+    return memPoolTrimKeep(pool, 0);
+}
+
+size_t memPoolTrimKeep(MemoryPool_t* pool, size_t keepBlocks) {
+    if (!pool) return 0;
+
+    ArenaPages_t pages = arenaPages(pool);
+    if (pages.numPages == 0) return 0;
+
+    unsigned char* freeBlocks = (unsigned char*)calloc((pages.numBlocks + 7) / 8, 1);
+    unsigned char* trimmed = (unsigned char*)calloc((pages.numPages + 7) / 8, 1);
+    if (!freeBlocks || !trimmed) {
+        free(freeBlocks);
+        free(trimmed);
+        return 0;
+    }
+
+    memPoolLock(pool);
+    if (!pool->releasedPages) {
+        pool->releasedPages = (unsigned char*)calloc((pages.numPages + 7) / 8, 1);
+        if (!pool->releasedPages) {
+            memPoolUnlock(pool);
+            free(freeBlocks);
+            free(trimmed);
+            return 0;
+        }
+    }
+
+    // Blocks at the head of the list are handed out first, their pages stay resident
+    size_t skip = keepBlocks;
+    for (MemoryBlock_t* block = pool->freeList; block; block = memPoolLoadLink(pool, block)) {
+        if (!memPoolIsValidLink(pool, block)) break; // Leave a corrupted list to allocateBlock
+        if (skip) {
+            --skip;
+            continue;
+        }
+        setBit(freeBlocks, ((uintptr_t)block - (uintptr_t)pool->memoryStart) / pool->blockSize);
+    }
+
+    size_t numTrimmed = 0;
+    for (size_t p = 0; p < pages.numPages; ++p) {
+        if (testBit(pool->releasedPages, p)) continue;
+        size_t firstBlock, lastBlock;
+        int releasable = 1;
+        if (blocksOfPage(pool, &pages, p, &firstBlock, &lastBlock)) {
+            for (size_t i = firstBlock; i <= lastBlock && releasable; ++i) {
+                releasable = testBit(freeBlocks, i);
+            }
+        }
+        if (releasable) {
+            setBit(trimmed, p);
+            ++numTrimmed;
+        }
+    }
+
+    if (numTrimmed) {
+        // Keep the list order, drop every block that touches a page about to be released
+        MemoryBlock_t* head = NULL;
+        MemoryBlock_t* tail = NULL;
+        MemoryBlock_t* block = pool->freeList;
+        while (block && memPoolIsValidLink(pool, block)) {
+            MemoryBlock_t* next = memPoolLoadLink(pool, block);
+            size_t i = ((uintptr_t)block - (uintptr_t)pool->memoryStart) / pool->blockSize;
+            if (blockOnReleasedPage(pool, &pages, trimmed, i)) {
+                // Read without the lock by memPoolAllocateSlow
+                __atomic_fetch_add(&pool->releasedBlocks, 1, __ATOMIC_RELAXED);
+            } else {
+                if (tail) memPoolStoreLink(pool, tail, block);
+                else head = block;
+                tail = block;
+            }
+            block = next;
+        }
+        if (tail) memPoolStoreLink(pool, tail, NULL);
+        pool->freeList = head;
+
+        for (size_t p = 0; p < pages.numPages; ++p) {
+            if (!testBit(trimmed, p)) continue;
+            size_t run = 1;
+            while (p + run < pages.numPages && testBit(trimmed, p + run)) ++run;
+            madvise((void*)(pages.first + p * pages.pageSize), run * pages.pageSize, MADV_DONTNEED);
+            for (size_t i = 0; i < run; ++i) setBit(pool->releasedPages, p + i);
+            p += run - 1;
+        }
+    }
+    memPoolUnlock(pool);
+
+    free(freeBlocks);
+    free(trimmed);
+
+#ifdef DEBUGPRINT
+    printf("\nPool %p trimmed: %u pages\n", (void*)pool, (unsigned)numTrimmed);
+#endif
+
+    return numTrimmed * pages.pageSize;
+}
+
+size_t memPoolRestore(MemoryPool_t* pool) {
+    if (!pool) return 0;
+
+    ArenaPages_t pages = arenaPages(pool);
+    size_t numRestored = 0;
+
+    memPoolLock(pool);
+    if (!pool->releasedPages || pool->releasedBlocks == 0) {
+        memPoolUnlock(pool);
+        return 0;
+    }
+
+    for (size_t p = 0; p < pages.numPages; ++p) {
+        if (!testBit(pool->releasedPages, p)) continue;
+        size_t run = 1;
+        while (p + run < pages.numPages && testBit(pool->releasedPages, p + run)) ++run;
+        void* addr = (void*)(pages.first + p * pages.pageSize);
+        ASAN_UNPOISON_MEMORY_REGION(addr, run * pages.pageSize); // Re-poisoned when relinked
+        if (madvise(addr, run * pages.pageSize, MADV_POPULATE_WRITE) != 0) {
+            // Older kernel: fault the pages in by hand
+            for (size_t i = 0; i < run; ++i) ((volatile char*)addr)[i * pages.pageSize] = 0;
+        }
+        numRestored += run;
+        p += run - 1;
+    }
+
+    // Every block touching a released page was free when it was unlinked
+    for (size_t i = pages.numBlocks; i-- > 0;) {
+        if (!blockOnReleasedPage(pool, &pages, pool->releasedPages, i)) continue;
+        MemoryBlock_t* block = (MemoryBlock_t*)((char*)pool->memoryStart + i * pool->blockSize);
+        memPoolStoreLink(pool, block, pool->freeList);
+        memPoolPoisonBlock(pool, block);
+        pool->freeList = block;
+    }
+    memset(pool->releasedPages, 0, (pages.numPages + 7) / 8);
+    __atomic_store_n(&pool->releasedBlocks, 0, __ATOMIC_RELAXED);
+    memPoolUnlock(pool);
+
+#ifdef DEBUGPRINT
+    printf("\nPool %p restored: %u pages\n", (void*)pool, (unsigned)numRestored);
+#endif
+
+    return numRestored * pages.pageSize;
+}
+
+int memPoolBlockReleased(const MemoryPool_t* pool, size_t index) {
+    if (!pool->releasedPages) return 0;
+    ArenaPages_t pages = arenaPages(pool);
+    return blockOnReleasedPage(pool, &pages, pool->releasedPages, index);
+}
+
+// *****Large-block mode*****
+
+// A free large block keeps a header of link word and release flag. The flag is set while
+// the body is dropped outside the lock; an allocation that takes the block waits for it.
+#define LARGE_HEADER_SIZE (2 * sizeof(void*))
+#define LARGE_POISON_SIZE 64
+
+static uintptr_t* releaseFlag(MemoryBlock_t* block) {
+    return (uintptr_t*)block + 1;
+}
+
+// Everything past the header that covers whole pages
+static void releaseBody(const MemoryPool_t* pool, void* block) {
+    uintptr_t pageSize = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = ((uintptr_t)block + LARGE_HEADER_SIZE + pageSize - 1) & ~(pageSize - 1);
+    uintptr_t end = ((uintptr_t)block + pool->blockSize) & ~(pageSize - 1);
+    if (end > start) madvise((void*)start, end - start, MADV_DONTNEED);
+}
+
+// Call with the pool lock held; the caller drops the body and clears the flag after unlocking
+static void pushCold(MemoryPool_t* pool, MemoryBlock_t* block) {
+    ASAN_UNPOISON_MEMORY_REGION(block, LARGE_HEADER_SIZE);
+    *releaseFlag(block) = 1;
+    memPoolStoreLink(pool, block, pool->large->cold);
+    pool->large->cold = block;
+    pool->large->coldCount++;
+}
+
+static void finishCold(MemoryPool_t* pool, MemoryBlock_t* block) {
+    releaseBody(pool, block);
+    __atomic_store_n(releaseFlag(block), 0, __ATOMIC_RELEASE);
+}
+
+// Bodies are dropped or handed out unverified, so poison covers the header line only
+static void poisonLarge(const MemoryPool_t* pool, MemoryBlock_t* block) {
+    char* body = (char*)block + LARGE_HEADER_SIZE;
+#if MEM_POOL_POISON
+    memset(body, MEM_POOL_POISON_BYTE, LARGE_POISON_SIZE - LARGE_HEADER_SIZE);
+#endif
+    ASAN_POISON_MEMORY_REGION(body, pool->blockSize - LARGE_HEADER_SIZE);
+    (void)body;
+}
+
+int memPoolSetLargeBlocks(MemoryPool_t* pool, size_t hotBlocks) {
+    if (!pool || pool->large) return -1;
+    if (pool->blockSize < 2 * (size_t)sysconf(_SC_PAGESIZE)) return -1;
+
+    size_t hotLimit = hotBlocks ? hotBlocks : 1;
+    MemoryPoolLarge_t* large = (MemoryPoolLarge_t*)calloc(1, sizeof(MemoryPoolLarge_t) + (hotLimit - 1) * sizeof(void*));
+    if (!large) return -1;
+    large->hotLimit = hotBlocks;
+
+    // Newest free blocks stay hot, the rest moves to the cold list and is released
+    // outside the lock
+    memPoolLock(pool);
+    MemoryBlock_t* rest = pool->freeList;
+    while (rest && large->hotCount < hotBlocks && memPoolIsValidLink(pool, rest)) {
+        large->hot[large->hotCount++] = rest;
+        rest = memPoolLoadLink(pool, rest);
+    }
+    for (size_t i = 0; i < large->hotCount / 2; ++i) { // Ring runs oldest to newest
+        void* swap = large->hot[i];
+        large->hot[i] = large->hot[large->hotCount - 1 - i];
+        large->hot[large->hotCount - 1 - i] = swap;
+    }
+    pool->freeList = NULL;
+    pool->large = large;
+    for (MemoryBlock_t* block = rest; block && memPoolIsValidLink(pool, block);) {
+        MemoryBlock_t* next = memPoolLoadLink(pool, block);
+        pushCold(pool, block);
+        block = next;
+    }
+    MemoryBlock_t* block = large->cold;
+    memPoolUpdateFreeHooks(pool);
+    memPoolUnlock(pool);
+
+    // Read each link before clearing the flag: an allocation may take the block as soon
+    // as it is cleared. The chain ends with the first block pushed (the list was empty).
+    while (block) {
+        MemoryBlock_t* next = memPoolLoadLink(pool, block);
+        finishCold(pool, block);
+        block = next;
+    }
+    return 0;
+}
+
+void* memPoolLargeAllocate(MemoryPool_t* pool) {
+    MemoryPoolLarge_t* large = pool->large;
+    MemoryBlock_t* block = NULL;
+    int cold = 0;
+
+    memPoolLock(pool);
+    if (large->hotCount) {
+        block = (MemoryBlock_t*)large->hot[(large->hotStart + --large->hotCount) % large->hotLimit];
+    } else if (large->cold) {
+        block = large->cold;
+        MemoryBlock_t* next = memPoolLoadLink(pool, block);
+        if (!memPoolIsValidLink(pool, next)) {
+            large->cold = NULL;
+            large->coldCount = 0;
+            memPoolUnlock(pool);
+            memPoolReportCorruption(pool, block, 0);
+            return NULL;
+        }
+        large->cold = next;
+        large->coldCount--;
+        cold = 1;
+    }
+    if (block && ++pool->inUse > pool->highWater) pool->highWater = pool->inUse;
+    memPoolUnlock(pool);
+
+    if (!block) return NULL;
+    while (cold && __atomic_load_n(releaseFlag(block), __ATOMIC_ACQUIRE)) memPoolCpuRelax();
+    ASAN_UNPOISON_MEMORY_REGION(block, pool->blockSize);
+#if MEM_POOL_TRACE
+    if (pool->traceEnabled) memPoolTraceEvent(pool, 'a', block, 0);
+#endif
+    return block;
+}
+
+// Always takes the block: into the hot ring, the oldest hot block leaves it for the cold list
+int memPoolLargeFree(MemoryPool_t* pool, void* blockAddr) {
+    MemoryPoolLarge_t* large = pool->large;
+    MemoryBlock_t* block = (MemoryBlock_t*)blockAddr;
+    MemoryBlock_t* victim = block;
+#if MEM_POOL_TRACE
+    if (pool->traceEnabled) memPoolTraceEvent(pool, 'f', block, 0);
+#endif
+    poisonLarge(pool, block);
+
+    memPoolLock(pool);
+    pool->inUse--;
+    if (large->hotLimit && large->hotCount < large->hotLimit) {
+        large->hot[(large->hotStart + large->hotCount++) % large->hotLimit] = block;
+        victim = NULL;
+    } else if (large->hotLimit) {
+        victim = (MemoryBlock_t*)large->hot[large->hotStart];
+        large->hot[large->hotStart] = block;
+        large->hotStart = (large->hotStart + 1) % large->hotLimit;
+    }
+    if (victim) pushCold(pool, victim);
+    memPoolUnlock(pool);
+
+    if (victim) finishCold(pool, victim);
+    return 1;
+}
+
+// *****Pressure watcher*****
+
+// "some avg10=1.23 avg60=..." line of a PSI file; negative if unavailable
+static double readPsiAvg10(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) return -1.0;
+    double avg10 = -1.0;
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        if (sscanf(line, "some avg10=%lf", &avg10) == 1) break;
+    }
+    fclose(file);
+    return avg10;
+}
+
+// Sum of the "high", "max" and "oom" counters of a cgroup v2 memory.events file
+static unsigned long long readMemoryEvents(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) return 0;
+    unsigned long long total = 0;
+    char key[64];
+    unsigned long long value;
+    while (fscanf(file, "%63s %llu", key, &value) == 2) {
+        if (!strcmp(key, "high") || !strcmp(key, "max") || !strcmp(key, "oom")) total += value;
+    }
+    fclose(file);
+    return total;
+}
+
+static void forEachWatchedPool(size_t (*action)(MemoryPool_t*)) {
+    pthread_mutex_lock(&watcher.mutex);
+    for (size_t i = 0; i < watcher.numPools; ++i) action(watcher.pools[i]);
+    pthread_mutex_unlock(&watcher.mutex);
+}
+
+static void* pressureThread(void* arg) {
+    (void)arg;
+    const MemoryPressureConfig_t* config = &watcher.config;
+    unsigned long long lastEvents = readMemoryEvents(config->eventsPath);
+    unsigned quiet = 0;
+    int trimmed = 0;
+
+    pthread_mutex_lock(&watcher.mutex);
+    while (!watcher.stop) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += config->intervalMs / 1000;
+        deadline.tv_nsec += (long)(config->intervalMs % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        while (!watcher.stop && pthread_cond_timedwait(&watcher.wakeup, &watcher.mutex, &deadline) != ETIMEDOUT) {}
+        if (watcher.stop) break;
+        pthread_mutex_unlock(&watcher.mutex);
+
+        double avg10 = readPsiAvg10(config->psiPath);
+        unsigned long long events = readMemoryEvents(config->eventsPath);
+        int pressure = avg10 >= config->trimAvg10 || events > lastEvents;
+        lastEvents = events;
+
+        if (pressure) {
+            forEachWatchedPool(memPoolTrim);
+            trimmed = 1;
+            quiet = 0;
+        } else if (trimmed && avg10 < config->restoreAvg10 && ++quiet >= config->quietIntervals) {
+            forEachWatchedPool(memPoolRestore);
+            trimmed = 0;
+            quiet = 0;
+        }
+
+        pthread_mutex_lock(&watcher.mutex);
+    }
+    pthread_mutex_unlock(&watcher.mutex);
+    return NULL;
+}
+
+int memPoolPressureStart(const MemoryPressureConfig_t* config) {
+    pthread_mutex_lock(&watcher.mutex);
+    if (watcher.running) {
+        pthread_mutex_unlock(&watcher.mutex);
+        return -1;
+    }
+
+    MemoryPressureConfig_t defaults;
+    memset(&defaults, 0, sizeof(defaults));
+    watcher.config = config ? *config : defaults;
+    if (!watcher.config.psiPath) watcher.config.psiPath = "/proc/pressure/memory";
+    if (!watcher.config.eventsPath) watcher.config.eventsPath = "/sys/fs/cgroup/memory.events";
+    if (watcher.config.trimAvg10 <= 0.0) watcher.config.trimAvg10 = 10.0;
+    if (watcher.config.restoreAvg10 <= 0.0) watcher.config.restoreAvg10 = 1.0;
+    if (!watcher.config.intervalMs) watcher.config.intervalMs = 1000;
+    if (!watcher.config.quietIntervals) watcher.config.quietIntervals = 10;
+
+    watcher.stop = 0;
+    watcher.running = pthread_create(&watcher.thread, NULL, pressureThread, NULL) == 0;
+    int result = watcher.running ? 0 : -1;
+    pthread_mutex_unlock(&watcher.mutex);
+    return result;
+}
+
+void memPoolPressureStop(void) {
+    pthread_mutex_lock(&watcher.mutex);
+    if (!watcher.running) {
+        pthread_mutex_unlock(&watcher.mutex);
+        return;
+    }
+    watcher.stop = 1;
+    pthread_cond_signal(&watcher.wakeup);
+    pthread_mutex_unlock(&watcher.mutex);
+
+    pthread_join(watcher.thread, NULL);
+    watcher.running = 0;
+}
+
+int memPoolPressureWatch(MemoryPool_t* pool) {
+    if (!pool || pool->lockType == MEM_POOL_LOCK_NONE) return -1;
+    pthread_mutex_lock(&watcher.mutex);
+    int result = -1;
+    if (watcher.numPools < MEM_POOL_PRESSURE_MAX_POOLS) {
+        watcher.pools[watcher.numPools++] = pool;
+        result = 0;
+    }
+    pthread_mutex_unlock(&watcher.mutex);
+    return result;
+}
+
+void memPoolPressureUnwatch(MemoryPool_t* pool) {
+    pthread_mutex_lock(&watcher.mutex);
+    for (size_t i = 0; i < watcher.numPools; ++i) {
+        if (watcher.pools[i] == pool) {
+            watcher.pools[i] = watcher.pools[--watcher.numPools];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&watcher.mutex);
+}
@@ -0,0 +1,192 @@
+// Auto-expiring blocks on a hierarchical timer wheel
+
+#include "mem_pool_ttl.h"
+
+#include <stdlib.h>
+
+// *****Local defines*****
+
+#define TTL_EXPIRED (MEM_POOL_TTL_LEVELS * MEM_POOL_TTL_SLOTS)
+#define TTL_IDLE    0xFFFF
+#define TTL_MASK    (MEM_POOL_TTL_SLOTS - 1)
+#define TTL_SPAN    (1ULL << (MEM_POOL_TTL_LEVELS * MEM_POOL_TTL_SLOT_BITS)) // Ticks the wheel covers
+
+// *****Local functions*****
+
+static size_t blockIndex(const MemoryPool_t* pool, const void* block) {
+    return (size_t)((const char*)block - (const char*)pool->memoryStart) / pool->blockSize;
+}
+
+static void linkTimer(MemoryPoolTtl_t* ttl, uint32_t index, unsigned slot) {
+    MemoryPoolTimer_t* timer = &ttl->timers[index];
+    timer->slot = (uint16_t)slot;
+    timer->prev = 0;
+    timer->next = ttl->heads[slot];
+    if (timer->next) ttl->timers[timer->next - 1].prev = index + 1;
+    ttl->heads[slot] = index + 1;
+}
+
+static void unlinkTimer(MemoryPoolTtl_t* ttl, uint32_t index) {
+    MemoryPoolTimer_t* timer = &ttl->timers[index];
+    if (timer->prev) ttl->timers[timer->prev - 1].next = timer->next;
+    else ttl->heads[timer->slot] = timer->next;
+    if (timer->next) ttl->timers[timer->next - 1].prev = timer->prev;
+    timer->slot = TTL_IDLE;
+}
+
+// Level by distance from now, slot by the expiry bits of that level.
+// Timers beyond the span park at the far end and are re-filed when cascaded.
+static void fileTimer(MemoryPoolTtl_t* ttl, uint32_t index) {
+    uint64_t expiry = ttl->timers[index].expiry;
+    uint64_t delta = expiry - ttl->now;
+    if (delta >= TTL_SPAN) {
+        delta = TTL_SPAN - 1;
+        expiry = ttl->now + delta;
+    }
+    unsigned level = 0;
+    while (delta >> ((level + 1) * MEM_POOL_TTL_SLOT_BITS)) ++level;
+    unsigned slot = (unsigned)(expiry >> (level * MEM_POOL_TTL_SLOT_BITS)) & TTL_MASK;
+    linkTimer(ttl, index, level * MEM_POOL_TTL_SLOTS + slot);
+}
+
+static void moveSlot(MemoryPoolTtl_t* ttl, unsigned slot, int expire) {
+    uint32_t next = ttl->heads[slot];
+    ttl->heads[slot] = 0;
+    while (next) {
+        uint32_t index = next - 1;
+        next = ttl->timers[index].next;
+        if (expire || ttl->timers[index].expiry <= ttl->now) {
+            linkTimer(ttl, index, TTL_EXPIRED);
+            --ttl->armed;
+        } else {
+            fileTimer(ttl, index);
+        }
+    }
+}
+
+// One tick: cascade the higher levels whose period starts now, then expire level 0
+static void tick(MemoryPoolTtl_t* ttl) {
+    ++ttl->now;
+    for (unsigned level = 1; level < MEM_POOL_TTL_LEVELS; ++level) {
+        if (ttl->now & ((1ULL << (level * MEM_POOL_TTL_SLOT_BITS)) - 1)) break;
+        moveSlot(ttl, level * MEM_POOL_TTL_SLOTS + ((unsigned)(ttl->now >> (level * MEM_POOL_TTL_SLOT_BITS)) & TTL_MASK), 0);
+    }
+    moveSlot(ttl, (unsigned)ttl->now & TTL_MASK, 1);
+}
+
+// First tick after the current one that expires or cascades a non-empty slot. Level n
+// acts only on multiples of 64^n, so one pass over its 64 slots finds its next one.
+static uint64_t nextEvent(const MemoryPoolTtl_t* ttl) {
+    uint64_t next = UINT64_MAX;
+    for (unsigned level = 0; level < MEM_POOL_TTL_LEVELS; ++level) {
+        unsigned shift = level * MEM_POOL_TTL_SLOT_BITS;
+        uint64_t period = (ttl->now >> shift) + 1;
+        for (unsigned i = 0; i < MEM_POOL_TTL_SLOTS; ++i, ++period) {
+            if (ttl->heads[level * MEM_POOL_TTL_SLOTS + ((unsigned)period & TTL_MASK)]) {
+                if ((period << shift) < next) next = period << shift;
+                break;
+            }
+        }
+    }
+    return next;
+}
+
+// *****Library functions*****
+
+int memPoolTtlEnable(MemoryPool_t* pool, uint64_t now, void* context) {
+    if (!pool || pool->ttl) return -1;
+    size_t numBlocks = pool->poolSize / pool->blockSize;
+    MemoryPoolTtl_t* ttl = (MemoryPoolTtl_t*)calloc(1, sizeof(MemoryPoolTtl_t) +
+                                                       (numBlocks - 1) * sizeof(MemoryPoolTimer_t));
+    if (!ttl) return -1;
+    ttl->now = now;
+    ttl->context = context;
+    for (size_t i = 0; i < numBlocks; ++i) ttl->timers[i].slot = TTL_IDLE;
+    pool->ttl = ttl;
+    memPoolUpdateFreeHooks(pool);
+    return 0;
+}
+
+void* allocateBlockTTL(MemoryPool_t* pool, uint64_t ttl, MemoryPoolExpire_t expire) {
+    if (!pool || !pool->ttl) return NULL;
+    void* block = memPoolAllocateOwn(pool); // Timers exist for the own arena only
+    if (!block) return NULL;
+
+    MemoryPoolTimer_t* timer = &pool->ttl->timers[blockIndex(pool, block)];
+    memPoolLock(pool);
+    timer->expiry = pool->ttl->now + (ttl ? ttl : 1);
+    timer->expire = expire;
+    fileTimer(pool->ttl, (uint32_t)blockIndex(pool, block));
+    ++pool->ttl->armed;
+    memPoolUnlock(pool);
+    return block;
+}
+
+int memPoolTtlRefresh(MemoryPool_t* pool, void* block, uint64_t ttl) {
+    if (!pool || !pool->ttl || !memPoolOwnsBlock(pool, block)) return -1;
+    uint32_t index = (uint32_t)blockIndex(pool, block);
+    MemoryPoolTimer_t* timer = &pool->ttl->timers[index];
+
+    memPoolLock(pool);
+    if (timer->slot != TTL_IDLE) {
+        if (timer->slot == TTL_EXPIRED) ++pool->ttl->armed; // Beat the expiry callback
+        unlinkTimer(pool->ttl, index);
+    } else {
+        ++pool->ttl->armed;
+    }
+    timer->expiry = pool->ttl->now + (ttl ? ttl : 1);
+    fileTimer(pool->ttl, index);
+    memPoolUnlock(pool);
+    return 0;
+}
+
+size_t memPoolTtlAdvance(MemoryPool_t* pool, uint64_t now) {
+    if (!pool || !pool->ttl) return 0;
+    MemoryPoolTtl_t* ttl = pool->ttl;
+
+    // Ticks without an expiry or cascade change nothing, jump straight to the next event
+    // so the lock is held per event rather than per tick
+    memPoolLock(pool);
+    while (ttl->now < now) {
+        uint64_t next = ttl->armed ? nextEvent(ttl) : UINT64_MAX;
+        if (next > now) {
+            ttl->now = now;
+            break;
+        }
+        ttl->now = next - 1;
+        tick(ttl);
+    }
+    memPoolUnlock(pool);
+
+    // Callbacks run unlocked; each expired block is taken off the list first, so a
+    // callback may free, refresh or allocate blocks of this pool
+    size_t numExpired = 0;
+    for (;;) {
+        memPoolLock(pool);
+        uint32_t head = ttl->heads[TTL_EXPIRED];
+        MemoryPoolExpire_t expire = NULL;
+        if (head) {
+            expire = ttl->timers[head - 1].expire;
+            unlinkTimer(ttl, head - 1);
+        }
+        memPoolUnlock(pool);
+        if (!head) break;
+
+        void* block = (char*)pool->memoryStart + (size_t)(head - 1) * pool->blockSize;
+        if (!expire || expire(ttl->context, block)) freeBlock(pool, block);
+        ++numExpired;
+    }
+    return numExpired;
+}
+
+void memPoolTtlCancel(MemoryPool_t* pool, void* block) {
+    uint32_t index = (uint32_t)blockIndex(pool, block);
+    memPoolLock(pool);
+    MemoryPoolTimer_t* timer = &pool->ttl->timers[index];
+    if (timer->slot != TTL_IDLE) {
+        if (timer->slot != TTL_EXPIRED) --pool->ttl->armed;
+        unlinkTimer(pool->ttl, index);
+    }
+    timer->expire = NULL;
+    memPoolUnlock(pool);
+}
@@ -0,0 +1,28 @@
+// Simulated FreeRTOS for host tests: the part of the kernel API the pool uses, running on
+// the uniprocessor scheduler of rtos_sim.h. Not a port; just enough to compile and run the
+// library with -DUSE_FREERTOS under forced preemption.
+
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "rtos_sim.h"
+
+typedef long BaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE  ((BaseType_t)1)
+#define pdFALSE ((BaseType_t)0)
+
+#define configTICK_RATE_HZ 1000
+#define portMAX_DELAY      ((TickType_t)0xFFFFFFFFu)
+
+#define pvPortMalloc malloc
+#define vPortFree    free
+
+// Every preemption point of the pool may switch tasks
+#define MEM_POOL_PREEMPTION_POINT() rtosSimPreemptionPoint()
+
+#endif // FREERTOS_H
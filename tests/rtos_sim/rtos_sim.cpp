@@ -0,0 +1,269 @@
+// Uniprocessor RTOS simulator: scheduler, critical sections, mutexes
+
+#include "rtos_sim.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// *****Local types*****
+
+typedef enum SimState_e {
+    SIM_READY = 0,
+    SIM_BLOCKED, // Waiting for a mutex
+    SIM_DONE
+} SimState_t;
+
+typedef struct SimTask_s {
+    pthread_t thread;
+    RtosSimTask_t entry;
+    void* arg;
+    SimState_t state;
+    RtosSimMutex_t* waitingOn;
+    unsigned mutexesHeld;
+} SimTask_t;
+
+struct RtosSimMutex_s {
+    int owner; // Task index, -1 when free
+    uint64_t takenNs;
+};
+
+// *****Local variables*****
+
+// mutex and cond hand the CPU over; everything else is only touched by the task holding it
+static pthread_mutex_t simMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t simCond = PTHREAD_COND_INITIALIZER;
+static SimTask_t tasks[RTOS_SIM_MAX_TASKS];
+static int numTasks;
+static int current;            // Task holding the CPU
+static int criticalNesting;
+static uint64_t criticalStartNs;
+static uint64_t rng;
+static unsigned preemptPercent;
+static uint64_t startNs;
+static RtosSimStats_t stats;
+
+static __thread int self = -1; // Index of the calling task
+
+// *****Local functions*****
+
+static uint64_t monotonicNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t nextRandom(void) {
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return rng;
+}
+
+// Random ready task other than the caller, -1 if there is none
+static int pickReady(void) {
+    int candidates[RTOS_SIM_MAX_TASKS];
+    int count = 0;
+    for (int i = 0; i < numTasks; ++i) {
+        if (i != self && tasks[i].state == SIM_READY) candidates[count++] = i;
+    }
+    return count ? candidates[nextRandom() % (uint64_t)count] : -1;
+}
+
+// Hands the CPU to next and waits until it comes back; simMutex held
+static void switchTo(int next) {
+    int me = self;
+    ++stats.contextSwitches;
+    current = next;
+    pthread_cond_broadcast(&simCond);
+    while (current != me && tasks[me].state != SIM_DONE) pthread_cond_wait(&simCond, &simMutex);
+}
+
+// The caller cannot continue (blocked or done): run someone else
+static void reschedule(void) {
+    int next = pickReady();
+    if (next < 0) {
+        if (tasks[self].state == SIM_READY) return;
+        if (tasks[self].state == SIM_BLOCKED) {
+            fprintf(stderr, "rtos_sim: deadlock, every task is blocked\n");
+            abort();
+        }
+        // Last task done: wake the runner
+        current = -1;
+        pthread_cond_broadcast(&simCond);
+        return;
+    }
+    switchTo(next);
+}
+
+static void* taskThread(void* arg) {
+    self = (int)(intptr_t)arg;
+    pthread_mutex_lock(&simMutex);
+    while (current != self) pthread_cond_wait(&simCond, &simMutex);
+    pthread_mutex_unlock(&simMutex);
+
+    tasks[self].entry(tasks[self].arg);
+
+    pthread_mutex_lock(&simMutex);
+    if (criticalNesting || tasks[self].mutexesHeld) {
+        fprintf(stderr, "rtos_sim: task %d returned inside a critical section or holding a mutex\n", self);
+        abort();
+    }
+    tasks[self].state = SIM_DONE;
+    reschedule();
+    pthread_mutex_unlock(&simMutex);
+    return NULL;
+}
+
+// *****Simulator control*****
+
+int rtosSimCreateTask(RtosSimTask_t task, void* arg) {
+    if (numTasks == RTOS_SIM_MAX_TASKS) return -1;
+    memset(&tasks[numTasks], 0, sizeof(SimTask_t));
+    tasks[numTasks].entry = task;
+    tasks[numTasks].arg = arg;
+    ++numTasks;
+    return 0;
+}
+
+void rtosSimRun(uint64_t seed, unsigned percent) {
+    memset(&stats, 0, sizeof(stats));
+    rng = seed ? seed : 1;
+    preemptPercent = percent;
+    criticalNesting = 0;
+    startNs = monotonicNs();
+
+    pthread_mutex_lock(&simMutex);
+    current = numTasks ? 0 : -1;
+    for (int i = 0; i < numTasks; ++i) {
+        if (pthread_create(&tasks[i].thread, NULL, taskThread, (void*)(intptr_t)i) != 0) abort();
+    }
+    while (current != -1) pthread_cond_wait(&simCond, &simMutex);
+    pthread_mutex_unlock(&simMutex);
+
+    for (int i = 0; i < numTasks; ++i) pthread_join(tasks[i].thread, NULL);
+    numTasks = 0;
+}
+
+const RtosSimStats_t* rtosSimStats(void) {
+    return &stats;
+}
+
+void rtosSimReport(FILE* out, const char* title) {
+    fprintf(out, "[RTOS-SIM] %s: %llu switches, %llu forced preemptions, %llu deferred in critical sections\n", title,
+            (unsigned long long)stats.contextSwitches, (unsigned long long)stats.preemptions,
+            (unsigned long long)stats.deferred);
+    if (stats.criticalSections) {
+        fprintf(out, "[RTOS-SIM]   critical sections: %llu, max %llu ns, mean %llu ns\n",
+                (unsigned long long)stats.criticalSections, (unsigned long long)stats.criticalMaxNs,
+                (unsigned long long)(stats.criticalTotalNs / stats.criticalSections));
+    }
+    if (stats.mutexHolds) {
+        fprintf(out, "[RTOS-SIM]   mutex holds: %llu, max %llu ns, mean %llu ns, %llu preempted holders, %llu waits\n",
+                (unsigned long long)stats.mutexHolds, (unsigned long long)stats.mutexMaxNs,
+                (unsigned long long)(stats.mutexTotalNs / stats.mutexHolds),
+                (unsigned long long)stats.mutexPreemptions, (unsigned long long)stats.mutexWaits);
+    }
+}
+
+// *****Kernel services*****
+
+void rtosSimPreemptionPoint(void) {
+    if (self < 0) return; // Not a simulated task
+    if (criticalNesting) {
+        ++stats.deferred;
+        return;
+    }
+    if (nextRandom() % 100 >= preemptPercent) return;
+
+    pthread_mutex_lock(&simMutex);
+    int next = pickReady();
+    if (next >= 0) {
+        ++stats.preemptions;
+        if (tasks[self].mutexesHeld) ++stats.mutexPreemptions;
+        switchTo(next);
+    }
+    pthread_mutex_unlock(&simMutex);
+}
+
+void rtosSimEnterCritical(void) {
+    if (criticalNesting++ == 0) criticalStartNs = monotonicNs();
+}
+
+void rtosSimExitCritical(void) {
+    if (--criticalNesting) return;
+    uint64_t length = monotonicNs() - criticalStartNs;
+    ++stats.criticalSections;
+    stats.criticalTotalNs += length;
+    if (length > stats.criticalMaxNs) stats.criticalMaxNs = length;
+}
+
+void rtosSimYield(void) {
+    if (self < 0) return;
+    pthread_mutex_lock(&simMutex);
+    int next = pickReady();
+    if (next >= 0) switchTo(next);
+    pthread_mutex_unlock(&simMutex);
+}
+
+uint32_t rtosSimTickCount(void) {
+    return (uint32_t)((monotonicNs() - startNs) / 1000000ULL);
+}
+
+RtosSimMutex_t* rtosSimMutexCreate(void) {
+    RtosSimMutex_t* mutex = (RtosSimMutex_t*)malloc(sizeof(RtosSimMutex_t));
+    if (mutex) mutex->owner = -1;
+    return mutex;
+}
+
+void rtosSimMutexDelete(RtosSimMutex_t* mutex) {
+    free(mutex);
+}
+
+int rtosSimMutexTake(RtosSimMutex_t* mutex, int wait) {
+    if (criticalNesting) {
+        fprintf(stderr, "rtos_sim: mutex taken inside a critical section\n");
+        abort();
+    }
+    if (self < 0) {
+        // Outside the simulation (pool creation, checks in main): nothing else runs
+        mutex->owner = RTOS_SIM_MAX_TASKS;
+        return 1;
+    }
+    if (mutex->owner >= 0 && !wait) return 0;
+
+    pthread_mutex_lock(&simMutex);
+    if (mutex->owner >= 0) ++stats.mutexWaits;
+    while (mutex->owner >= 0) {
+        tasks[self].state = SIM_BLOCKED;
+        tasks[self].waitingOn = mutex;
+        reschedule();
+    }
+    mutex->owner = self;
+    mutex->takenNs = monotonicNs();
+    ++tasks[self].mutexesHeld;
+    pthread_mutex_unlock(&simMutex);
+    return 1;
+}
+
+void rtosSimMutexGive(RtosSimMutex_t* mutex) {
+    if (self < 0) {
+        mutex->owner = -1;
+        return;
+    }
+    pthread_mutex_lock(&simMutex);
+    uint64_t length = monotonicNs() - mutex->takenNs;
+    ++stats.mutexHolds;
+    stats.mutexTotalNs += length;
+    if (length > stats.mutexMaxNs) stats.mutexMaxNs = length;
+    --tasks[self].mutexesHeld;
+    mutex->owner = -1;
+    for (int i = 0; i < numTasks; ++i) {
+        if (tasks[i].state == SIM_BLOCKED && tasks[i].waitingOn == mutex) {
+            tasks[i].state = SIM_READY;
+            tasks[i].waitingOn = NULL;
+        }
+    }
+    pthread_mutex_unlock(&simMutex);
+}
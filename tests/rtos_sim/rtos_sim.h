@@ -0,0 +1,74 @@
+// Uniprocessor RTOS simulator for host tests.
+//
+// Simulated tasks are pthreads, but exactly one of them holds the simulated CPU at a time
+// and the CPU only changes hands inside the simulator, so a run is a deterministic function
+// of its seed. At every MEM_POOL_PREEMPTION_POINT the running task is preempted with the
+// configured probability in favour of a random ready task, except inside a critical
+// section, where interrupts are masked: the preemption is deferred and counted. Critical
+// sections and mutex holds are timed; the longest critical section bounds the interrupt
+// latency the pool adds on target. There are no priorities, every ready task is eligible.
+
+#ifndef RTOS_SIM_H
+#define RTOS_SIM_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *****Defines*****
+
+#define RTOS_SIM_MAX_TASKS 16
+
+// *****Types*****
+
+typedef void (*RtosSimTask_t)(void* arg);
+
+typedef struct RtosSimMutex_s RtosSimMutex_t;
+
+typedef struct RtosSimStats_s {
+    uint64_t contextSwitches;
+    uint64_t preemptions;      // Forced at preemption points
+    uint64_t deferred;         // Preemption points reached inside a critical section
+    uint64_t criticalSections;
+    uint64_t criticalMaxNs;
+    uint64_t criticalTotalNs;
+    uint64_t mutexHolds;
+    uint64_t mutexMaxNs;       // Includes the time other tasks ran while the mutex was held
+    uint64_t mutexTotalNs;
+    uint64_t mutexPreemptions; // Preemptions of a task holding a mutex
+    uint64_t mutexWaits;       // Takes that blocked on a held mutex
+} RtosSimStats_t;
+
+// *****Simulator control*****
+
+// Task started by the next rtosSimRun. Returns 0 on success.
+int rtosSimCreateTask(RtosSimTask_t task, void* arg);
+// Runs the created tasks until all of them return; preemptPercent is the chance of a
+// switch at each preemption point
+void rtosSimRun(uint64_t seed, unsigned preemptPercent);
+// Statistics of the last run
+const RtosSimStats_t* rtosSimStats(void);
+void rtosSimReport(FILE* out, const char* title);
+
+// *****Kernel services (FreeRTOS.h, task.h, semphr.h)*****
+
+void rtosSimPreemptionPoint(void);
+void rtosSimEnterCritical(void);
+void rtosSimExitCritical(void);
+void rtosSimYield(void);
+uint32_t rtosSimTickCount(void);
+
+RtosSimMutex_t* rtosSimMutexCreate(void);
+void rtosSimMutexDelete(RtosSimMutex_t* mutex);
+// Returns nonzero once the mutex is taken, 0 if it is held and wait is 0
+int rtosSimMutexTake(RtosSimMutex_t* mutex, int wait);
+void rtosSimMutexGive(RtosSimMutex_t* mutex);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RTOS_SIM_H
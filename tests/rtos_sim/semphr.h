@@ -0,0 +1,16 @@
+// Simulated FreeRTOS mutex API, see FreeRTOS.h
+
+#ifndef SEMPHR_H
+#define SEMPHR_H
+
+#include "FreeRTOS.h"
+
+typedef RtosSimMutex_t* SemaphoreHandle_t;
+
+#define xSemaphoreCreateMutex()         rtosSimMutexCreate()
+#define vSemaphoreDelete(mutex)         rtosSimMutexDelete(mutex)
+#define xSemaphoreTake(mutex, waitTicks) \
+    (rtosSimMutexTake((mutex), (waitTicks) != 0) ? pdTRUE : pdFALSE)
+#define xSemaphoreGive(mutex)           (rtosSimMutexGive(mutex), pdTRUE)
+
+#endif // SEMPHR_H
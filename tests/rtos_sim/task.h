@@ -0,0 +1,15 @@
+// Simulated FreeRTOS task API, see FreeRTOS.h
+
+#ifndef TASK_H
+#define TASK_H
+
+#include "FreeRTOS.h"
+
+// A critical section masks interrupts: no preemption until it is left
+#define taskENTER_CRITICAL() rtosSimEnterCritical()
+#define taskEXIT_CRITICAL()  rtosSimExitCritical()
+#define taskYIELD()          rtosSimYield()
+
+#define xTaskGetTickCount() ((TickType_t)rtosSimTickCount())
+
+#endif // TASK_H
@@ -0,0 +1,533 @@
+// Author: D.S. Koshelev, updated by ChatGPT
+// Created: 05/04/2023
+// Requirement: Portable for C and FreeRTOS
+//
+// Unit tests of the block allocator.
+
+#include "mem_pool.h"
+#include "mem_pool_cache.h"
+#include "mem_pool_evict.h"
+#include "mem_pool_ring.h"
+
+#include <assert.h>
+#include <time.h>
+
+// *****Local prototypes*****
+
+void test_createMemoryPool(size_t blockSize, size_t poolSize);
+void test_allocateBlock(size_t blockSize, size_t poolSize);
+void test_freeBlock(size_t blockSize, size_t poolSize);
+void test_safeLinking(size_t blockSize, size_t poolSize);
+void test_poisonOnFree(size_t blockSize, size_t poolSize);
+void test_lockedPool(size_t blockSize, size_t poolSize);
+void test_blockCache(size_t blockSize, size_t poolSize);
+void test_spill(size_t blockSize, size_t poolSize);
+void test_adaptive(size_t blockSize, size_t poolSize);
+void test_eviction(size_t blockSize, size_t poolSize);
+void test_ringStore(size_t blockSize, size_t poolSize);
+
+// Cache entries store their key in the first word; key 0 is pinned
+static int evictEntry(void* context, void* block) {
+    size_t* evicted = (size_t*)context;
+    if (*(size_t*)block == 0) return 0;
+    *evicted = *(size_t*)block;
+    return 1;
+}
+
+// *****Unit tests*****
+
+void test_createMemoryPool(size_t blockSize, size_t poolSize) {
+#ifdef DEBUGPRINT
+    printf("\n[TEST] CreateMemoryPool - start\n");
+#endif
+    MemoryPool_t* pool = createMemoryPool(blockSize, poolSize);
+
+    assert(pool != NULL);
+    assert(pool->blockSize == blockSize);
+    assert(pool->poolSize == poolSize);
+    assert(pool->freeList != NULL);
+
+    destroyMemoryPool(pool);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] CreateMemoryPool - success\n\n");
+#endif
+}
+
+void test_allocateBlock(size_t blockSize, size_t poolSize) {
+#ifdef DEBUGPRINT
+    printf("\n[TEST] AllocateBlock - start\n");
+#endif
+    MemoryPool_t* pool = createMemoryPool(blockSize, poolSize);
+
+    void* block1 = allocateBlock(pool);
+    void* block2 = allocateBlock(pool);
+    void* block3 = allocateBlock(pool);
+
+    assert(block1 && block2 && block3);
+    assert(block1 != block2 && block2 != block3);
+
+    freeBlock(pool, block2);
+
+    void* block4 = allocateBlock(pool);
+    assert(block4 == block2); // Should reuse freed block
+
+    destroyMemoryPool(pool);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] AllocateBlock - success\n\n");
+#endif
+}
+
+void test_freeBlock(size_t blockSize, size_t poolSize) {
+#ifdef DEBUGPRINT
+    printf("\n[TEST] FreeBlock - start\n");
+#endif
+    MemoryPool_t* pool = createMemoryPool(blockSize, poolSize);
+
+    void* block = allocateBlock(pool);
+    assert(block != NULL);
+
+    freeBlock(pool, block);
+    assert(pool->freeList == block);
+
+    destroyMemoryPool(pool);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] FreeBlock - success\n\n");
+#endif
+}
+
+void test_safeLinking(size_t blockSize, size_t poolSize) {
+#if MEM_POOL_SAFE_LINKING
+#ifdef DEBUGPRINT
+    printf("\n[TEST] SafeLinking - start\n");
+#endif
+    MemoryPool_t* pool = createMemoryPool(blockSize, poolSize);
+
+    void* block1 = allocateBlock(pool);
+    void* block2 = allocateBlock(pool);
+    freeBlock(pool, block1);
+    freeBlock(pool, block2);
+
+    // Stored link is not a plain pointer
+    assert(((MemoryBlock_t*)block2)->next != (MemoryBlock_t*)block1);
+
+    // Use-after-free write of a raw pointer into the freed block
+    static MemoryBlock_t outside;
+    ((MemoryBlock_t*)block2)->next = &outside;
+
+    assert(allocateBlock(pool) == NULL);
+    assert(pool->corruptions == 1);
+
+    destroyMemoryPool(pool);
+
+    // Correctly mangled link into the middle of a block
+    if (blockSize >= 2 * sizeof(MemoryBlock_t)) {
+        pool = createMemoryPool(blockSize, poolSize);
+        block1 = allocateBlock(pool);
+        block2 = allocateBlock(pool);
+        freeBlock(pool, block1);
+        freeBlock(pool, block2);
+        memPoolStoreLink(pool, (MemoryBlock_t*)block2, (MemoryBlock_t*)((char*)block1 + sizeof(MemoryBlock_t)));
+
+        assert(allocateBlock(pool) == NULL);
+        assert(pool->corruptions == 1);
+        destroyMemoryPool(pool);
+    }
+
+#ifdef DEBUGPRINT
+    printf("[TEST] SafeLinking - success\n\n");
+#endif
+#else
+    (void)blockSize;
+    (void)poolSize;
+#endif
+}
+
+void test_poisonOnFree(size_t blockSize, size_t poolSize) {
+    // Needs a body to poison, every allocation checked, and no sanitizer trapping the write
+#if MEM_POOL_POISON && !defined(MEM_POOL_ASAN)
+    if (blockSize <= sizeof(MemoryBlock_t)) return;
+#ifdef DEBUGPRINT
+    printf("\n[TEST] PoisonOnFree - start\n");
+#endif
+    MemoryPool_t* pool = createMemoryPool(blockSize, poolSize);
+    memPoolSetPoisonSample(pool, 1);
+
+    unsigned char* block = (unsigned char*)allocateBlock(pool);
+    assert(block != NULL);
+    assert(block[blockSize - 1] == (unsigned char)MEM_POOL_POISON_BYTE);
+    assert(pool->corruptions == 0);
+
+    freeBlock(pool, block);
+    block[blockSize - 1] = 0; // Use-after-free write
+
+    assert(allocateBlock(pool) == block);
+    assert(pool->corruptions == 1);
+
+    destroyMemoryPool(pool);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] PoisonOnFree - success\n\n");
+#endif
+#else
+    (void)blockSize;
+    (void)poolSize;
+#endif
+}
+
+#ifndef USE_FREERTOS
+#define TEST_THREADS    4
+#define TEST_ITERATIONS 20000
+
+static void* lockedPoolWorker(void* arg) {
+    MemoryPool_t* pool = (MemoryPool_t*)arg;
+    for (int i = 0; i < TEST_ITERATIONS; ++i) {
+        size_t* block = (size_t*)allocateBlock(pool);
+        if (!block) continue;
+        *block = (size_t)i; // Would corrupt the list if the block were handed out twice
+        freeBlock(pool, block);
+    }
+    return NULL;
+}
+
+static void* ringWorker(void* arg) {
+    MemoryPoolCache_t cache;
+    memPoolCacheInitRing(&cache, (MemoryPoolRing_t*)arg);
+    void* held[2] = { NULL, NULL };
+    for (int i = 0; i < TEST_ITERATIONS; ++i) {
+        size_t* block = (size_t*)allocateBlockCached(&cache);
+        if (!block) continue;
+        *block = (size_t)i;
+        // Keep one block across iterations so frees hit the drain path in a different order
+        freeBlockCached(&cache, held[i & 1]);
+        held[i & 1] = block;
+    }
+    freeBlockCached(&cache, held[0]);
+    freeBlockCached(&cache, held[1]);
+    memPoolCacheFlush(&cache);
+    return NULL;
+}
+#endif
+
+void test_lockedPool(size_t blockSize, size_t poolSize) {
+#ifndef USE_FREERTOS
+#ifdef DEBUGPRINT
+    printf("\n[TEST] LockedPool - start\n");
+#endif
+    for (int lockType = MEM_POOL_LOCK_SPIN; lockType <= MEM_POOL_LOCK_PI_MUTEX; ++lockType) {
+        MemoryPool_t* pool = createMemoryPoolEx(blockSize, poolSize, (MemoryPoolLock_t)lockType);
+        assert(pool != NULL);
+
+        pthread_t threads[TEST_THREADS];
+        for (int i = 0; i < TEST_THREADS; ++i) {
+            assert(pthread_create(&threads[i], NULL, lockedPoolWorker, pool) == 0);
+        }
+        for (int i = 0; i < TEST_THREADS; ++i) pthread_join(threads[i], NULL);
+
+        // Every block is back on the list exactly once
+        size_t numBlocks = 0;
+        while (allocateBlock(pool)) ++numBlocks;
+        assert(numBlocks == poolSize / blockSize);
+        assert(pool->corruptions == 0);
+
+        destroyMemoryPool(pool);
+    }
+#ifdef DEBUGPRINT
+    printf("[TEST] LockedPool - success\n\n");
+#endif
+#else
+    (void)blockSize;
+    (void)poolSize;
+#endif
+}
+
+void test_blockCache(size_t blockSize, size_t poolSize) {
+#ifdef DEBUGPRINT
+    printf("\n[TEST] BlockCache - start\n");
+#endif
+    MemoryPool_t* pool = createMemoryPoolEx(blockSize, poolSize, MEM_POOL_LOCK_SPIN);
+    const size_t numBlocks = poolSize / blockSize;
+    memPoolSetCacheLimit(pool, 4);
+
+    MemoryPoolCache_t cache;
+    memPoolCacheInit(&cache, pool);
+
+    // Refill takes half of the limit in one batch
+    void* block1 = allocateBlockCached(&cache);
+    assert(block1 != NULL);
+    assert(cache.count == 1);
+    assert(memPoolCountFree(pool) == numBlocks - 2);
+
+    // Frees stay local up to the limit, then half of it goes back
+    void* block2 = allocateBlockCached(&cache);
+    freeBlockCached(&cache, block2);
+    freeBlockCached(&cache, block1);
+    assert(cache.count == 2);
+    void* blocks[4];
+    for (int i = 0; i < 4; ++i) blocks[i] = allocateBlockCached(&cache);
+    for (int i = 0; i < 4; ++i) freeBlockCached(&cache, blocks[i]);
+    assert(cache.count <= 4);
+
+    memPoolCacheFlush(&cache);
+    assert(cache.count == 0);
+    assert(memPoolCountFree(pool) == numBlocks);
+
+    // Batch allocation drains the pool and stops at exhaustion
+    void* all[MEM_POOL_SIZE / sizeof(MemoryBlock_t) + 1];
+    assert(allocateBlocks(pool, all, numBlocks + 1) == numBlocks);
+    freeBlocks(pool, all, numBlocks);
+    assert(memPoolCountFree(pool) == numBlocks);
+
+    destroyMemoryPool(pool);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] BlockCache - success\n\n");
+#endif
+}
+
+void test_spill(size_t blockSize, size_t poolSize) {
+#ifdef DEBUGPRINT
+    printf("\n[TEST] Spill - start\n");
+#endif
+    const size_t numBlocks = poolSize / blockSize;
+    MemoryPool_t* small = createMemoryPool(blockSize, poolSize);
+    MemoryPool_t* medium = createMemoryPool(2 * blockSize, 2 * poolSize);
+    MemoryPool_t* large = createMemoryPool(4 * blockSize, 4 * poolSize);
+    assert(memPoolSetSpill(medium, small, 100) != 0); // Only towards larger blocks
+    assert(memPoolSetSpill(small, medium, 300) == 0);
+
+    void* all[MEM_POOL_SIZE / sizeof(MemoryBlock_t)];
+    for (size_t i = 0; i < numBlocks; ++i) all[i] = allocateBlock(small);
+
+    // Small is exhausted: medium lends, then large once medium is empty too
+    void* spilled = allocateBlock(small);
+    assert(spilled != NULL && memPoolOwnsBlock(medium, spilled));
+    void* mediumBlocks[MEM_POOL_SIZE / sizeof(MemoryBlock_t)];
+    size_t numMedium = 0;
+    while ((mediumBlocks[numMedium] = allocateBlock(medium)) != NULL) ++numMedium;
+    assert(memPoolSetSpill(medium, large, 100) == 0);
+    void* spilledFar = allocateBlock(small);
+    assert(spilledFar != NULL && memPoolOwnsBlock(large, spilledFar));
+    assert(small->spills == 2);
+
+    // Waste limit: medium may not go further than 2x its block size
+    memPoolSetSpill(small, medium, 50);
+    assert(allocateBlock(small) == NULL);
+
+    // Freed through small, spilled blocks go back to their owners
+    freeBlock(small, spilled);
+    freeBlocks(small, &spilledFar, 1);
+    assert(medium->inUse == numMedium && large->inUse == 0);
+    freeBlocks(small, all, numBlocks);
+    freeBlocks(medium, mediumBlocks, numMedium);
+    assert(memPoolCountFree(small) == numBlocks && small->inUse == 0);
+    assert(memPoolCountFree(medium) == numMedium + 1 && medium->inUse == 0);
+    assert(small->corruptions == 0 && medium->corruptions == 0 && large->corruptions == 0);
+
+    destroyMemoryPool(small);
+    destroyMemoryPool(medium);
+    destroyMemoryPool(large);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] Spill - success\n\n");
+#endif
+}
+
+void test_adaptive(size_t blockSize, size_t poolSize) {
+#ifdef DEBUGPRINT
+    printf("\n[TEST] Adaptive - start\n");
+#endif
+    const size_t numBlocks = poolSize / blockSize;
+    const struct timespec window = { 0, (long)(MEM_POOL_ADAPT_WINDOW_NS + 1000000ULL) };
+    MemoryPool_t* pool = createMemoryPoolEx(blockSize, poolSize, MEM_POOL_LOCK_SPIN);
+    memPoolSetAdaptive(pool, 4);
+    assert(pool->cacheLimit == 0); // Starts on the single-head path
+
+    MemoryPoolCache_t cache;
+    memPoolCacheInit(&cache, pool);
+    void* block = allocateBlockCached(&cache);
+    assert(cache.count == 0);
+
+    // Sustained contention switches caching on
+    nanosleep(&window, NULL);
+    __atomic_fetch_add(&pool->contentions, 4 * MEM_POOL_ADAPT_CONTENDED, __ATOMIC_RELAXED);
+    for (int i = 1; i < MEM_POOL_ADAPT_CHECK_EVERY - 1; ++i) { // The refill was the first call
+        memPoolAdaptTick(pool);
+        assert(pool->cacheLimit == 0);
+    }
+    memPoolAdaptTick(pool);
+    assert(pool->cacheLimit == 4);
+    freeBlockCached(&cache, block);
+    block = allocateBlockCached(&cache);
+    void* extra = allocateBlockCached(&cache);
+    freeBlockCached(&cache, extra);
+    assert(cache.count > 0);
+
+    // Quiet windows switch it off; the cache hands its blocks back on the next free
+    for (int i = 0; i < MEM_POOL_ADAPT_QUIET_WINDOWS; ++i) {
+        assert(pool->cacheLimit == 4);
+        nanosleep(&window, NULL);
+        memPoolAdapt(pool);
+    }
+    assert(pool->cacheLimit == 0);
+    freeBlockCached(&cache, block);
+    assert(cache.count == 0);
+    assert(memPoolCountFree(pool) == numBlocks);
+
+    destroyMemoryPool(pool);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] Adaptive - success\n\n");
+#endif
+}
+
+void test_eviction(size_t blockSize, size_t poolSize) {
+#ifdef DEBUGPRINT
+    printf("\n[TEST] Eviction - start\n");
+#endif
+    const size_t numBlocks = poolSize / blockSize;
+    MemoryPool_t* pool = createMemoryPool(blockSize, poolSize);
+    size_t evicted = 0;
+    assert(memPoolSetEviction(pool, evictEntry, &evicted) == 0);
+
+    // The hand sweeps in address order, entries are indexed the same way
+    size_t* entries[MEM_POOL_SIZE / sizeof(MemoryBlock_t)];
+    for (size_t i = 0; i < numBlocks; ++i) {
+        size_t* entry = (size_t*)allocateBlock(pool);
+        size_t index = ((char*)entry - (char*)pool->memoryStart) / blockSize;
+        entries[index] = entry;
+        *entry = index; // Entry 0 is pinned
+        memPoolTouch(pool, entry);
+    }
+
+    // All referenced: the first turn clears the bits, the oldest unpinned entry goes
+    size_t* reused = (size_t*)allocateBlock(pool);
+    assert(reused == entries[1] && evicted == 1);
+    *reused = 100;
+    memPoolTouch(pool, reused);
+
+    // A hit protects an entry from the next sweep
+    memPoolTouch(pool, entries[2]);
+    reused = (size_t*)allocateBlock(pool);
+    assert(reused == entries[3] && evicted == 3);
+    assert(pool->evictions == 2 && pool->inUse == numBlocks);
+
+    // Freed entries leave the clock
+    freeBlock(pool, entries[2]);
+    assert(pool->evictMeta[((char*)entries[2] - (char*)pool->memoryStart) / blockSize] == 0);
+    assert(allocateBlock(pool) == entries[2]);
+    assert(pool->corruptions == 0);
+
+    // Every entry pinned: the pool spills, and the borrowed block has no entry state
+    MemoryPool_t* larger = createMemoryPool(2 * blockSize, 2 * poolSize);
+    assert(memPoolSetSpill(pool, larger, 100) == 0);
+    for (size_t i = 0; i < numBlocks; ++i) {
+        *entries[i] = 0;
+        memPoolTouch(pool, entries[i]);
+    }
+    size_t* spilled = (size_t*)allocateBlock(pool);
+    assert(spilled != NULL && memPoolOwnsBlock(larger, spilled));
+    memPoolTouch(pool, spilled);
+    for (size_t i = 0; i < numBlocks; ++i) {
+        assert(pool->evictMeta[i] == (MEM_POOL_EVICT_LIVE | MEM_POOL_EVICT_REFERENCED));
+    }
+    freeBlock(pool, spilled);
+    assert(larger->inUse == 0 && pool->corruptions == 0 && larger->corruptions == 0);
+
+    destroyMemoryPool(pool);
+    destroyMemoryPool(larger);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] Eviction - success\n\n");
+#endif
+}
+
+void test_ringStore(size_t blockSize, size_t poolSize) {
+#ifdef DEBUGPRINT
+    printf("\n[TEST] RingStore - start\n");
+#endif
+    const size_t numBlocks = poolSize / blockSize;
+    MemoryPool_t* pool = createMemoryPoolEx(blockSize, poolSize, MEM_POOL_LOCK_SPIN);
+    MemoryPoolRing_t* ring = memPoolRingCreate(pool);
+    assert(ring != NULL);
+    assert(memPoolRingCount(ring) == numBlocks && pool->inUse == numBlocks);
+
+    // Bulk moves are bounded by what is there; odd batches make the indices wrap
+    void* blocks[MEM_POOL_SIZE / sizeof(MemoryBlock_t) + 1];
+    assert(memPoolRingDequeue(ring, blocks, numBlocks + 1) == numBlocks);
+    assert(memPoolRingDequeue(ring, blocks, 1) == 0);
+    assert(memPoolRingEnqueue(ring, blocks, numBlocks) == numBlocks);
+    assert(memPoolRingEnqueue(ring, blocks, 1) == 0);
+    for (int i = 0; i < 100; ++i) {
+        size_t batch = 1 + (size_t)i % numBlocks;
+        assert(memPoolRingDequeue(ring, blocks, batch) == batch);
+        assert(memPoolRingCount(ring) == numBlocks - batch);
+        assert(memPoolRingEnqueue(ring, blocks, batch) == batch);
+    }
+
+#ifndef USE_FREERTOS
+    memPoolSetCacheLimit(pool, 2);
+    pthread_t threads[TEST_THREADS];
+    for (int i = 0; i < TEST_THREADS; ++i) {
+        assert(pthread_create(&threads[i], NULL, ringWorker, ring) == 0);
+    }
+    for (int i = 0; i < TEST_THREADS; ++i) pthread_join(threads[i], NULL);
+#endif
+
+    // Every block is back exactly once
+    assert(memPoolRingDequeue(ring, blocks, numBlocks) == numBlocks);
+    for (size_t i = 0; i < numBlocks; ++i) {
+        assert(memPoolOwnsBlock(pool, blocks[i]));
+        for (size_t j = 0; j < i; ++j) assert(blocks[i] != blocks[j]);
+    }
+    assert(memPoolRingEnqueue(ring, blocks, numBlocks) == numBlocks);
+
+    memPoolRingDestroy(ring);
+    assert(pool->inUse == 0 && memPoolCountFree(pool) == numBlocks);
+    assert(pool->corruptions == 0);
+    destroyMemoryPool(pool);
+
+    // A block in use while the ring is created is freed into it later
+    pool = createMemoryPoolEx(blockSize, poolSize, MEM_POOL_LOCK_SPIN);
+    void* held = allocateBlock(pool);
+    ring = memPoolRingCreate(pool);
+    assert(memPoolRingCount(ring) == numBlocks - 1);
+    MemoryPoolCache_t cache;
+    memPoolCacheInitRing(&cache, ring);
+    freeBlockCached(&cache, held);
+    memPoolCacheFlush(&cache);
+    assert(memPoolRingCount(ring) == numBlocks);
+    assert(pool->corruptions == 0);
+
+    // Freed twice: the full ring takes no more, the block is counted and dropped
+    freeBlockCached(&cache, held);
+    memPoolCacheFlush(&cache);
+    assert(memPoolRingCount(ring) == numBlocks && pool->corruptions == 1);
+    memPoolRingDestroy(ring);
+    assert(pool->inUse == 0 && memPoolCountFree(pool) == numBlocks);
+    destroyMemoryPool(pool);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] RingStore - success\n\n");
+#endif
+}
+
+// *****Main*****
+
+int main(void) {
+    test_createMemoryPool(MEM_BLOCK_SIZE, MEM_POOL_SIZE);
+    test_allocateBlock(MEM_BLOCK_SIZE, MEM_POOL_SIZE);
+    test_freeBlock(MEM_BLOCK_SIZE, MEM_POOL_SIZE);
+    test_safeLinking(MEM_BLOCK_SIZE, MEM_POOL_SIZE);
+    test_poisonOnFree(MEM_BLOCK_SIZE, MEM_POOL_SIZE);
+    test_lockedPool(MEM_BLOCK_SIZE, MEM_POOL_SIZE);
+    test_blockCache(MEM_BLOCK_SIZE, MEM_POOL_SIZE);
+    test_spill(MEM_BLOCK_SIZE, MEM_POOL_SIZE);
+    test_adaptive(MEM_BLOCK_SIZE, MEM_POOL_SIZE);
+    test_eviction(MEM_BLOCK_SIZE, MEM_POOL_SIZE);
+    test_ringStore(MEM_BLOCK_SIZE, MEM_POOL_SIZE);
+
+    return 0;
+}
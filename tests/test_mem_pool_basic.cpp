@@ -0,0 +1,198 @@
+// Unit tests of the policy-based pool template.
+
+#include "mem_pool_basic.h"
+
+#include <assert.h>
+
+using namespace mem_pool;
+
+// *****Local defines*****
+
+#define BASIC_BLOCK_SIZE 32
+#define BASIC_NUM_BLOCKS 100 // Not a multiple of 64, exercises the bitmap tail
+#define BASIC_WIDE_BLOCKS (64 * 70 + 5) // More words than one summary word covers
+#define BASIC_THREADS    4
+#define BASIC_ROUNDS     20000
+
+// *****Local prototypes*****
+
+void test_basicPolicies(void);
+void test_basicConcurrent(void);
+void test_inlinePool(void);
+
+// *****Local functions*****
+
+// Drain, check uniqueness and range, refill; twice to cover reuse
+template <class Pool>
+static void exercisePool(Pool& pool) {
+    assert(pool.valid());
+    void* blocks[Pool::numBlocks];
+    for (int pass = 0; pass < 2; ++pass) {
+        for (size_t i = 0; i < Pool::numBlocks; ++i) {
+            blocks[i] = pool.allocate();
+            assert(blocks[i] != NULL && pool.owns(blocks[i]));
+            memset(blocks[i], (int)i, Pool::blockSize);
+        }
+        assert(pool.allocate() == NULL);
+        for (size_t i = 0; i < Pool::numBlocks; ++i) {
+            for (size_t j = 0; j < Pool::blockSize; ++j) assert(((unsigned char*)blocks[i])[j] == (unsigned char)i);
+        }
+        for (size_t i = 0; i < Pool::numBlocks; ++i) pool.free(blocks[(i * 7) % Pool::numBlocks]);
+    }
+}
+
+template <class Pool>
+static void* hammerPool(void* arg) {
+    Pool* pool = (Pool*)arg;
+    void* blocks[4];
+    for (int round = 0; round < BASIC_ROUNDS; ++round) {
+        for (int j = 0; j < 4; ++j) blocks[j] = pool->allocate();
+        for (int j = 0; j < 4; ++j) {
+            if (blocks[j]) ((volatile char*)blocks[j])[Pool::blockSize - 1] = 1; // Clear of the link word
+        }
+        for (int j = 0; j < 4; ++j) pool->free(blocks[j]);
+    }
+    return NULL;
+}
+
+template <class Pool>
+static void runConcurrent(void) {
+    static Pool pool;
+    pthread_t threads[BASIC_THREADS];
+    for (int i = 0; i < BASIC_THREADS; ++i) pthread_create(&threads[i], NULL, hammerPool<Pool>, &pool);
+    for (int i = 0; i < BASIC_THREADS; ++i) pthread_join(threads[i], NULL);
+    exercisePool(pool);
+    assert(pool.stats().inUse == 0);
+    assert(pool.stats().allocations == pool.stats().frees);
+}
+
+// *****Unit tests*****
+
+void test_basicPolicies(void) {
+#ifdef DEBUGPRINT
+    printf("\n[TEST] BasicPolicies - start\n");
+#endif
+    static BasicPool<StaticStorage<BASIC_BLOCK_SIZE, BASIC_NUM_BLOCKS>, ListFreeList, NoSync> staticList;
+    static BasicPool<HeapStorage<BASIC_BLOCK_SIZE, BASIC_NUM_BLOCKS>, BitmapFreeList, SpinSync> heapBitmap;
+    static BasicPool<HeapStorage<BASIC_BLOCK_SIZE, BASIC_NUM_BLOCKS>, LockFreeList, NoSync> heapLockFree;
+    exercisePool(staticList);
+    exercisePool(heapBitmap);
+    exercisePool(heapLockFree);
+    static BasicPool<HeapStorage<BASIC_BLOCK_SIZE, BASIC_NUM_BLOCKS>, AtomicBitmapFreeList, NoSync> heapAtomicBitmap;
+    static BasicPool<HeapStorage<BASIC_BLOCK_SIZE, BASIC_WIDE_BLOCKS>, AtomicBitmapFreeList, NoSync> wideAtomicBitmap;
+    exercisePool(heapAtomicBitmap);
+    exercisePool(wideAtomicBitmap);
+#if MEM_POOL_BASIC_MMAP
+    static BasicPool<MmapStorage<BASIC_BLOCK_SIZE, BASIC_NUM_BLOCKS>, BitmapFreeList, MutexSync> mmapBitmap;
+    exercisePool(mmapBitmap);
+#endif
+
+    // Unused policies take no space
+    typedef BasicPool<StaticStorage<BASIC_BLOCK_SIZE, BASIC_NUM_BLOCKS>, ListFreeList, NoSync> Bare;
+    assert(sizeof(Bare) <= BASIC_BLOCK_SIZE * BASIC_NUM_BLOCKS + 2 * sizeof(void*));
+
+    BasicPool<StaticStorage<BASIC_BLOCK_SIZE, 4>, BitmapFreeList, NoSync, CountingStats> counted;
+    void* a = counted.allocate();
+    void* b = counted.allocate();
+    counted.free(a);
+    assert(counted.stats().allocations == 2 && counted.stats().frees == 1);
+    assert(counted.stats().inUse == 1 && counted.stats().highWater == 2);
+    assert(counted.allocate() == a); // Lowest free block first
+    counted.free(a);
+    counted.free(b);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] BasicPolicies - success\n\n");
+#endif
+}
+
+void test_basicConcurrent(void) {
+#ifdef DEBUGPRINT
+    printf("\n[TEST] BasicConcurrent - start\n");
+#endif
+    runConcurrent<BasicPool<HeapStorage<BASIC_BLOCK_SIZE, BASIC_NUM_BLOCKS>, LockFreeList, NoSync, AtomicCountingStats> >();
+    runConcurrent<BasicPool<HeapStorage<BASIC_BLOCK_SIZE, BASIC_NUM_BLOCKS>, AtomicBitmapFreeList, NoSync,
+                            AtomicCountingStats> >();
+    runConcurrent<BasicPool<HeapStorage<BASIC_BLOCK_SIZE, BASIC_WIDE_BLOCKS>, AtomicBitmapFreeList, NoSync,
+                            AtomicCountingStats> >();
+    runConcurrent<BasicPool<HeapStorage<BASIC_BLOCK_SIZE, BASIC_NUM_BLOCKS>, ListFreeList, SpinSync, CountingStats> >();
+    runConcurrent<BasicPool<HeapStorage<BASIC_BLOCK_SIZE, BASIC_NUM_BLOCKS>, BitmapFreeList, MutexSync, CountingStats> >();
+    runConcurrent<BasicPool<HeapStorage<BASIC_BLOCK_SIZE, BASIC_NUM_BLOCKS>, ListFreeList, PiMutexSync, CountingStats> >();
+
+#ifdef DEBUGPRINT
+    printf("[TEST] BasicConcurrent - success\n\n");
+#endif
+}
+
+void test_inlinePool(void) {
+#ifdef DEBUGPRINT
+    printf("[TEST] InlinePool\n");
+#endif
+    enum { INLINE_BLOCKS = 4, SHARED_BLOCKS = 8 };
+    MemoryPool_t* shared = createMemoryPoolEx(2 * BASIC_BLOCK_SIZE, 2 * BASIC_BLOCK_SIZE * SHARED_BLOCKS,
+                                              MEM_POOL_LOCK_SPIN);
+    assert(shared != NULL);
+
+    InlinePool<BASIC_BLOCK_SIZE, INLINE_BLOCKS> local(shared);
+    void* blocks[INLINE_BLOCKS + 2];
+    for (size_t i = 0; i < INLINE_BLOCKS + 2; ++i) {
+        blocks[i] = local.allocate();
+        assert(blocks[i] != NULL);
+        assert(local.owns(blocks[i]) == (i < INLINE_BLOCKS));
+        memset(blocks[i], (int)i, BASIC_BLOCK_SIZE);
+    }
+    assert(local.overflows() == 2);
+    assert(memPoolCountFree(shared) == SHARED_BLOCKS - 2);
+
+    // Routed by address: overflow blocks go back to the shared pool, inline ones are reused LIFO
+    local.free(blocks[INLINE_BLOCKS]);
+    local.free(blocks[1]);
+    local.free(NULL);
+    assert(memPoolCountFree(shared) == SHARED_BLOCKS - 1);
+    assert(local.allocate() == blocks[1]);
+    for (size_t i = 0; i < INLINE_BLOCKS + 2; ++i) {
+        if (i != INLINE_BLOCKS) local.free(blocks[i]);
+    }
+    assert(memPoolCountFree(shared) == SHARED_BLOCKS);
+
+    // Shared pool of smaller blocks, or none: no overflow
+    InlinePool<4 * BASIC_BLOCK_SIZE, 1> large(shared);
+    InlinePool<BASIC_BLOCK_SIZE, 1> alone(NULL);
+    void* block = large.allocate();
+    assert(block != NULL && large.allocate() == NULL);
+    large.free(block);
+    block = alone.allocate();
+    assert(block != NULL && alone.allocate() == NULL && alone.overflows() == 0);
+    alone.free(block);
+
+    // Foreign pointers without a shared pool are counted and dropped, never followed
+    void* foreign = allocateBlock(shared);
+    large.free(foreign);
+    alone.free(foreign);
+    assert(large.strayFrees() == 1 && alone.strayFrees() == 1);
+    assert(memPoolCountFree(shared) == SHARED_BLOCKS - 1);
+    freeBlock(shared, foreign);
+    assert(local.strayFrees() == 0 && shared->corruptions == 0);
+
+    // With a shared pool, pointers it does not own either are dropped, not linked
+    uint64_t outside[BASIC_BLOCK_SIZE / sizeof(uint64_t)];
+    local.free(outside);
+    assert(local.strayFrees() == 1);
+    assert(memPoolCountFree(shared) == SHARED_BLOCKS);
+    for (size_t i = 0; i < SHARED_BLOCKS; ++i) assert(allocateBlock(shared) != (void*)outside);
+    destroyMemoryPool(shared);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] InlinePool - success\n\n");
+#endif
+}
+
+// *****Main*****
+
+int main(void) {
+    test_basicPolicies();
+    test_basicConcurrent();
+    test_inlinePool();
+
+    return 0;
+}
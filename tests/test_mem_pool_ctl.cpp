@@ -0,0 +1,198 @@
+// Unit tests of the control endpoint.
+
+#include "mem_pool_ctl.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// *****Local defines*****
+
+#define CTL_BLOCK_SIZE 32
+#define CTL_POOL_SIZE  (CTL_BLOCK_SIZE * 128)
+
+// *****Local prototypes*****
+
+void test_ctlCommands(void);
+void test_ctlSocket(void);
+
+// *****Local functions*****
+
+// Reply of one command as a NUL-terminated string, caller frees
+static char* execute(const char* command) {
+    char* reply = NULL;
+    size_t size = 0;
+    FILE* out = open_memstream(&reply, &size);
+    assert(out != NULL);
+    memPoolCtlExecute(command, out);
+    fclose(out);
+    return reply;
+}
+
+static int endsWith(const char* text, const char* suffix) {
+    size_t textLength = strlen(text);
+    size_t suffixLength = strlen(suffix);
+    return textLength >= suffixLength && !strcmp(text + textLength - suffixLength, suffix);
+}
+
+// *****Unit tests*****
+
+void test_ctlCommands(void) {
+#ifdef DEBUGPRINT
+    printf("\n[TEST] CtlCommands - start\n");
+#endif
+    MemoryPool_t* unlocked = createMemoryPool(CTL_BLOCK_SIZE, CTL_POOL_SIZE);
+    assert(memPoolCtlRegister(unlocked, "unlocked") == -1);
+    destroyMemoryPool(unlocked);
+
+    MemoryPool_t* pool = createMemoryPoolEx(CTL_BLOCK_SIZE, CTL_POOL_SIZE, MEM_POOL_LOCK_MUTEX);
+    int id = memPoolCtlRegister(pool, "sessions");
+    assert(id >= 0);
+    void* block = allocateBlock(pool);
+
+    char command[64];
+    char* reply = execute("list");
+    assert(strstr(reply, "sessions 32 128 127 1 ") != NULL);
+    assert(endsWith(reply, "ok\n"));
+    free(reply);
+
+    snprintf(command, sizeof(command), "cache %d 8", id);
+    free(execute(command));
+    assert(pool->cacheLimit == 8);
+
+    snprintf(command, sizeof(command), "stats %d", id);
+    reply = execute(command);
+    assert(strstr(reply, "in_use=1\n") != NULL);
+    assert(strstr(reply, "cache_limit=8\n") != NULL);
+    free(reply);
+
+    snprintf(command, sizeof(command), "map %d", id);
+    reply = execute(command);
+    assert(!strncmp(reply, "00000000 ....", 13));
+    assert(strchr(reply, '#') == strrchr(reply, '#') && strchr(reply, '#') != NULL);
+    free(reply);
+
+#if MEM_POOL_TRACE
+    // Trace files only by plain name in the directory given at start
+    reply = execute("trace open mem_pool_ctl_trace.txt");
+    assert(!strncmp(reply, "error", 5));
+    free(reply);
+    char socketPath[64];
+    snprintf(socketPath, sizeof(socketPath), "/tmp/mem_pool_ctl_trace_%d.sock", (int)getpid());
+    assert(memPoolCtlStart(socketPath, "/tmp") == 0);
+    const char* badNames[] = { "../etc/passwd", "/tmp/x", "sub/x", "..", "." };
+    for (size_t i = 0; i < sizeof(badNames) / sizeof(badNames[0]); ++i) {
+        snprintf(command, sizeof(command), "trace open %s", badNames[i]);
+        reply = execute(command);
+        assert(!strncmp(reply, "error", 5));
+        free(reply);
+    }
+
+    const char* tracePath = "/tmp/mem_pool_ctl_trace.txt";
+    reply = execute("trace open mem_pool_ctl_trace.txt");
+    assert(endsWith(reply, "ok\n"));
+    free(reply);
+    snprintf(command, sizeof(command), "trace %d on", id);
+    free(execute(command));
+    freeBlock(pool, allocateBlock(pool));
+    free(execute("trace close"));
+
+    FILE* trace = fopen(tracePath, "r");
+    assert(trace != NULL);
+    char line[128];
+    int numEvents = 0;
+    while (fgets(line, sizeof(line), trace)) numEvents += line[0] != '#';
+    fclose(trace);
+    unlink(tracePath);
+    assert(numEvents == 2);
+    memPoolCtlStop();
+#endif
+
+    // The idle-priority thread never takes a spin lock
+    MemoryPool_t* spinPool = createMemoryPoolEx(CTL_BLOCK_SIZE, CTL_POOL_SIZE, MEM_POOL_LOCK_SPIN);
+    int spinId = memPoolCtlRegister(spinPool, "spin");
+    const char* lockingCommands[] = { "map %d", "trim %d", "restore %d", "sample %d 4" };
+    for (size_t i = 0; i < sizeof(lockingCommands) / sizeof(lockingCommands[0]); ++i) {
+        snprintf(command, sizeof(command), lockingCommands[i], spinId);
+        reply = execute(command);
+        assert(!strncmp(reply, "error", 5));
+        free(reply);
+    }
+    snprintf(command, sizeof(command), "stats %d", spinId);
+    reply = execute(command);
+    assert(strstr(reply, "free=128\n") != NULL && endsWith(reply, "ok\n"));
+    free(reply);
+    memPoolCtlUnregister(spinPool);
+    destroyMemoryPool(spinPool);
+
+    reply = execute("stats 63");
+    assert(!strncmp(reply, "error", 5));
+    free(reply);
+
+    freeBlock(pool, block);
+    memPoolCtlUnregister(pool);
+    destroyMemoryPool(pool);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] CtlCommands - success\n\n");
+#endif
+}
+
+void test_ctlSocket(void) {
+#ifdef DEBUGPRINT
+    printf("\n[TEST] CtlSocket - start\n");
+#endif
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/mem_pool_ctl_%d.sock", (int)getpid());
+
+    MemoryPool_t* pool = createMemoryPoolEx(CTL_BLOCK_SIZE, CTL_POOL_SIZE, MEM_POOL_LOCK_SPIN);
+    assert(memPoolCtlRegister(pool, "frames") >= 0);
+    assert(memPoolCtlStart(path, NULL) == 0);
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    // A client that never sends is dropped, the next one gets served
+    int idleFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    assert(connect(idleFd, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    assert(connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+    assert(write(fd, "list\n", 5) == 5);
+
+    char reply[512];
+    size_t length = 0;
+    while (length < sizeof(reply) - 1) {
+        ssize_t received = read(fd, reply + length, sizeof(reply) - 1 - length);
+        assert(received > 0);
+        length += (size_t)received;
+        reply[length] = '\0';
+        if (endsWith(reply, "ok\n")) break;
+    }
+    assert(strstr(reply, " frames ") != NULL);
+    close(fd);
+    char byte;
+    assert(read(idleFd, &byte, 1) == 0);
+    close(idleFd);
+
+    memPoolCtlStop();
+    memPoolCtlUnregister(pool);
+    destroyMemoryPool(pool);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] CtlSocket - success\n\n");
+#endif
+}
+
+// *****Main*****
+
+int main(void) {
+    test_ctlCommands();
+    test_ctlSocket();
+
+    return 0;
+}
@@ -0,0 +1,134 @@
+// Unit tests of the occupancy snapshots and the timeline sampler.
+
+#include "mem_pool_occupancy.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+// *****Local defines*****
+
+#define OCCUPANCY_BLOCK_SIZE 64
+#define OCCUPANCY_NUM_BLOCKS 64
+
+// *****Local prototypes*****
+
+void test_occupancySnapshot(void);
+void test_occupancySampler(void);
+
+// *****Unit tests*****
+
+void test_occupancySnapshot(void) {
+#ifdef DEBUGPRINT
+    printf("[TEST] OccupancySnapshot\n");
+#endif
+    MemoryPool_t* pool = createMemoryPoolEx(OCCUPANCY_BLOCK_SIZE, OCCUPANCY_BLOCK_SIZE * OCCUPANCY_NUM_BLOCKS,
+                                            MEM_POOL_LOCK_SPIN);
+    void* blocks[OCCUPANCY_NUM_BLOCKS];
+    for (size_t i = 0; i < OCCUPANCY_NUM_BLOCKS; ++i) blocks[i] = allocateBlock(pool);
+
+    // Odd blocks free again
+    for (size_t i = 1; i < OCCUPANCY_NUM_BLOCKS; i += 2) freeBlock(pool, blocks[i]);
+    char states[OCCUPANCY_NUM_BLOCKS];
+    assert(memPoolBlockStates(pool, states) == 0);
+    for (size_t i = 0; i < OCCUPANCY_NUM_BLOCKS; ++i) {
+        size_t index = ((uintptr_t)blocks[i] - (uintptr_t)pool->memoryStart) / OCCUPANCY_BLOCK_SIZE;
+        assert(states[index] == (i % 2 ? MEM_POOL_BLOCK_FREE : MEM_POOL_BLOCK_LIVE));
+    }
+
+    // Pieces smaller than a block (the arena is at least 16-byte aligned): a block's pieces
+    // are all full or all empty
+    const size_t piece = 16;
+    const size_t perBlock = OCCUPANCY_BLOCK_SIZE / piece;
+    assert(memPoolOccupancyPages(pool, piece) == OCCUPANCY_NUM_BLOCKS * perBlock);
+    uint8_t levels[OCCUPANCY_NUM_BLOCKS * OCCUPANCY_BLOCK_SIZE / 16];
+    assert(memPoolOccupancySnapshot(pool, piece, levels) == 0);
+    for (size_t i = 0; i < OCCUPANCY_NUM_BLOCKS * perBlock; ++i) {
+        assert(levels[i] == (states[i / perBlock] == MEM_POOL_BLOCK_LIVE ? 255 : 0));
+    }
+
+    // Pieces of four blocks, half of them live: every piece is partly used
+    size_t numPages = memPoolOccupancyPages(pool, 4 * OCCUPANCY_BLOCK_SIZE);
+    assert(numPages >= OCCUPANCY_NUM_BLOCKS / 4 && numPages <= OCCUPANCY_NUM_BLOCKS / 4 + 1);
+    assert(memPoolOccupancySnapshot(pool, 4 * OCCUPANCY_BLOCK_SIZE, levels) == 0);
+    for (size_t i = 0; i < numPages; ++i) assert(levels[i] > 0 && levels[i] < 255);
+
+    // Nothing live
+    for (size_t i = 0; i < OCCUPANCY_NUM_BLOCKS; i += 2) freeBlock(pool, blocks[i]);
+    assert(memPoolOccupancySnapshot(pool, 4 * OCCUPANCY_BLOCK_SIZE, levels) == 0);
+    for (size_t i = 0; i < numPages; ++i) assert(levels[i] == 0);
+
+    destroyMemoryPool(pool);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] OccupancySnapshot - success\n\n");
+#endif
+}
+
+void test_occupancySampler(void) {
+#ifdef DEBUGPRINT
+    printf("[TEST] OccupancySampler\n");
+#endif
+    MemoryPool_t* pool = createMemoryPoolEx(OCCUPANCY_BLOCK_SIZE, OCCUPANCY_BLOCK_SIZE * OCCUPANCY_NUM_BLOCKS,
+                                            MEM_POOL_LOCK_MUTEX);
+    char path[] = "/tmp/mem_pool_occupancy_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+
+    const size_t piece = 4 * OCCUPANCY_BLOCK_SIZE;
+    MemoryPoolSampler_t* sampler = memPoolOccupancyStart(pool, "rx", path, piece, 5, 50);
+    assert(sampler != NULL);
+    void* blocks[OCCUPANCY_NUM_BLOCKS];
+    const struct timespec pause = { 0, 2000000 };
+    for (size_t i = 0; i < OCCUPANCY_NUM_BLOCKS; ++i) {
+        blocks[i] = allocateBlock(pool);
+        nanosleep(&pause, NULL);
+    }
+    size_t samples = memPoolOccupancyStop(sampler);
+    assert(samples >= 2);
+
+    // Header, then one row per sample with a digit per piece; the pool only filled up
+    FILE* file = fopen(path, "r");
+    assert(file != NULL);
+    char line[256];
+    char name[MEM_POOL_OCCUPANCY_NAME_SIZE];
+    unsigned long blockSize, pageSize, pages, time;
+    assert(fgets(line, sizeof(line), file) && line[0] == '#');
+    assert(fgets(line, sizeof(line), file));
+    assert(sscanf(line, "pool %31s %lu %lu %lu", name, &blockSize, &pageSize, &pages) == 4);
+    assert(!strcmp(name, "rx") && blockSize == OCCUPANCY_BLOCK_SIZE && pageSize == piece);
+    assert(pages == memPoolOccupancyPages(pool, piece));
+    size_t rows = 0;
+    unsigned long lastTime = 0;
+    char levels[64];
+    char previous[64] = "";
+    while (fgets(line, sizeof(line), file)) {
+        assert(sscanf(line, "%lu %63s", &time, levels) == 2);
+        assert(strlen(levels) == pages && time >= lastTime);
+        for (size_t i = 0; rows && i < pages; ++i) assert(levels[i] >= previous[i]);
+        memcpy(previous, levels, sizeof(previous));
+        lastTime = time;
+        ++rows;
+    }
+    fclose(file);
+    unlink(path);
+    assert(rows == samples);
+
+    for (size_t i = 0; i < OCCUPANCY_NUM_BLOCKS; ++i) freeBlock(pool, blocks[i]);
+    destroyMemoryPool(pool);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] OccupancySampler - success\n\n");
+#endif
+}
+
+// *****Main*****
+
+int main(void) {
+    test_occupancySnapshot();
+    test_occupancySampler();
+
+    return 0;
+}
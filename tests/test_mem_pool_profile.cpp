@@ -0,0 +1,132 @@
+// Unit tests of high-water tracking and warm-start sizing from a profile.
+
+#include "mem_pool_profile.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// *****Local defines*****
+
+#define PROFILE_BLOCK_SIZE 64
+
+// *****Local prototypes*****
+
+void test_highWater(void);
+void test_profileSizing(void);
+
+// *****Unit tests*****
+
+void test_highWater(void) {
+#ifdef DEBUGPRINT
+    printf("\n[TEST] HighWater - start\n");
+#endif
+    MemoryPool_t* pool = createMemoryPool(PROFILE_BLOCK_SIZE, 16 * PROFILE_BLOCK_SIZE);
+    void* blocks[8];
+
+    for (int i = 0; i < 5; ++i) blocks[i] = allocateBlock(pool);
+    assert(pool->inUse == 5 && pool->highWater == 5);
+    for (int i = 0; i < 5; ++i) freeBlock(pool, blocks[i]);
+    assert(pool->inUse == 0 && pool->highWater == 5);
+
+    assert(allocateBlocks(pool, blocks, 8) == 8);
+    assert(pool->highWater == 8);
+    freeBlocks(pool, blocks, 8);
+    assert(pool->inUse == 0 && pool->highWater == 8);
+
+    destroyMemoryPool(pool);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] HighWater - success\n\n");
+#endif
+}
+
+void test_profileSizing(void) {
+#ifdef DEBUGPRINT
+    printf("\n[TEST] ProfileSizing - start\n");
+#endif
+    char path[] = "/tmp/mem_pool_profile_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+    unlink(path);
+
+    MemoryPoolSizing_t sizing;
+    memset(&sizing, 0, sizeof(sizing));
+    sizing.minBlocks = 16;
+    sizing.maxBlocks = 4096;
+    sizing.defaultBlocks = 1024;
+    sizing.prefaultPercent = 50;
+
+    // No profile yet: default size, full cache
+    MemoryPool_t* pool = memPoolCreateProfiled(path, "rx", PROFILE_BLOCK_SIZE, MEM_POOL_LOCK_NONE, &sizing);
+    assert(pool->poolSize == 1024 * PROFILE_BLOCK_SIZE);
+    assert(pool->cacheLimit == MEM_POOL_CACHE_SIZE);
+
+    void* blocks[200];
+    assert(allocateBlocks(pool, blocks, 200) == 200);
+    freeBlocks(pool, blocks, 200);
+    assert(memPoolProfileSave(path, "rx", pool) == 0);
+    destroyMemoryPool(pool);
+    assert(memPoolProfileLoad(path, "rx", PROFILE_BLOCK_SIZE) == 200);
+    assert(memPoolProfileLoad(path, "rx", 2 * PROFILE_BLOCK_SIZE) == 0);
+    assert(memPoolProfileLoad(path, "tx", PROFILE_BLOCK_SIZE) == 0);
+
+    // Warm start: high water + 25 % reserve, cache at 10 % of the high water
+    pool = memPoolCreateProfiled(path, "rx", PROFILE_BLOCK_SIZE, MEM_POOL_LOCK_NONE, &sizing);
+    assert(pool->poolSize == 250 * PROFILE_BLOCK_SIZE);
+    assert(pool->cacheLimit == 20);
+#if MEM_POOL_TRIM
+    assert(pool->releasedBlocks > 0);
+#endif
+    // The whole arena is usable, released pages come back on demand
+    size_t allocated = 0;
+    while (allocated < 250 && (blocks[allocated % 200] = allocateBlock(pool)) != NULL) ++allocated;
+    assert(allocated == 250);
+    assert(allocateBlock(pool) == NULL);
+    assert(pool->corruptions == 0);
+
+    assert(memPoolProfileSave(path, "rx", pool) == 0);
+    destroyMemoryPool(pool);
+    assert(memPoolProfileLoad(path, "rx", PROFILE_BLOCK_SIZE) == 250);
+
+    // A quieter run only lowers the mark by a quarter, other entries are kept
+    MemoryPool_t* other = createMemoryPool(PROFILE_BLOCK_SIZE, 16 * PROFILE_BLOCK_SIZE);
+    freeBlock(other, allocateBlock(other));
+    assert(memPoolProfileSave(path, "tx", other) == 0);
+    assert(memPoolProfileSave(path, "rx", other) == 0);
+    assert(memPoolProfileLoad(path, "rx", PROFILE_BLOCK_SIZE) == 188); // 250 - 250 / 4
+    assert(memPoolProfileLoad(path, "tx", PROFILE_BLOCK_SIZE) == 1);
+    destroyMemoryPool(other);
+
+    // The same name at another block size is a separate entry
+    other = createMemoryPool(2 * PROFILE_BLOCK_SIZE, 16 * PROFILE_BLOCK_SIZE);
+    void* held[3];
+    for (int i = 0; i < 3; i++) held[i] = allocateBlock(other);
+    for (int i = 0; i < 3; i++) freeBlock(other, held[i]);
+    assert(memPoolProfileSave(path, "rx", other) == 0);
+    assert(memPoolProfileLoad(path, "rx", 2 * PROFILE_BLOCK_SIZE) == 3);
+    assert(memPoolProfileLoad(path, "rx", PROFILE_BLOCK_SIZE) == 188);
+    destroyMemoryPool(other);
+
+    // Bounds win over the profile
+    sizing.maxBlocks = 64;
+    pool = memPoolCreateProfiled(path, "rx", PROFILE_BLOCK_SIZE, MEM_POOL_LOCK_NONE, &sizing);
+    assert(pool->poolSize == 64 * PROFILE_BLOCK_SIZE);
+    destroyMemoryPool(pool);
+
+    unlink(path);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] ProfileSizing - success\n\n");
+#endif
+}
+
+// *****Main*****
+
+int main(void) {
+    test_highWater();
+    test_profileSizing();
+
+    return 0;
+}
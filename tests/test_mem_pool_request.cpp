@@ -0,0 +1,135 @@
+// Unit tests of the request-scoped allocation context.
+
+#include "mem_pool_request.h"
+
+#include <assert.h>
+
+// *****Local defines*****
+
+#define REQUEST_NUM_CLASSES 3
+#define REQUEST_NUM_BLOCKS  256 // Per class, several log chunks
+#define REQUEST_ALLOCATIONS 300
+
+// *****Local prototypes*****
+
+void test_requestRelease(void);
+void test_requestExhausted(void);
+
+// *****Local variables*****
+
+static const size_t classSizes[REQUEST_NUM_CLASSES] = { 32, 128, 512 };
+
+// *****Local functions*****
+
+static void createClasses(MemoryPool_t** pools) {
+    for (size_t i = 0; i < REQUEST_NUM_CLASSES; ++i) {
+        pools[i] = createMemoryPoolEx(classSizes[i], classSizes[i] * REQUEST_NUM_BLOCKS, MEM_POOL_LOCK_SPIN);
+        assert(pools[i] != NULL);
+    }
+}
+
+static void destroyClasses(MemoryPool_t** pools) {
+    for (size_t i = 0; i < REQUEST_NUM_CLASSES; ++i) destroyMemoryPool(pools[i]);
+}
+
+static size_t countChunks(const MemoryPoolRequestChunk_t* chunk) {
+    size_t count = 0;
+    for (; chunk; chunk = chunk->next) ++count;
+    return count;
+}
+
+// *****Unit tests*****
+
+void test_requestRelease(void) {
+#ifdef DEBUGPRINT
+    printf("[TEST] RequestRelease\n");
+#endif
+    MemoryPool_t* pools[REQUEST_NUM_CLASSES];
+    createClasses(pools);
+    MemoryPoolRequest_t request;
+    MemoryPool_t* unsorted[2] = { pools[1], pools[0] };
+    assert(memPoolRequestInit(&request, unsorted, 2) != 0);
+    assert(memPoolRequestInit(&request, pools, 0) != 0);
+    assert(memPoolRequestInit(&request, pools, REQUEST_NUM_CLASSES) == 0);
+
+    size_t perClass[REQUEST_NUM_CLASSES] = {};
+    size_t firstChunks = 0;
+    for (int round = 0; round < 3; ++round) {
+        for (size_t i = 0; i < REQUEST_ALLOCATIONS; ++i) {
+            size_t size = 1 + (i * 37) % classSizes[REQUEST_NUM_CLASSES - 1];
+            void* block = allocateBlockRequest(&request, size);
+            assert(block != NULL);
+            memset(block, 0x5A, size);
+
+            // Smallest class that fits
+            size_t cls = 0;
+            while (classSizes[cls] < size) ++cls;
+            assert(memPoolOwnsBlock(pools[cls], block));
+            if (round == 0) ++perClass[cls];
+        }
+        assert(allocateBlockRequest(&request, classSizes[REQUEST_NUM_CLASSES - 1] + 1) == NULL);
+        for (size_t i = 0; i < REQUEST_NUM_CLASSES; ++i) {
+            assert(memPoolCountFree(pools[i]) == REQUEST_NUM_BLOCKS - perClass[i]);
+        }
+
+        // Later requests run on the chunks of the first one
+        size_t chunks = countChunks(request.spare);
+        for (size_t i = 0; i < REQUEST_NUM_CLASSES; ++i) chunks += countChunks(request.classes[i].chunk);
+        if (round == 0) firstChunks = chunks;
+        assert(chunks == firstChunks && chunks > REQUEST_NUM_CLASSES);
+        assert(memPoolRequestRelease(&request) == REQUEST_ALLOCATIONS);
+        assert(countChunks(request.spare) == chunks);
+        for (size_t i = 0; i < REQUEST_NUM_CLASSES; ++i) {
+            assert(memPoolCountFree(pools[i]) == REQUEST_NUM_BLOCKS);
+            assert(request.classes[i].chunk == NULL);
+        }
+    }
+    assert(memPoolRequestRelease(&request) == 0);
+    memPoolRequestDestroy(&request);
+    assert(request.spare == NULL);
+    destroyClasses(pools);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] RequestRelease - success\n\n");
+#endif
+}
+
+void test_requestExhausted(void) {
+#ifdef DEBUGPRINT
+    printf("[TEST] RequestExhausted\n");
+#endif
+    MemoryPool_t* pools[REQUEST_NUM_CLASSES];
+    createClasses(pools);
+    MemoryPoolRequest_t request;
+    assert(memPoolRequestInit(&request, pools, REQUEST_NUM_CLASSES) == 0);
+
+    // An empty class falls through to the next larger one, in order
+    for (size_t i = 0; i < REQUEST_NUM_CLASSES; ++i) {
+        for (size_t j = 0; j < REQUEST_NUM_BLOCKS; ++j) {
+            void* block = allocateBlockRequest(&request, classSizes[0]);
+            assert(block != NULL && memPoolOwnsBlock(pools[i], block));
+        }
+    }
+    assert(allocateBlockRequest(&request, classSizes[0]) == NULL);
+    assert(allocateBlockRequest(&request, classSizes[REQUEST_NUM_CLASSES - 1]) == NULL);
+
+    // Destroy returns the outstanding blocks to their classes
+    memPoolRequestDestroy(&request);
+    for (size_t i = 0; i < REQUEST_NUM_CLASSES; ++i) {
+        assert(memPoolCountFree(pools[i]) == REQUEST_NUM_BLOCKS && pools[i]->corruptions == 0);
+    }
+    destroyClasses(pools);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] RequestExhausted - success\n\n");
+#endif
+}
+
+// *****Main*****
+
+int main(void) {
+    test_requestRelease();
+    test_requestExhausted();
+
+    return 0;
+}
@@ -0,0 +1,164 @@
+// Preemptive multitasking test: the library built for FreeRTOS (-DUSE_FREERTOS) on the
+// simulated uniprocessor scheduler of tests/rtos_sim, with preemption forced at the
+// MEM_POOL_PREEMPTION_POINT()s of allocateBlock/freeBlock.
+//
+// Usage: test_mem_pool_rtos [seed [preempt percent]]; with arguments the critical-section
+// report is printed, so the RTOS build's interrupt latency can be measured on the host.
+
+#include "mem_pool.h"
+#include "mem_pool_cache.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+// *****Local defines*****
+
+#define RTOS_BLOCK_SIZE    64
+#define RTOS_NUM_BLOCKS    128
+#define RTOS_NUM_WORKERS   3  // Plus one task going through a per-task cache
+#define RTOS_HELD_BLOCKS   8
+#define RTOS_OPERATIONS    4000
+#define RTOS_SEED          0x5EED
+#define RTOS_PREEMPT       30 // Percent of preemption points that switch tasks
+
+// *****Local types*****
+
+typedef struct RtosTask_s {
+    MemoryPool_t* pool;
+    unsigned id; // 1-based, 0 marks a free block in the owner map
+    int cached;
+    uint64_t rng;
+} RtosTask_t;
+
+// *****Local prototypes*****
+
+void test_rtosPreemption(void);
+
+// *****Local variables*****
+
+static unsigned blockOwner[RTOS_NUM_BLOCKS];
+static uint64_t runSeed = RTOS_SEED;
+static unsigned runPercent = RTOS_PREEMPT;
+static int report = 0;
+
+// *****Local functions*****
+
+static size_t blockIndex(const MemoryPool_t* pool, const void* block) {
+    assert(memPoolOwnsBlock(pool, block));
+    return (size_t)((const char*)block - (const char*)pool->memoryStart) / RTOS_BLOCK_SIZE;
+}
+
+// Claim in the owner map: a block handed to two tasks at once fails here
+static void takeBlock(RtosTask_t* task, unsigned char* block) {
+    size_t index = blockIndex(task->pool, block);
+    assert(blockOwner[index] == 0);
+    blockOwner[index] = task->id;
+    memset(block, (int)(task->id * 16 + index % 16), RTOS_BLOCK_SIZE);
+}
+
+static void giveBlock(RtosTask_t* task, unsigned char* block) {
+    size_t index = blockIndex(task->pool, block);
+    assert(blockOwner[index] == task->id);
+    for (size_t i = 0; i < RTOS_BLOCK_SIZE; ++i) assert(block[i] == (unsigned char)(task->id * 16 + index % 16));
+    blockOwner[index] = 0;
+}
+
+static void workerTask(void* arg) {
+    RtosTask_t* task = (RtosTask_t*)arg;
+    MemoryPoolCache_t cache;
+    if (task->cached) memPoolCacheInit(&cache, task->pool);
+
+    unsigned char* held[RTOS_HELD_BLOCKS];
+    size_t count = 0;
+    for (int op = 0; op < RTOS_OPERATIONS; ++op) {
+        task->rng = task->rng * 6364136223846793005ULL + 1442695040888963407ULL;
+        int allocate = count == 0 || (count < RTOS_HELD_BLOCKS && (task->rng >> 33) % 2);
+        if (allocate) {
+            unsigned char* block = (unsigned char*)(task->cached ? allocateBlockCached(&cache)
+                                                                 : allocateBlock(task->pool));
+            assert(block != NULL);
+            takeBlock(task, block);
+            held[count++] = block;
+        } else {
+            size_t victim = (size_t)(task->rng >> 40) % count;
+            unsigned char* block = held[victim];
+            held[victim] = held[--count];
+            giveBlock(task, block);
+            if (task->cached) freeBlockCached(&cache, block);
+            else freeBlock(task->pool, block);
+        }
+    }
+    while (count) {
+        giveBlock(task, held[--count]);
+        if (task->cached) freeBlockCached(&cache, held[count]);
+        else freeBlock(task->pool, held[count]);
+    }
+    if (task->cached) memPoolCacheFlush(&cache);
+}
+
+static void runTasks(MemoryPoolLock_t lockType, const char* name) {
+    MemoryPool_t* pool = createMemoryPoolEx(RTOS_BLOCK_SIZE, RTOS_BLOCK_SIZE * RTOS_NUM_BLOCKS, lockType);
+    assert(pool != NULL);
+    memPoolSetCacheLimit(pool, 8);
+
+    RtosTask_t tasks[RTOS_NUM_WORKERS + 1];
+    for (unsigned i = 0; i <= RTOS_NUM_WORKERS; ++i) {
+        tasks[i].pool = pool;
+        tasks[i].id = i + 1;
+        tasks[i].cached = i == RTOS_NUM_WORKERS;
+        tasks[i].rng = runSeed + i;
+        assert(rtosSimCreateTask(workerTask, &tasks[i]) == 0);
+    }
+    rtosSimRun(runSeed, runPercent);
+
+    // Every block back, nothing corrupted
+    const RtosSimStats_t* stats = rtosSimStats();
+    for (size_t i = 0; i < RTOS_NUM_BLOCKS; ++i) assert(blockOwner[i] == 0);
+    assert(memPoolCountFree(pool) == RTOS_NUM_BLOCKS);
+    assert(pool->inUse == 0 && pool->corruptions == 0);
+
+    // The preemption points were live
+    assert(runPercent == 0 || stats->preemptions > 0);
+    if (lockType == MEM_POOL_LOCK_SPIN) {
+        // Critical sections: no switch inside, the points there were deferred
+        assert(stats->criticalSections > 0 && stats->mutexHolds == 0);
+        assert(stats->deferred > 0);
+    } else {
+        // Mutexes: holders were preempted and other tasks had to wait for them
+        assert(stats->mutexHolds > 0 && stats->criticalSections == 0);
+        assert(runPercent == 0 || (stats->mutexPreemptions > 0 && stats->mutexWaits > 0));
+    }
+
+    if (report) rtosSimReport(stdout, name);
+    destroyMemoryPool(pool);
+}
+
+// *****Unit tests*****
+
+void test_rtosPreemption(void) {
+#ifdef DEBUGPRINT
+    printf("[TEST] RtosPreemption\n");
+#endif
+    runTasks(MEM_POOL_LOCK_SPIN, "spin (critical section)");
+    runTasks(MEM_POOL_LOCK_MUTEX, "mutex");
+    runTasks(MEM_POOL_LOCK_PI_MUTEX, "pi-mutex");
+
+#ifdef DEBUGPRINT
+    printf("[TEST] RtosPreemption - success\n\n");
+#endif
+}
+
+// *****Main*****
+
+int main(int argc, char** argv) {
+    if (argc > 1) runSeed = strtoull(argv[1], NULL, 0);
+    if (argc > 2) runPercent = (unsigned)strtoul(argv[2], NULL, 0);
+#ifdef DEBUGPRINT
+    report = 1;
+#else
+    report = argc > 1;
+#endif
+    test_rtosPreemption();
+
+    return 0;
+}
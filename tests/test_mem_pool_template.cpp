@@ -0,0 +1,153 @@
+// Unit tests of the copy-on-write pool templates.
+
+#include "mem_pool_template.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+// *****Local defines*****
+
+#define TEMPLATE_BLOCK_SIZE 256
+#define TEMPLATE_NUM_BLOCKS 256 // 64 KiB image
+#define TEMPLATE_NUM_BUILT  100 // Blocks initialized in the template
+#define TEMPLATE_NUM_FREED  10  // Of those, freed again
+
+// *****Local prototypes*****
+
+void test_templateInstantiate(void);
+void test_templateCopyOnWrite(void);
+
+// *****Local functions*****
+
+// Anonymous (copied) kB of the mapping starting at address, -1 if unknown
+static long anonymousKb(const void* address) {
+    FILE* file = fopen("/proc/self/smaps", "r");
+    if (!file) return -1;
+    char line[256];
+    int inMapping = 0;
+    long kb = -1;
+    while (fgets(line, sizeof(line), file)) {
+        unsigned long start, end;
+        if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+            inMapping = start == (uintptr_t)address;
+        } else if (inMapping && sscanf(line, "Anonymous: %ld kB", &kb) == 1) {
+            break;
+        }
+    }
+    fclose(file);
+    return kb;
+}
+
+static MemoryPoolTemplate_t* buildTemplate(void) {
+    MemoryPoolTemplate_t* tmpl = memPoolTemplateCreate("test", TEMPLATE_BLOCK_SIZE, TEMPLATE_NUM_BLOCKS);
+    assert(tmpl != NULL);
+    MemoryPoolTiny_t* pool = memPoolTemplatePool(tmpl);
+    assert(pool != NULL && tinyPoolNumBlocks(pool) == TEMPLATE_NUM_BLOCKS);
+
+    for (size_t i = 0; i < TEMPLATE_NUM_BUILT; ++i) {
+        char* block = (char*)allocateTinyBlock(pool);
+        assert(block == tinyPoolArena(pool) + i * TEMPLATE_BLOCK_SIZE);
+        memset(block, (int)i, TEMPLATE_BLOCK_SIZE);
+    }
+    for (size_t i = 0; i < TEMPLATE_NUM_FREED; ++i) {
+        freeTinyBlock(pool, tinyPoolArena(pool) + i * 2 * TEMPLATE_BLOCK_SIZE);
+    }
+    assert(memPoolTemplateSeal(tmpl) == 0);
+    assert(memPoolTemplatePool(tmpl) == NULL);
+    assert(memPoolTemplateSeal(tmpl) != 0);
+    return tmpl;
+}
+
+// *****Unit tests*****
+
+void test_templateInstantiate(void) {
+#ifdef DEBUGPRINT
+    printf("[TEST] TemplateInstantiate\n");
+#endif
+    MemoryPoolTemplate_t* unsealed = memPoolTemplateCreate("unsealed", TEMPLATE_BLOCK_SIZE, TEMPLATE_NUM_BLOCKS);
+    assert(memPoolTemplateInstantiate(unsealed) == NULL);
+    memPoolTemplateDestroy(unsealed);
+    assert(memPoolTemplateCreate("bad", TEMPLATE_BLOCK_SIZE + 1, TEMPLATE_NUM_BLOCKS) == NULL);
+
+    MemoryPoolTemplate_t* tmpl = buildTemplate();
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    MemoryPoolTiny_t* instance = memPoolTemplateInstantiate(tmpl);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    assert(instance != NULL);
+    (void)end;
+
+    // Same geometry, contents and free list as the template
+    assert(tinyPoolBlockSize(instance) == TEMPLATE_BLOCK_SIZE);
+    assert(tinyPoolCountFree(instance) == TEMPLATE_NUM_BLOCKS - TEMPLATE_NUM_BUILT + TEMPLATE_NUM_FREED);
+    for (size_t i = 1; i < TEMPLATE_NUM_BUILT; i += 2) {
+        const char* block = tinyPoolArena(instance) + i * TEMPLATE_BLOCK_SIZE;
+        for (size_t j = 0; j < TEMPLATE_BLOCK_SIZE; ++j) assert(block[j] == (char)i);
+    }
+    // Freed blocks come back LIFO, then the blocks never carved
+    for (size_t i = TEMPLATE_NUM_FREED; i-- > 0;) {
+        assert(allocateTinyBlock(instance) == tinyPoolArena(instance) + i * 2 * TEMPLATE_BLOCK_SIZE);
+    }
+    assert(allocateTinyBlock(instance) == tinyPoolArena(instance) + TEMPLATE_NUM_BUILT * TEMPLATE_BLOCK_SIZE);
+
+    // Instances outlive the template
+    memPoolTemplateDestroy(tmpl);
+    assert(*(tinyPoolArena(instance) + TEMPLATE_BLOCK_SIZE) == 1);
+    memPoolInstanceDestroy(instance);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] TemplateInstantiate - %ld ns - success\n\n",
+           (long)((end.tv_sec - start.tv_sec) * 1000000000L + end.tv_nsec - start.tv_nsec));
+#endif
+}
+
+void test_templateCopyOnWrite(void) {
+#ifdef DEBUGPRINT
+    printf("[TEST] TemplateCopyOnWrite\n");
+#endif
+    MemoryPoolTemplate_t* tmpl = buildTemplate();
+    MemoryPoolTiny_t* first = memPoolTemplateInstantiate(tmpl);
+    MemoryPoolTiny_t* second = memPoolTemplateInstantiate(tmpl);
+    assert(first != NULL && second != NULL && first != second);
+
+    // Reading copies nothing
+    long copied = anonymousKb(first);
+    assert(copied <= 0);
+    volatile char sum = 0;
+    for (size_t i = 0; i < TEMPLATE_NUM_BUILT * TEMPLATE_BLOCK_SIZE; i += 64) sum += tinyPoolArena(first)[i];
+    (void)sum;
+    assert(anonymousKb(first) == copied);
+
+    // Writing one block copies its page only, the other instance keeps the template contents
+    char* block = (char*)tinyPoolArena(first) + 50 * TEMPLATE_BLOCK_SIZE;
+    memset(block, 0x7F, TEMPLATE_BLOCK_SIZE);
+    assert(*(tinyPoolArena(second) + 50 * TEMPLATE_BLOCK_SIZE) == 50);
+    long pageKb = (long)sysconf(_SC_PAGESIZE) / 1024;
+    assert(copied < 0 || anonymousKb(first) == pageKb);
+
+    // Independent free lists
+    void* fromFirst = allocateTinyBlock(first);
+    assert(tinyPoolCountFree(first) == tinyPoolCountFree(second) - 1);
+    freeTinyBlock(first, fromFirst);
+    assert(tinyPoolCountFree(first) == tinyPoolCountFree(second));
+
+#ifdef DEBUGPRINT
+    printf("[TEST] TemplateCopyOnWrite - %ld kB copied after one write - success\n\n", anonymousKb(first));
+#endif
+
+    memPoolInstanceDestroy(first);
+    memPoolInstanceDestroy(second);
+    memPoolTemplateDestroy(tmpl);
+}
+
+// *****Main*****
+
+int main(void) {
+    test_templateInstantiate();
+    test_templateCopyOnWrite();
+
+    return 0;
+}
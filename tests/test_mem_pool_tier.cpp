@@ -0,0 +1,178 @@
+// Unit tests of demotion to the file-backed overflow tier.
+
+#include "mem_pool_tier.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// *****Local defines*****
+
+#define TIER_BLOCK_SIZE 4096
+#define TIER_NUM_BLOCKS 8
+#define TIER_FILE_BLOCKS 24
+#define TIER_NUM_HANDLES (TIER_NUM_BLOCKS + TIER_FILE_BLOCKS)
+
+// *****Local prototypes*****
+
+void test_tierDemotion(void);
+void test_tierSweep(void);
+
+// *****Local functions*****
+
+static void fillBlock(void* block, MemoryPoolHandle_t handle) {
+    memset(block, (int)(handle & 0xFF), TIER_BLOCK_SIZE);
+    *(MemoryPoolHandle_t*)block = handle;
+}
+
+static int checkBlock(const void* block, MemoryPoolHandle_t handle) {
+    const unsigned char* bytes = (const unsigned char*)block;
+    if (*(const MemoryPoolHandle_t*)block != handle) return 0;
+    for (size_t i = sizeof(handle); i < TIER_BLOCK_SIZE; ++i) {
+        if (bytes[i] != (handle & 0xFF)) return 0;
+    }
+    return 1;
+}
+
+static MemoryPoolTier_t* createTier(MemoryPool_t** pool) {
+    *pool = createMemoryPoolEx(TIER_BLOCK_SIZE, TIER_NUM_BLOCKS * TIER_BLOCK_SIZE, MEM_POOL_LOCK_NONE);
+    assert(*pool != NULL);
+    char dir[] = "/tmp/mem_pool_tier_XXXXXX";
+    assert(mkdtemp(dir) != NULL);
+
+    // Files already in the directory are left alone
+    char keepPath[sizeof(dir) + 8];
+    snprintf(keepPath, sizeof(keepPath), "%s/keep", dir);
+    int fd = open(keepPath, O_WRONLY | O_CREAT | O_EXCL, 0600);
+    assert(fd >= 0 && write(fd, "data", 4) == 4);
+    close(fd);
+
+    MemoryPoolTier_t* tier = memPoolTierCreate(*pool, dir, TIER_FILE_BLOCKS);
+    assert(tier != NULL);
+    struct stat keep;
+    assert(stat(keepPath, &keep) == 0 && keep.st_size == 4);
+    unlink(keepPath);
+    assert(rmdir(dir) == 0); // Nothing left behind, only the mapping holds the file
+    return tier;
+}
+
+// *****Tests*****
+
+void test_tierDemotion(void) {
+#ifdef DEBUGPRINT
+    printf("[TEST] TierDemotion\n");
+#endif
+    MemoryPool_t* pool;
+    MemoryPoolTier_t* tier = createTier(&pool);
+
+    // More handles than blocks: allocation demotes to make room
+    MemoryPoolHandle_t handles[TIER_NUM_HANDLES];
+    for (size_t i = 0; i < TIER_NUM_HANDLES; ++i) {
+        handles[i] = memPoolTierAllocate(tier);
+        assert(handles[i] != 0);
+        void* block = memPoolTierPin(tier, handles[i]);
+        assert(block != NULL);
+        fillBlock(block, handles[i]);
+        memPoolTierUnpin(tier, handles[i]);
+    }
+    assert(memPoolTierAllocate(tier) == 0); // RAM and file full
+    assert(memPoolTierResident(tier) == TIER_NUM_BLOCKS);
+    assert(memPoolTierDemoted(tier) == TIER_FILE_BLOCKS);
+
+    // Every block survives round trips through the file
+    for (int round = 0; round < 3; ++round) {
+        for (size_t i = 0; i < TIER_NUM_HANDLES; ++i) {
+            void* block = memPoolTierPin(tier, handles[i]);
+            assert(block != NULL);
+            assert(checkBlock(block, handles[i]));
+            memPoolTierUnpin(tier, handles[i]);
+        }
+    }
+
+    // Pinned blocks stay put; with everything pinned promotion fails
+    void* pinned[TIER_NUM_BLOCKS];
+    for (size_t i = 0; i < TIER_NUM_BLOCKS; ++i) pinned[i] = memPoolTierPin(tier, handles[i]);
+    assert(memPoolTierDemote(tier, handles[0]) != 0);
+    assert(memPoolTierPin(tier, handles[TIER_NUM_BLOCKS]) == NULL);
+    for (size_t i = 0; i < TIER_NUM_BLOCKS; ++i) {
+        assert(checkBlock(pinned[i], handles[i]));
+        memPoolTierUnpin(tier, handles[i]);
+    }
+
+    // Freeing a demoted handle gives its slot back
+    assert(memPoolTierDemote(tier, handles[0]) != 0); // File full
+    memPoolTierFree(tier, handles[TIER_NUM_BLOCKS]);
+    assert(memPoolTierDemoted(tier) == TIER_FILE_BLOCKS - 1);
+    assert(memPoolTierDemote(tier, handles[0]) == 0);
+    assert(memPoolTierPin(tier, handles[TIER_NUM_BLOCKS]) == NULL); // Stale handle
+
+    for (size_t i = 0; i < TIER_NUM_HANDLES; ++i) memPoolTierFree(tier, handles[i]);
+    assert(memPoolTierResident(tier) == 0 && memPoolTierDemoted(tier) == 0);
+    assert(pool->inUse == 0);
+
+    memPoolTierDestroy(tier);
+    destroyMemoryPool(pool);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] TierDemotion - success\n\n");
+#endif
+}
+
+void test_tierSweep(void) {
+#ifdef DEBUGPRINT
+    printf("[TEST] TierSweep\n");
+#endif
+    MemoryPool_t* pool;
+    MemoryPoolTier_t* tier = createTier(&pool);
+
+    MemoryPoolHandle_t handles[TIER_NUM_BLOCKS];
+    for (size_t i = 0; i < TIER_NUM_BLOCKS; ++i) {
+        handles[i] = memPoolTierAllocate(tier);
+        fillBlock(memPoolTierPin(tier, handles[i]), handles[i]);
+        memPoolTierUnpin(tier, handles[i]);
+    }
+
+    // The first sweep only clears the access bits
+    assert(memPoolTierSweep(tier) == 0);
+
+    // Touch the even handles, keep one odd handle pinned
+    for (size_t i = 0; i < TIER_NUM_BLOCKS; i += 2) {
+        memPoolTierPin(tier, handles[i]);
+        memPoolTierUnpin(tier, handles[i]);
+    }
+    void* held = memPoolTierPin(tier, handles[1]);
+    assert(memPoolTierSweep(tier) == TIER_NUM_BLOCKS / 2 - 1);
+    assert(memPoolTierResident(tier) == TIER_NUM_BLOCKS / 2 + 1);
+    assert(pool->inUse == TIER_NUM_BLOCKS / 2 + 1);
+    assert(checkBlock(held, handles[1]));
+    memPoolTierUnpin(tier, handles[1]);
+
+    // Idle for two sweeps: everything goes to the file
+    memPoolTierSweep(tier);
+    memPoolTierSweep(tier);
+    assert(memPoolTierResident(tier) == 0);
+    assert(pool->inUse == 0);
+    for (size_t i = 0; i < TIER_NUM_BLOCKS; ++i) {
+        assert(checkBlock(memPoolTierPin(tier, handles[i]), handles[i]));
+        memPoolTierUnpin(tier, handles[i]);
+    }
+
+    memPoolTierDestroy(tier); // Frees the blocks still held
+    assert(pool->inUse == 0);
+    destroyMemoryPool(pool);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] TierSweep - success\n\n");
+#endif
+}
+
+// *****Main*****
+
+int main(void) {
+    test_tierDemotion();
+    test_tierSweep();
+
+    return 0;
+}
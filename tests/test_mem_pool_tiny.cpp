@@ -0,0 +1,173 @@
+// Unit tests of the tiny pools.
+
+#include "mem_pool_tiny.h"
+
+#include <assert.h>
+
+// *****Local defines*****
+
+#define TINY_BLOCK_SIZE 32
+#define TINY_NUM_BLOCKS 16
+#define TINY_NUM_POOLS  1000
+
+// *****Local prototypes*****
+
+void test_tinyAllocFree(void);
+void test_tinyCallerMemory(void);
+void test_tinyCorruptLink(void);
+void test_tinyManyPools(void);
+
+// *****Unit tests*****
+
+void test_tinyAllocFree(void) {
+#ifdef DEBUGPRINT
+    printf("[TEST] TinyAllocFree\n");
+#endif
+    assert(tinyPoolFootprint(TINY_BLOCK_SIZE, TINY_NUM_BLOCKS) ==
+           sizeof(MemoryPoolTiny_t) + TINY_BLOCK_SIZE * TINY_NUM_BLOCKS);
+    assert(tinyPoolFootprint(TINY_BLOCK_SIZE + 1, TINY_NUM_BLOCKS) == 0);
+    assert(tinyPoolFootprint(TINY_BLOCK_SIZE, MEM_POOL_TINY_MAX_BLOCKS + 1) == 0);
+    assert(createTinyPool(TINY_BLOCK_SIZE, 0) == NULL);
+
+    MemoryPoolTiny_t* pool = createTinyPool(TINY_BLOCK_SIZE, TINY_NUM_BLOCKS);
+    assert(pool != NULL);
+    assert(tinyPoolBlockSize(pool) == TINY_BLOCK_SIZE && tinyPoolNumBlocks(pool) == TINY_NUM_BLOCKS);
+    assert(tinyPoolCountFree(pool) == TINY_NUM_BLOCKS);
+
+    // Carved in order, distinct, inside the arena
+    void* blocks[TINY_NUM_BLOCKS];
+    for (size_t i = 0; i < TINY_NUM_BLOCKS; ++i) {
+        blocks[i] = allocateTinyBlock(pool);
+        assert(blocks[i] == tinyPoolArena(pool) + i * TINY_BLOCK_SIZE);
+        assert(tinyPoolOwnsBlock(pool, blocks[i]));
+        memset(blocks[i], (int)i, TINY_BLOCK_SIZE);
+    }
+    assert(allocateTinyBlock(pool) == NULL);
+    assert(tinyPoolCountFree(pool) == 0);
+    assert(!tinyPoolOwnsBlock(pool, tinyPoolArena(pool) + TINY_NUM_BLOCKS * TINY_BLOCK_SIZE));
+
+    // Freed blocks come back LIFO
+    freeTinyBlock(pool, blocks[3]);
+    freeTinyBlock(pool, blocks[7]);
+    freeTinyBlock(pool, NULL);
+    assert(tinyPoolCountFree(pool) == 2);
+    assert(allocateTinyBlock(pool) == blocks[7]);
+    assert(allocateTinyBlock(pool) == blocks[3]);
+    assert(allocateTinyBlock(pool) == NULL);
+
+    for (size_t i = 0; i < TINY_NUM_BLOCKS; ++i) freeTinyBlock(pool, blocks[i]);
+    assert(tinyPoolCountFree(pool) == TINY_NUM_BLOCKS);
+    for (size_t i = 0; i < TINY_NUM_BLOCKS; ++i) assert(allocateTinyBlock(pool) == blocks[TINY_NUM_BLOCKS - 1 - i]);
+    destroyTinyPool(pool);
+    destroyTinyPool(NULL);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] TinyAllocFree - success\n\n");
+#endif
+}
+
+void test_tinyCallerMemory(void) {
+#ifdef DEBUGPRINT
+    printf("[TEST] TinyCallerMemory\n");
+#endif
+    uint64_t memory[(sizeof(MemoryPoolTiny_t) + TINY_BLOCK_SIZE * TINY_NUM_BLOCKS) / sizeof(uint64_t) + 1];
+
+    // The partial block at the end is left over
+    MemoryPoolTiny_t* pool = initTinyPool(memory, sizeof(memory) - 1, TINY_BLOCK_SIZE);
+    assert(pool == (MemoryPoolTiny_t*)memory);
+    assert(tinyPoolNumBlocks(pool) == TINY_NUM_BLOCKS);
+    size_t count = 0;
+    while (allocateTinyBlock(pool)) ++count;
+    assert(count == TINY_NUM_BLOCKS);
+
+    assert(initTinyPool((char*)memory + 1, sizeof(memory) - 8, TINY_BLOCK_SIZE) == NULL);
+    assert(initTinyPool(memory, sizeof(MemoryPoolTiny_t) + TINY_BLOCK_SIZE - 1, TINY_BLOCK_SIZE) == NULL);
+    assert(initTinyPool(memory, sizeof(memory), 0) == NULL);
+    ASAN_UNPOISON_MEMORY_REGION(memory, sizeof(memory));
+
+#ifdef DEBUGPRINT
+    printf("[TEST] TinyCallerMemory - success\n\n");
+#endif
+}
+
+void test_tinyCorruptLink(void) {
+#ifdef DEBUGPRINT
+    printf("[TEST] TinyCorruptLink\n");
+#endif
+    MemoryPoolTiny_t* pool = createTinyPool(TINY_BLOCK_SIZE, TINY_NUM_BLOCKS);
+    void* first = allocateTinyBlock(pool);
+    void* second = allocateTinyBlock(pool);
+    freeTinyBlock(pool, first);
+    freeTinyBlock(pool, second);
+
+    // Use after free overwrites the link of the list head: the list is dropped, never
+    // followed, and the allocation is served from the blocks never carved
+    tinyPoolStoreLink(pool, second, TINY_NUM_BLOCKS + 5);
+    assert(pool->corruptions == 0);
+    void* block = allocateTinyBlock(pool);
+    assert(block == tinyPoolArena(pool) + 2 * TINY_BLOCK_SIZE);
+    assert(pool->corruptions == 1);
+    assert(tinyPoolCountFree(pool) == TINY_NUM_BLOCKS - 3);
+
+    // Frees that are not a carved block start are counted, the descriptor stays intact
+    uint64_t geometry = pool->geometry;
+    char outside[TINY_BLOCK_SIZE];
+    freeTinyBlock(pool, outside);
+    freeTinyBlock(pool, (char*)block + 1);
+    freeTinyBlock(pool, tinyPoolArena(pool) + 3 * TINY_BLOCK_SIZE); // Not carved yet
+    assert(pool->geometry == geometry && pool->corruptions == 4);
+    freeTinyBlock(pool, block);
+    assert(tinyPoolCountFree(pool) == TINY_NUM_BLOCKS - 2);
+    destroyTinyPool(pool);
+
+    // Each pool draws its own link key
+    MemoryPoolTiny_t* pools[8];
+    int keysDiffer = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        pools[i] = createTinyPool(TINY_BLOCK_SIZE, TINY_NUM_BLOCKS);
+        keysDiffer |= pools[i]->linkKey != pools[0]->linkKey;
+    }
+    assert(keysDiffer);
+    for (size_t i = 0; i < 8; ++i) destroyTinyPool(pools[i]);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] TinyCorruptLink - success\n\n");
+#endif
+}
+
+void test_tinyManyPools(void) {
+#ifdef DEBUGPRINT
+    printf("[TEST] TinyManyPools\n");
+#endif
+    // One small descriptor per pool, pools stay independent
+    static MemoryPoolTiny_t* pools[TINY_NUM_POOLS];
+    for (size_t i = 0; i < TINY_NUM_POOLS; ++i) {
+        pools[i] = createTinyPool(TINY_BLOCK_SIZE, 1 + i % TINY_NUM_BLOCKS);
+        assert(pools[i] != NULL);
+        void* block = allocateTinyBlock(pools[i]);
+        assert(tinyPoolOwnsBlock(pools[i], block));
+        memset(block, 0xA5, TINY_BLOCK_SIZE);
+    }
+    for (size_t i = 0; i < TINY_NUM_POOLS; ++i) {
+        assert(tinyPoolCountFree(pools[i]) == i % TINY_NUM_BLOCKS);
+        freeTinyBlock(pools[i], tinyPoolArena(pools[i]));
+        assert(tinyPoolCountFree(pools[i]) == 1 + i % TINY_NUM_BLOCKS);
+        destroyTinyPool(pools[i]);
+    }
+
+#ifdef DEBUGPRINT
+    printf("[TEST] TinyManyPools - %u pools, descriptor %u bytes vs %u for MemoryPool_t - success\n\n",
+           (unsigned)TINY_NUM_POOLS, (unsigned)sizeof(MemoryPoolTiny_t), (unsigned)sizeof(MemoryPool_t));
+#endif
+}
+
+// *****Main*****
+
+int main(void) {
+    test_tinyAllocFree();
+    test_tinyCallerMemory();
+    test_tinyCorruptLink();
+    test_tinyManyPools();
+
+    return 0;
+}
@@ -0,0 +1,184 @@
+// Unit tests of page trimming and the memory pressure watcher.
+
+#include "mem_pool_trim.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// *****Local defines*****
+
+#define TRIM_BLOCK_SIZE 64
+#define TRIM_POOL_SIZE  (64 * 1024)
+#define LARGE_BLOCK_SIZE (64 * 1024)
+#define LARGE_NUM_BLOCKS 8
+
+// *****Local prototypes*****
+
+void test_trimRestore(void);
+void test_pressureWatcher(void);
+void test_largeBlocks(void);
+
+// *****Local functions*****
+
+static size_t countFreeBlocks(MemoryPool_t* pool) {
+    size_t count = 0;
+    for (MemoryBlock_t* block = pool->freeList; block; block = memPoolLoadLink(pool, block)) ++count;
+    return count;
+}
+
+// Updated by the watcher thread
+static size_t releasedBlocks(MemoryPool_t* pool) {
+    return __atomic_load_n(&pool->releasedBlocks, __ATOMIC_RELAXED);
+}
+
+// Resident pages of the block body past its first page
+static size_t residentBodyPages(const MemoryPool_t* pool, const void* block) {
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = ((uintptr_t)block + pageSize) & ~(uintptr_t)(pageSize - 1);
+    uintptr_t end = ((uintptr_t)block + pool->blockSize) & ~(uintptr_t)(pageSize - 1);
+    unsigned char vec[LARGE_BLOCK_SIZE / 4096 + 1];
+    assert((end - start) / pageSize <= sizeof(vec));
+    assert(mincore((void*)start, end - start, vec) == 0);
+    size_t resident = 0;
+    for (size_t i = 0; i < (end - start) / pageSize; ++i) resident += vec[i] & 1;
+    return resident;
+}
+
+static void writePsi(const char* path, const char* avg10) {
+    FILE* file = fopen(path, "w");
+    assert(file != NULL);
+    fprintf(file, "some avg10=%s avg60=0.00 avg300=0.00 total=0\n", avg10);
+    fprintf(file, "full avg10=0.00 avg60=0.00 avg300=0.00 total=0\n");
+    fclose(file);
+}
+
+// *****Unit tests*****
+
+void test_trimRestore(void) {
+#ifdef DEBUGPRINT
+    printf("\n[TEST] TrimRestore - start\n");
+#endif
+    MemoryPool_t* pool = createMemoryPool(TRIM_BLOCK_SIZE, TRIM_POOL_SIZE);
+    const size_t numBlocks = TRIM_POOL_SIZE / TRIM_BLOCK_SIZE;
+
+    // A few live blocks keep their pages resident
+    size_t* live[4];
+    for (int i = 0; i < 4; ++i) {
+        live[i] = (size_t*)allocateBlock(pool);
+        *live[i] = 0x1234u + (size_t)i;
+    }
+
+    size_t released = memPoolTrim(pool);
+    assert(released > 0);
+    assert(pool->releasedBlocks > 0);
+    assert(countFreeBlocks(pool) + pool->releasedBlocks == numBlocks - 4);
+    for (int i = 0; i < 4; ++i) assert(*live[i] == 0x1234u + (size_t)i);
+    assert(memPoolTrim(pool) == 0); // Nothing more to give back
+
+    assert(memPoolRestore(pool) == released);
+    assert(countFreeBlocks(pool) == numBlocks - 4);
+
+    // Exhaustion restores released pages on demand
+    memPoolTrim(pool);
+    size_t allocated = 4;
+    while (allocateBlock(pool)) ++allocated;
+    assert(allocated == numBlocks);
+    assert(pool->releasedBlocks == 0);
+    assert(pool->corruptions == 0);
+
+    destroyMemoryPool(pool);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] TrimRestore - success\n\n");
+#endif
+}
+
+void test_pressureWatcher(void) {
+#ifdef DEBUGPRINT
+    printf("\n[TEST] PressureWatcher - start\n");
+#endif
+    char psiPath[] = "/tmp/mem_pool_psi_XXXXXX";
+    int fd = mkstemp(psiPath);
+    assert(fd >= 0);
+    close(fd);
+    writePsi(psiPath, "0.00");
+
+    MemoryPool_t* pool = createMemoryPoolEx(TRIM_BLOCK_SIZE, TRIM_POOL_SIZE, MEM_POOL_LOCK_MUTEX);
+    assert(memPoolPressureWatch(pool) == 0);
+
+    MemoryPressureConfig_t config;
+    memset(&config, 0, sizeof(config));
+    config.psiPath = psiPath;
+    config.eventsPath = "/nonexistent";
+    config.intervalMs = 5;
+    config.quietIntervals = 2;
+    assert(memPoolPressureStart(&config) == 0);
+
+    writePsi(psiPath, "42.00");
+    for (int i = 0; i < 400 && !releasedBlocks(pool); ++i) usleep(5000);
+    assert(releasedBlocks(pool) > 0);
+
+    writePsi(psiPath, "0.00");
+    for (int i = 0; i < 400 && releasedBlocks(pool); ++i) usleep(5000);
+    assert(releasedBlocks(pool) == 0);
+
+    memPoolPressureStop();
+    memPoolPressureUnwatch(pool);
+    destroyMemoryPool(pool);
+    unlink(psiPath);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] PressureWatcher - success\n\n");
+#endif
+}
+
+void test_largeBlocks(void) {
+#ifdef DEBUGPRINT
+    printf("\n[TEST] LargeBlocks - start\n");
+#endif
+    MemoryPool_t* pool = createMemoryPoolEx(LARGE_BLOCK_SIZE, LARGE_BLOCK_SIZE * LARGE_NUM_BLOCKS, MEM_POOL_LOCK_SPIN);
+    assert(memPoolSetLargeBlocks(pool, 2) == 0);
+    assert(pool->large->hotCount == 2 && pool->large->coldCount == LARGE_NUM_BLOCKS - 2);
+    assert(memPoolCountFree(pool) == LARGE_NUM_BLOCKS);
+
+    // Buffers in flight are resident once written, whatever their history
+    void* blocks[LARGE_NUM_BLOCKS];
+    for (int i = 0; i < LARGE_NUM_BLOCKS; ++i) {
+        blocks[i] = allocateBlock(pool);
+        assert(blocks[i] != NULL);
+        memset(blocks[i], 0x5A, LARGE_BLOCK_SIZE);
+        assert(residentBodyPages(pool, blocks[i]) > 0);
+    }
+    assert(allocateBlock(pool) == NULL);
+
+    // Only the two most recently freed keep their bodies
+    for (int i = 0; i < LARGE_NUM_BLOCKS; ++i) freeBlock(pool, blocks[i]);
+    for (int i = 0; i < LARGE_NUM_BLOCKS - 2; ++i) assert(residentBodyPages(pool, blocks[i]) == 0);
+    assert(residentBodyPages(pool, blocks[LARGE_NUM_BLOCKS - 1]) > 0);
+    assert(pool->large->coldCount == LARGE_NUM_BLOCKS - 2);
+
+    // Hot blocks are reused first, newest first; the link page survives the release
+    assert(allocateBlock(pool) == blocks[LARGE_NUM_BLOCKS - 1]);
+    assert(allocateBlock(pool) == blocks[LARGE_NUM_BLOCKS - 2]);
+    void* cold = allocateBlock(pool);
+    assert(cold != NULL && memPoolOwnsBlock(pool, cold));
+    assert(pool->corruptions == 0);
+
+    destroyMemoryPool(pool);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] LargeBlocks - success\n\n");
+#endif
+}
+
+// *****Main*****
+
+int main(void) {
+    test_trimRestore();
+    test_pressureWatcher();
+    test_largeBlocks();
+
+    return 0;
+}
@@ -0,0 +1,176 @@
+// Unit tests of auto-expiring blocks on the timer wheel.
+
+#include "mem_pool_ttl.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+// *****Local defines*****
+
+#define TTL_BLOCK_SIZE 32
+#define TTL_NUM_BLOCKS 256
+
+// *****Local types*****
+
+// Block layout of the tests: the tick the block must expire at
+typedef struct TtlEntry_s {
+    uint64_t expiry;
+    uint64_t keep;  // Nonzero: callback keeps the block and re-arms it for keep ticks
+} TtlEntry_t;
+
+typedef struct TtlContext_s {
+    MemoryPool_t* pool;
+    uint64_t after; // Expiry must lie in (after, now]
+    uint64_t now;
+    size_t expired;
+} TtlContext_t;
+
+// *****Local prototypes*****
+
+void test_ttlExpiry(void);
+void test_ttlWheel(void);
+void test_ttlSpill(void);
+
+// *****Local functions*****
+
+static int onExpire(void* context, void* block) {
+    TtlContext_t* ctx = (TtlContext_t*)context;
+    TtlEntry_t* entry = (TtlEntry_t*)block;
+    assert(entry->expiry > ctx->after && entry->expiry <= ctx->now);
+    ++ctx->expired;
+    if (!entry->keep) return 1;
+    entry->expiry = ctx->now + entry->keep;
+    entry->keep = 0;
+    memPoolTtlRefresh(ctx->pool, block, entry->expiry - ctx->now);
+    return 0;
+}
+
+static size_t advance(TtlContext_t* ctx, uint64_t now) {
+    ctx->after = ctx->now;
+    ctx->now = now;
+    return memPoolTtlAdvance(ctx->pool, now);
+}
+
+static TtlEntry_t* allocateEntry(TtlContext_t* ctx, uint64_t ttl, uint64_t keep) {
+    TtlEntry_t* entry = (TtlEntry_t*)allocateBlockTTL(ctx->pool, ttl, onExpire);
+    assert(entry != NULL);
+    entry->expiry = ctx->now + ttl;
+    entry->keep = keep;
+    return entry;
+}
+
+// *****Unit tests*****
+
+void test_ttlExpiry(void) {
+#ifdef DEBUGPRINT
+    printf("\n[TEST] TtlExpiry - start\n");
+#endif
+    TtlContext_t ctx = { createMemoryPool(TTL_BLOCK_SIZE, TTL_BLOCK_SIZE * TTL_NUM_BLOCKS), 0, 1000, 0 };
+    assert(memPoolTtlEnable(ctx.pool, 1000, &ctx) == 0);
+
+    TtlEntry_t* shortLived = allocateEntry(&ctx, 10, 0);
+    TtlEntry_t* renewed = allocateEntry(&ctx, 10, 500);
+    TtlEntry_t* cancelled = allocateEntry(&ctx, 10, 0);
+    void* plain = allocateBlockTTL(ctx.pool, 5, NULL);
+    freeBlock(ctx.pool, cancelled);
+
+    assert(advance(&ctx, 1009) == 1); // plain, freed without a callback
+    assert(ctx.expired == 0);
+    assert(advance(&ctx, 1010) == 2); // shortLived and renewed (kept)
+    assert(ctx.expired == 2);
+    assert(ctx.pool->inUse == 1); // Only the renewed entry is left
+
+    assert(advance(&ctx, 1509) == 0);
+    assert(advance(&ctx, 1510) == 1);
+    assert(ctx.pool->inUse == 0);
+
+    // A timer far beyond the wheel span: one advance over 2^40 ticks only visits cascades
+    allocateEntry(&ctx, 1ULL << 40, 0);
+    assert(advance(&ctx, ctx.now + (1ULL << 40) - 1) == 0);
+    assert(advance(&ctx, ctx.now + 1) == 1);
+    assert(ctx.pool->inUse == 0);
+    (void)shortLived;
+    (void)renewed;
+    (void)plain;
+
+    destroyMemoryPool(ctx.pool);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] TtlExpiry - success\n\n");
+#endif
+}
+
+// Random timers over every level and beyond the wheel span, advanced in random steps
+void test_ttlWheel(void) {
+#ifdef DEBUGPRINT
+    printf("\n[TEST] TtlWheel - start\n");
+#endif
+    TtlContext_t ctx = { createMemoryPool(TTL_BLOCK_SIZE, TTL_BLOCK_SIZE * TTL_NUM_BLOCKS), 0, 0, 0 };
+    assert(memPoolTtlEnable(ctx.pool, 0, &ctx) == 0);
+    srand(12345);
+
+    static const uint64_t ranges[] = { 64, 4096, 262144, 20000000 };
+    size_t allocated = 0;
+    while (ctx.now < 30000000) {
+        while (ctx.pool->inUse < TTL_NUM_BLOCKS / 2) {
+            uint64_t ttl = 1 + (uint64_t)rand() * (uint64_t)rand() % ranges[allocated % 4];
+            allocateEntry(&ctx, ttl, 0);
+            ++allocated;
+        }
+        advance(&ctx, ctx.now + 1 + (uint64_t)rand() % 8192);
+    }
+    advance(&ctx, ctx.now + 40000000);
+    assert(ctx.expired == allocated);
+    assert(ctx.pool->inUse == 0);
+    assert(ctx.pool->corruptions == 0);
+
+    destroyMemoryPool(ctx.pool);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] TtlWheel - success\n\n");
+#endif
+}
+
+// TTL blocks come from the pool's own arena; plain allocations may still spill
+void test_ttlSpill(void) {
+#ifdef DEBUGPRINT
+    printf("\n[TEST] TtlSpill - start\n");
+#endif
+    MemoryPool_t* pool = createMemoryPool(TTL_BLOCK_SIZE / 2, TTL_BLOCK_SIZE * 2);
+    MemoryPool_t* larger = createMemoryPool(TTL_BLOCK_SIZE, TTL_BLOCK_SIZE * 4);
+    assert(memPoolSetSpill(pool, larger, 100) == 0);
+    assert(memPoolTtlEnable(pool, 0, NULL) == 0);
+
+    void* blocks[4];
+    for (size_t i = 0; i < 4; ++i) {
+        blocks[i] = allocateBlockTTL(pool, 10, NULL);
+        assert(blocks[i] != NULL && memPoolOwnsBlock(pool, blocks[i]));
+    }
+    assert(allocateBlockTTL(pool, 10, NULL) == NULL);
+    void* spilled = allocateBlock(pool);
+    assert(spilled != NULL && memPoolOwnsBlock(larger, spilled));
+    assert(memPoolTtlRefresh(pool, spilled, 5) == -1);
+
+    assert(memPoolTtlAdvance(pool, 10) == 4);
+    assert(pool->inUse == 0);
+    freeBlock(pool, spilled);
+    assert(larger->inUse == 0);
+    assert(pool->corruptions == 0 && larger->corruptions == 0);
+
+    destroyMemoryPool(pool);
+    destroyMemoryPool(larger);
+
+#ifdef DEBUGPRINT
+    printf("[TEST] TtlSpill - success\n\n");
+#endif
+}
+
+// *****Main*****
+
+int main(void) {
+    test_ttlExpiry();
+    test_ttlWheel();
+    test_ttlSpill();
+
+    return 0;
+}
@@ -0,0 +1,325 @@
+// Pool sizing advisor.
+//
+// Replays allocation traces (MEM_POOL_TRACE files, see memPoolTraceOpen) and stats
+// snapshots (output of the control endpoint "list" command) against candidate sets of
+// size classes and recommends the set and per-class block counts with the smallest
+// reserved memory. Reserved memory is sum(blocks * blockSize) over the classes plus a
+// fixed cost per pool, i.e. the live payload, the internal waste of rounding requests up
+// to the class size, and the headroom needed for the target failure probability.
+//
+// The failure probability of a class with N blocks is the fraction of its allocation
+// requests that found N or more blocks already live during the replay.
+//
+// Usage: pool_advisor [--classes N] [--failure P] [--align A] [--overhead B]
+//                     [--stats FILE]... TRACE...
+// The recommended configuration header is written to stdout, a summary to stderr. Build
+// with -DMEM_POOL_CONFIG_HEADER=<file> to take MEM_BLOCK_SIZE and MEM_POOL_SIZE from it;
+// the MEM_POOL_CLASS_<n>_* sizes are for the application's own size-class pools (e.g.
+// the pools of a request context, mem_pool_request.h).
+
+#include "mem_pool.h"
+
+#include <stdlib.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// *****Local defines*****
+
+#define ADVISOR_MAX_CANDIDATES 64   // Distinct sizes considered as class boundaries
+
+// *****Local types*****
+
+typedef struct TraceEvent_s {
+    unsigned long long time;
+    size_t size;                    // Requested size rounded to the alignment
+    int isAlloc;
+} TraceEvent_t;
+
+typedef struct AdvisorConfig_s {
+    size_t maxClasses;
+    double failure;
+    size_t align;
+    size_t overhead;
+} AdvisorConfig_t;
+
+typedef struct ClassPlan_s {
+    size_t blockSize;
+    size_t blocks;
+    size_t allocs;
+    size_t peakLive;
+} ClassPlan_t;
+
+typedef struct Evaluation_s {
+    std::vector<ClassPlan_t> classes;
+    size_t reservedBytes;
+    size_t peakWasteBytes;          // Internal waste at the moment it was largest
+} Evaluation_t;
+
+// *****Local variables*****
+
+static std::vector<TraceEvent_t> events;
+static std::map<size_t, size_t> fixedDemand; // Size -> blocks live in snapshots of untraced pools
+
+// *****Local functions*****
+
+static size_t roundUp(size_t value, size_t align) {
+    if (value < sizeof(MemoryBlock_t)) value = sizeof(MemoryBlock_t);
+    return (value + align - 1) / align * align;
+}
+
+static int readTrace(const char* path, size_t align) {
+    FILE* file = fopen(path, "r");
+    if (!file) return -1;
+
+    // Live blocks of this file: (pool, block) -> rounded requested size
+    std::map<std::pair<std::string, std::string>, size_t> live;
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        if (line[0] == '#') continue;
+        unsigned long long time;
+        char pool[32], block[32], op;
+        unsigned blockSize, size;
+        if (sscanf(line, "%llu %31s %u %c %31s %u", &time, pool, &blockSize, &op, block, &size) != 6) continue;
+
+        std::pair<std::string, std::string> key(pool, block);
+        TraceEvent_t event;
+        event.time = time;
+        event.isAlloc = op == 'a';
+        if (event.isAlloc) {
+            event.size = roundUp(size ? size : blockSize, align);
+            live[key] = event.size;
+        } else {
+            std::map<std::pair<std::string, std::string>, size_t>::iterator it = live.find(key);
+            if (it == live.end()) continue; // Allocated before the trace started
+            event.size = it->second;
+            live.erase(it);
+        }
+        events.push_back(event);
+    }
+    fclose(file);
+    return 0;
+}
+
+// Peak in_use per pool name over all snapshots
+static int readStats(const char* path, size_t align, std::map<std::string, std::pair<size_t, size_t> >& peaks) {
+    FILE* file = fopen(path, "r");
+    if (!file) return -1;
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        int id;
+        char name[64];
+        unsigned blockSize, blocks, numFree, inUse;
+        if (line[0] == '#') continue;
+        if (sscanf(line, "%d %63s %u %u %u %u", &id, name, &blockSize, &blocks, &numFree, &inUse) != 6) continue;
+        std::pair<size_t, size_t>& peak = peaks[name];
+        peak.first = roundUp(blockSize, align);
+        if (inUse > peak.second) peak.second = inUse;
+    }
+    fclose(file);
+    return 0;
+}
+
+static bool eventBefore(const TraceEvent_t& a, const TraceEvent_t& b) {
+    return a.time < b.time;
+}
+
+// Replays all events against one set of class sizes (sorted, last one fits everything)
+static Evaluation_t evaluate(const std::vector<size_t>& classSizes, const AdvisorConfig_t* config) {
+    size_t numClasses = classSizes.size();
+    std::vector<size_t> live(numClasses, 0);
+    std::vector<std::vector<size_t> > liveAtAlloc(numClasses); // Histogram of live blocks seen by allocs
+    Evaluation_t result;
+    result.classes.resize(numClasses);
+    result.reservedBytes = 0;
+    result.peakWasteBytes = 0;
+
+    for (size_t c = 0; c < numClasses; ++c) {
+        result.classes[c].blockSize = classSizes[c];
+        result.classes[c].allocs = 0;
+        result.classes[c].peakLive = 0;
+    }
+    size_t fixedWaste = 0;
+    for (std::map<size_t, size_t>::const_iterator it = fixedDemand.begin(); it != fixedDemand.end(); ++it) {
+        size_t c = std::lower_bound(classSizes.begin(), classSizes.end(), it->first) - classSizes.begin();
+        live[c] += it->second;
+        fixedWaste += (classSizes[c] - it->first) * it->second;
+    }
+
+    size_t waste = fixedWaste;
+    result.peakWasteBytes = waste;
+    for (size_t i = 0; i < events.size(); ++i) {
+        const TraceEvent_t& event = events[i];
+        size_t c = std::lower_bound(classSizes.begin(), classSizes.end(), event.size) - classSizes.begin();
+        if (event.isAlloc) {
+            if (liveAtAlloc[c].size() <= live[c]) liveAtAlloc[c].resize(live[c] + 1, 0);
+            liveAtAlloc[c][live[c]]++;
+            result.classes[c].allocs++;
+            live[c]++;
+            waste += classSizes[c] - event.size;
+            if (waste > result.peakWasteBytes) result.peakWasteBytes = waste;
+        } else if (live[c]) {
+            live[c]--;
+            waste -= classSizes[c] - event.size;
+        }
+        if (live[c] > result.classes[c].peakLive) result.classes[c].peakLive = live[c];
+    }
+
+    for (size_t c = 0; c < numClasses; ++c) {
+        ClassPlan_t& plan = result.classes[c];
+        if (plan.peakLive < live[c]) plan.peakLive = live[c];
+        // Smallest N whose failing allocations (live >= N) stay within the target
+        size_t allowed = (size_t)(config->failure * (double)plan.allocs);
+        size_t failing = 0;
+        plan.blocks = liveAtAlloc[c].size();
+        while (plan.blocks > 0 && failing + liveAtAlloc[c][plan.blocks - 1] <= allowed) {
+            failing += liveAtAlloc[c][--plan.blocks];
+        }
+        size_t fixed = 0;
+        std::map<size_t, size_t>::const_iterator it;
+        for (it = fixedDemand.begin(); it != fixedDemand.end(); ++it) {
+            if ((size_t)(std::lower_bound(classSizes.begin(), classSizes.end(), it->first) - classSizes.begin()) == c) {
+                fixed += it->second;
+            }
+        }
+        if (plan.blocks < fixed) plan.blocks = fixed;
+        if (plan.blocks == 0 && plan.allocs == 0) continue; // Unused class costs nothing
+        if (plan.blocks < 2) plan.blocks = 2; // createMemoryPool needs poolSize > blockSize
+        result.reservedBytes += plan.blocks * plan.blockSize + config->overhead;
+    }
+    return result;
+}
+
+// Greedy search: start with one class fitting everything, add the boundary that saves most
+static std::vector<size_t> chooseClasses(const std::vector<size_t>& candidates, const AdvisorConfig_t* config) {
+    std::vector<size_t> classSizes(1, candidates.back());
+    Evaluation_t best = evaluate(classSizes, config);
+
+    while (classSizes.size() < config->maxClasses) {
+        std::vector<size_t> bestSizes;
+        for (size_t i = 0; i + 1 < candidates.size(); ++i) {
+            if (std::binary_search(classSizes.begin(), classSizes.end(), candidates[i])) continue;
+            std::vector<size_t> trial = classSizes;
+            trial.insert(std::lower_bound(trial.begin(), trial.end(), candidates[i]), candidates[i]);
+            Evaluation_t result = evaluate(trial, config);
+            if (result.reservedBytes < best.reservedBytes) {
+                best = result;
+                bestSizes = trial;
+            }
+        }
+        if (bestSizes.empty()) break;
+        classSizes = bestSizes;
+    }
+    return classSizes;
+}
+
+static void printHeader(const Evaluation_t* plan, const Evaluation_t* single, const AdvisorConfig_t* config) {
+    printf("// Generated by pool_advisor from %u events, target failure probability %g\n",
+           (unsigned)events.size(), config->failure);
+    printf("// Use with cmake -DMEM_POOL_CONFIG_HEADER=<this file>\n");
+    printf("#ifndef MEM_POOL_CONFIG_H\n#define MEM_POOL_CONFIG_H\n\n");
+    printf("// Size classes for createMemoryPoolEx, e.g. the pools of a request context\n");
+
+    size_t numClasses = 0;
+    for (size_t c = 0; c < plan->classes.size(); ++c) {
+        const ClassPlan_t& cls = plan->classes[c];
+        if (cls.blocks == 0 && cls.allocs == 0) continue;
+        printf("#define MEM_POOL_CLASS_%u_BLOCK_SIZE %u\n", (unsigned)numClasses, (unsigned)cls.blockSize);
+        printf("#define MEM_POOL_CLASS_%u_POOL_SIZE  %u // %u blocks, peak live %u\n", (unsigned)numClasses,
+               (unsigned)(cls.blocks * cls.blockSize), (unsigned)cls.blocks, (unsigned)cls.peakLive);
+        ++numClasses;
+    }
+    printf("#define MEM_POOL_CLASS_COUNT %u\n\n", (unsigned)numClasses);
+
+    // Single-pool builds: one class that fits every request
+    const ClassPlan_t& only = single->classes.back();
+    printf("// Geometry of the default pool (MEM_BLOCK_SIZE, MEM_POOL_SIZE in mem_pool.h)\n");
+    printf("#define MEM_BLOCK_SIZE %u\n", (unsigned)only.blockSize);
+    printf("#define MEM_POOL_SIZE  %u\n\n", (unsigned)(only.blocks * only.blockSize));
+    printf("#endif // MEM_POOL_CONFIG_H\n");
+}
+
+static int usage(void) {
+    fprintf(stderr, "usage: pool_advisor [--classes N] [--failure P] [--align A] [--overhead B]\n"
+                    "                    [--stats FILE]... TRACE...\n");
+    return 2;
+}
+
+// *****Main*****
+
+int main(int argc, char** argv) {
+    AdvisorConfig_t config;
+    config.maxClasses = 4;
+    config.failure = 0.0;
+    config.align = sizeof(void*);
+    config.overhead = sizeof(MemoryPool_t) + 2 * 16; // Descriptor plus two heap headers
+
+    std::map<std::string, std::pair<size_t, size_t> > snapshotPeaks;
+    std::vector<const char*> statsFiles;
+    int numTraces = 0;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        int hasValue = i + 1 < argc;
+        if (!strcmp(arg, "--classes") && hasValue) config.maxClasses = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(arg, "--failure") && hasValue) config.failure = strtod(argv[++i], NULL);
+        else if (!strcmp(arg, "--align") && hasValue) config.align = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(arg, "--overhead") && hasValue) config.overhead = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(arg, "--stats") && hasValue) statsFiles.push_back(argv[++i]);
+        else if (arg[0] == '-') return usage();
+        else {
+            if (readTrace(arg, config.align ? config.align : 1) != 0) {
+                fprintf(stderr, "pool_advisor: cannot read %s\n", arg);
+                return 1;
+            }
+            ++numTraces;
+        }
+    }
+    if (config.maxClasses == 0 || config.align == 0 || config.failure < 0.0 || config.failure >= 1.0) return usage();
+    if (numTraces == 0 && statsFiles.empty()) return usage();
+
+    for (size_t i = 0; i < statsFiles.size(); ++i) {
+        if (readStats(statsFiles[i], config.align, snapshotPeaks) != 0) {
+            fprintf(stderr, "pool_advisor: cannot read %s\n", statsFiles[i]);
+            return 1;
+        }
+    }
+    for (std::map<std::string, std::pair<size_t, size_t> >::iterator it = snapshotPeaks.begin();
+         it != snapshotPeaks.end(); ++it) {
+        fixedDemand[it->second.first] += it->second.second;
+    }
+    std::stable_sort(events.begin(), events.end(), eventBefore);
+
+    // Candidate boundaries: distinct sizes, or evenly spaced quantiles when there are too many
+    std::vector<size_t> sizes;
+    for (size_t i = 0; i < events.size(); ++i) {
+        if (events[i].isAlloc) sizes.push_back(events[i].size);
+    }
+    for (std::map<size_t, size_t>::iterator it = fixedDemand.begin(); it != fixedDemand.end(); ++it) {
+        sizes.push_back(it->first);
+    }
+    if (sizes.empty()) {
+        fprintf(stderr, "pool_advisor: no allocations in the input\n");
+        return 1;
+    }
+    std::sort(sizes.begin(), sizes.end());
+    std::vector<size_t> candidates(sizes.begin(), std::unique(sizes.begin(), sizes.end()));
+    if (candidates.size() > ADVISOR_MAX_CANDIDATES) {
+        candidates.clear();
+        for (size_t i = 1; i <= ADVISOR_MAX_CANDIDATES; ++i) {
+            size_t size = sizes[(sizes.size() - 1) * i / ADVISOR_MAX_CANDIDATES];
+            if (candidates.empty() || candidates.back() != size) candidates.push_back(size);
+        }
+    }
+
+    std::vector<size_t> classSizes = chooseClasses(candidates, &config);
+    Evaluation_t plan = evaluate(classSizes, &config);
+    Evaluation_t single = evaluate(std::vector<size_t>(1, candidates.back()), &config);
+
+    fprintf(stderr, "pool_advisor: %u classes, reserved %u bytes (single pool: %u), peak internal waste %u bytes\n",
+            (unsigned)classSizes.size(), (unsigned)plan.reservedBytes, (unsigned)single.reservedBytes,
+            (unsigned)plan.peakWasteBytes);
+    printHeader(&plan, &single, &config);
+    return 0;
+}
@@ -0,0 +1,192 @@
+// Occupancy heatmap renderer.
+//
+// Reads a timeline written by memPoolOccupancyStart (mem_pool_occupancy.h) and renders it
+// with pages left to right and samples top to bottom: black is an empty page, blue to red
+// to yellow rising occupancy. The output format follows the file extension, .ppm (binary
+// PPM) or .svg (one rectangle per run of equal cells in a row).
+//
+// Without an output file only the summary is printed. Of the last sample it gives
+//   touched: pages holding at least one live block
+//   needed:  pages the live blocks would fill if packed
+//   empty:   pages without live blocks, candidates for memPoolTrim
+// A growing touched/needed ratio over a run is the locality decay.
+//
+// Usage: pool_heatmap [--scale N] TIMELINE [OUT.ppm | OUT.svg]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// *****Local types*****
+
+typedef struct Timeline_s {
+    std::string pool;
+    unsigned long blockSize;
+    unsigned long pageSize;
+    size_t pages;
+    std::vector<unsigned long> times;
+    std::vector<std::string> rows;  // One hex digit per page
+} Timeline_t;
+
+typedef struct Rgb_s {
+    unsigned char r, g, b;
+} Rgb_t;
+
+// *****Local functions*****
+
+static int readLine(FILE* file, std::string& line) {
+    line.clear();
+    int c;
+    while ((c = getc(file)) != EOF && c != '\n') line += (char)c;
+    return c != EOF || !line.empty();
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+static int readTimeline(const char* path, Timeline_t* timeline) {
+    FILE* file = fopen(path, "r");
+    if (!file) return -1;
+
+    std::string line;
+    timeline->pages = 0;
+    while (readLine(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        char name[32];
+        unsigned long pages;
+        if (sscanf(line.c_str(), "pool %31s %lu %lu %lu", name, &timeline->blockSize, &timeline->pageSize,
+                   &pages) == 4) {
+            timeline->pool = name;
+            timeline->pages = pages;
+            continue;
+        }
+        unsigned long time;
+        int offset;
+        if (!timeline->pages || sscanf(line.c_str(), "%lu %n", &time, &offset) != 1) continue;
+        std::string row = line.substr((size_t)offset);
+        if (row.size() != timeline->pages) continue; // Torn last line of a running sampler
+        timeline->times.push_back(time);
+        timeline->rows.push_back(row);
+    }
+    fclose(file);
+    return timeline->pages && !timeline->rows.empty() ? 0 : -1;
+}
+
+static Rgb_t levelColour(int level) {
+    Rgb_t colour = { 0, 0, 0 };
+    if (level <= 0) return colour;
+    // 1..7: blue to red, 8..15: red to yellow
+    if (level < 8) {
+        colour.r = (unsigned char)(level * 255 / 7);
+        colour.b = (unsigned char)(255 - colour.r);
+    } else {
+        colour.r = 255;
+        colour.g = (unsigned char)((level - 7) * 255 / 8);
+    }
+    return colour;
+}
+
+static int writePpm(const char* path, const Timeline_t* timeline, unsigned scale) {
+    FILE* out = fopen(path, "wb");
+    if (!out) return -1;
+    size_t width = timeline->pages * scale;
+    fprintf(out, "P6\n%lu %lu\n255\n", (unsigned long)width, (unsigned long)(timeline->rows.size() * scale));
+    std::vector<unsigned char> pixels(width * 3);
+    for (size_t r = 0; r < timeline->rows.size(); ++r) {
+        for (size_t p = 0; p < timeline->pages; ++p) {
+            Rgb_t colour = levelColour(hexValue(timeline->rows[r][p]));
+            for (unsigned x = 0; x < scale; ++x) {
+                unsigned char* pixel = &pixels[(p * scale + x) * 3];
+                pixel[0] = colour.r;
+                pixel[1] = colour.g;
+                pixel[2] = colour.b;
+            }
+        }
+        for (unsigned y = 0; y < scale; ++y) fwrite(&pixels[0], 1, pixels.size(), out);
+    }
+    return fclose(out) == 0 ? 0 : -1;
+}
+
+static int writeSvg(const char* path, const Timeline_t* timeline, unsigned scale) {
+    FILE* out = fopen(path, "w");
+    if (!out) return -1;
+    fprintf(out, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%lu\" height=\"%lu\" shape-rendering=\"crispEdges\">\n",
+            (unsigned long)(timeline->pages * scale), (unsigned long)(timeline->rows.size() * scale));
+    fprintf(out, "<title>%s: %lu-byte blocks, %lu-byte pages, %lu..%lu ms</title>\n", timeline->pool.c_str(),
+            timeline->blockSize, timeline->pageSize, timeline->times.front(), timeline->times.back());
+    fprintf(out, "<rect width=\"100%%\" height=\"100%%\" fill=\"#000\"/>\n");
+    for (size_t r = 0; r < timeline->rows.size(); ++r) {
+        const std::string& row = timeline->rows[r];
+        for (size_t p = 0; p < timeline->pages;) {
+            size_t run = 1;
+            while (p + run < timeline->pages && row[p + run] == row[p]) ++run;
+            if (row[p] != '0') {
+                Rgb_t colour = levelColour(hexValue(row[p]));
+                fprintf(out, "<rect x=\"%lu\" y=\"%lu\" width=\"%lu\" height=\"%u\" fill=\"#%02x%02x%02x\"/>\n",
+                        (unsigned long)(p * scale), (unsigned long)(r * scale), (unsigned long)(run * scale), scale,
+                        colour.r, colour.g, colour.b);
+            }
+            p += run;
+        }
+    }
+    fprintf(out, "</svg>\n");
+    return fclose(out) == 0 ? 0 : -1;
+}
+
+static void printSummary(const Timeline_t* timeline) {
+    const std::string& last = timeline->rows.back();
+    size_t touched = 0, empty = 0, sixteenths = 0;
+    for (size_t p = 0; p < timeline->pages; ++p) {
+        int level = hexValue(last[p]);
+        if (level > 0) ++touched;
+        else ++empty;
+        sixteenths += level > 0 ? (size_t)level + 1 : 0; // Digit d covers up to (d + 1) / 16
+    }
+    size_t needed = (sixteenths + 15) / 16;
+    if (needed > touched) needed = touched;
+    printf("pool %s: %u samples, %u pages of %lu bytes, %lu ms\n", timeline->pool.c_str(),
+           (unsigned)timeline->rows.size(), (unsigned)timeline->pages, timeline->pageSize, timeline->times.back());
+    printf("last sample: touched %u needed %u empty %u\n", (unsigned)touched, (unsigned)needed, (unsigned)empty);
+}
+
+static int usage(void) {
+    fprintf(stderr, "usage: pool_heatmap [--scale N] TIMELINE [OUT.ppm | OUT.svg]\n");
+    return 2;
+}
+
+// *****Main*****
+
+int main(int argc, char** argv) {
+    unsigned scale = 4;
+    const char* input = NULL;
+    const char* output = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--scale") && i + 1 < argc) scale = (unsigned)strtoul(argv[++i], NULL, 0);
+        else if (argv[i][0] == '-') return usage();
+        else if (!input) input = argv[i];
+        else if (!output) output = argv[i];
+        else return usage();
+    }
+    if (!input || scale == 0) return usage();
+
+    Timeline_t timeline;
+    if (readTimeline(input, &timeline) != 0) {
+        fprintf(stderr, "pool_heatmap: cannot read %s\n", input);
+        return 1;
+    }
+    printSummary(&timeline);
+    if (!output) return 0;
+
+    size_t length = strlen(output);
+    int svg = length > 4 && !strcmp(output + length - 4, ".svg");
+    if ((svg ? writeSvg(output, &timeline, scale) : writePpm(output, &timeline, scale)) != 0) {
+        fprintf(stderr, "pool_heatmap: cannot write %s\n", output);
+        return 1;
+    }
+    return 0;
+}